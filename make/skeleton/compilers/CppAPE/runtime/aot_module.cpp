@@ -0,0 +1,101 @@
+/*
+	Compiler interface of projects exported ahead of time (see "Export native..." in the editor).
+	Compiled together with the project, runtime.cpp and misc_tasks.cpp into a native module by the
+	system toolchain (see NativeBackend.cpp), that APE loads in place of a compiler through
+	"Run graph or module..." or a graph node. Nothing is compiled, the project just runs.
+*/
+
+#include <shared-src/ape/CppCompilerInterface.cpp>
+#include <shared-src/tcc4ape/ScriptBindings.h>
+#include <cstdlib>
+
+extern "C" PluginGlobalData NAME_GLOBAL_DATA;
+
+namespace
+{
+	class NativeProject : public ape::ProtoCompiler
+	{
+	public:
+
+		ape::Status compileProject() override
+		{
+			print(APE_Diag_Info, "[Native] : Running project exported ahead of time.");
+			return STATUS_OK;
+		}
+
+		ape::Status releaseProject() override
+		{
+			return STATUS_OK;
+		}
+
+		ape::Status initProject() override
+		{
+			return STATUS_OK;
+		}
+
+		ape::Status activateProject() override
+		{
+			auto& global = NAME_GLOBAL_DATA;
+
+			if (global.wantsToSelfAlloc)
+				instance = global.PluginAlloc ? global.PluginAlloc(getProject()->iface) : nullptr;
+			else
+				instance = std::calloc(global.allocSize, 1);
+
+			if (!instance)
+			{
+				print(APE_Diag_Error, "[Native] : Error allocating the plugin.");
+				return STATUS_ERROR;
+			}
+
+			return ::NAME_INIT(instance, getProject()->iface);
+		}
+
+		ape::Status disableProject(bool didMisbehave) override
+		{
+			ape::Status ret = STATUS_OK;
+
+			if (!didMisbehave && instance)
+			{
+				ret = ::NAME_END(instance, getProject()->iface);
+
+				if (NAME_GLOBAL_DATA.wantsToSelfAlloc)
+					NAME_GLOBAL_DATA.PluginFree(instance);
+				else
+					std::free(instance);
+			}
+
+			instance = nullptr;
+			return ret;
+		}
+
+		ape::Status processReplacing(const float * const * in, float * const * out, std::size_t frames) override
+		{
+			return ::NAME_PROCESS_REPLACE(instance, getProject()->iface, const_cast<float**>(in), const_cast<float**>(out), static_cast<int>(frames));
+		}
+
+		ape::Status onEvent(ape::Event * e) override
+		{
+			return ::NAME_EVENT_HANDLER(instance, getProject()->iface, e);
+		}
+
+	private:
+
+		ScriptInstance * instance = nullptr;
+	};
+}
+
+APE_Status CleanCompilerCache()
+{
+	return STATUS_OK;
+}
+
+ape::ProtoCompiler * CreateCompiler()
+{
+	return new NativeProject();
+}
+
+void DeleteCompiler(ape::ProtoCompiler * toBeDeleted)
+{
+	delete toBeDeleted;
+}
@@ -1,5 +1,6 @@
 #include "misc_tasks.h"
 #include <trace.h>
+#include <profile_scope.h>
 
 namespace ape
 {
@@ -34,5 +35,53 @@ namespace ape
 		}
 	}
 
+	namespace Profiling
+	{
+
+	#ifdef CPPAPE_PROFILING_ENABLED
+		APE_ProfileRing* ring;
+		std::size_t openScopes;
+		APE_ProfileRing* block;
+	#endif
 
+		void BeginBlock()
+		{
+	#ifdef CPPAPE_PROFILING_ENABLED
+			ring = getInterface().getProfileRing(&getInterface());
+			openScopes = 0;
+			block = beginScope("process");
+	#endif
+		}
+
+		void EndBlock()
+		{
+	#ifdef CPPAPE_PROFILING_ENABLED
+			if (block)
+				endScope(block);
+
+			// scopes outside of processing aren't on the processing thread
+			ring = nullptr;
+	#endif
+		}
+	}
+
+	namespace detail
+	{
+		void parallelFor(std::size_t count, std::size_t grain, APE_ParallelBody body, void* context)
+		{
+	#ifdef CPPAPE_PROFILING_ENABLED
+			// the bodies run on the workers as well, which must neither write to the ring nor the scope count.
+			// only the processing thread gets here with a ring, so nested loops on workers never write it.
+			struct Suspension
+			{
+				Suspension() : processing(Profiling::ring) { if (processing) Profiling::ring = nullptr; }
+				~Suspension() { if (processing) Profiling::ring = processing; }
+
+				APE_ProfileRing* processing;
+			} suspension;
+	#endif
+
+			getInterface().parallelFor(&getInterface(), count, grain, body, context);
+		}
+	}
 }
\ No newline at end of file
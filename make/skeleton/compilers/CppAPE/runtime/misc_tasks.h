@@ -7,4 +7,10 @@ namespace ape::Tracing
 	void PresentTracers();
 }
 
+namespace ape::Profiling
+{
+	void BeginBlock();
+	void EndBlock();
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,16 @@
+/*
+	Linked into instrumented builds for profile guided optimization (see APE_ProfileGuidance_Instrument).
+	The profile runtime only writes the counts when the process exits, which isn't reliable for modules
+	unloaded before, so the compiler writes it through this when the project is released.
+	The counters are reset afterwards, so the profile isn't merged in twice if it's written on unloading anyway.
+*/
+
+extern "C" int __llvm_profile_write_file(void);
+extern "C" void __llvm_profile_reset_counters(void);
+
+extern "C" __attribute__((visibility("default"))) int __cppape_write_profile()
+{
+	const int result = __llvm_profile_write_file();
+	__llvm_profile_reset_counters();
+	return result;
+}
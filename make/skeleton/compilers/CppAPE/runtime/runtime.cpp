@@ -124,12 +124,16 @@ extern "C"
 		
 		auto configuration = p->config();
 
+		Profiling::BeginBlock();
+
 		p->processFrames(
 			{ inputs, configuration.inputs, frames },
 			{ outputs,  configuration.outputs, frames },
 			frames
 		);
 
+		Profiling::EndBlock();
+
 		Tracing::PresentTracers();
 
 		return StatusCode::Ok;
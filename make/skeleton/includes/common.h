@@ -14,6 +14,7 @@
 #include "fft.h"
 #include "mathutil.h"
 #include "print.h"
+#include "profile_scope.h"
 
 #include <complex>
 #include <map>
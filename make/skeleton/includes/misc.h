@@ -6,6 +6,7 @@
 #include <assert.h>
 #include <type_traits>
 
+#include "baselib.h"
 #include "interpolation.h"
 
 namespace ape
@@ -402,6 +403,28 @@ namespace ape
 		std::vector<T> buffer;
 	};
 
+	/// <summary>
+	/// Returns an uninitialized array of <paramref name="n"/> elements for short-lived work,
+	/// allocated from a per-block arena without locks or system calls. Blocks needing more than
+	/// the arena holds (see scratch_size in config.cfg) take the rest from the heap, until the arena
+	/// has been grown in the background.
+	/// The memory is released automatically once the current block has been processed,
+	/// so never keep it around between calls to <see cref="Processor::process()"/>.
+	/// </summary>
+	template<typename T>
+	uarray<T> scratch(std::size_t n)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "Scratch memory is never destructed");
+
+		auto& iface = getInterface();
+		auto memory = iface.alloc(&iface, APE_Alloc_Temp, n * sizeof(T), alignof(T) > 64 ? alignof(T) : 64);
+
+		if (!memory)
+			abort("Out of scratch memory");
+
+		return { static_cast<T*>(memory), n };
+	}
+
 	/// <summary>
 	/// An infinitely indexable read-only signal that repeats the original signal.
 	/// Supports signed and unsigned integer indices or hermite-interpolated fractional indices.
@@ -6,6 +6,7 @@
 #include <cstddef>
 #include <charconv>
 #include <complex>
+#include <cstring>
 
 /// <summary>
 /// Print to the console attached to this plugin.
@@ -0,0 +1,23 @@
+#ifndef CPPAPE_PROFILE_H
+#define CPPAPE_PROFILE_H
+
+/*
+	Included automatically in builds profiling the source lines (the "Profile lines" option of the editor).
+	Every statement of the script is prefixed with CPPAPE_PROFILE_LINE(), keeping track of the line being
+	executed, which the host samples while the script is processing.
+	Time spent in code without lines of its own (like the headers) is counted towards the calling line.
+*/
+
+extern "C"
+{
+	/// <summary>
+	/// 1-based line of the script being executed, or 0 before the first one.
+	/// Read by the host from another thread, hence volatile - storing an int is atomic in practice.
+	/// Inline, as every unit of the project includes the header.
+	/// </summary>
+	inline volatile int __cppape_current_line;
+}
+
+#define CPPAPE_PROFILE_LINE(line) (__cppape_current_line = (line))
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef CPPAPE_PROFILE_SCOPE_H
+#define CPPAPE_PROFILE_SCOPE_H
+
+/// <summary>
+/// Times the rest of the enclosing scope, shown in the timeline of the editor nested inside the scopes it's
+/// entered from. Every processed block is a scope of its own, named "process".
+/// The name must be a string literal. Only recorded on the processing thread, so scopes inside parallel_for() bodies are skipped.
+/// Unless "Profile scopes" is enabled in the editor, there's no overhead in calling this.
+/// <code>
+/// APE_PROFILE_SCOPE("filter");
+/// </code>
+/// </summary>
+#define APE_PROFILE_SCOPE(name) ((void)0)
+
+#endif
+
+/*
+	Included again with CPPAPE_PROFILING_ENABLED defined in builds profiling scopes (see APE_Project::profileScopes),
+	which may come after the precompiled common header.
+	Events are written into the ring of the host without allocating, locking or calling it. Scopes only begin
+	if their end and the ends of every open scope fit as well, so the ring never holds unbalanced scopes.
+*/
+#if defined(CPPAPE_PROFILING_ENABLED) && !defined(CPPAPE_PROFILE_SCOPE_ENABLED_H)
+#define CPPAPE_PROFILE_SCOPE_ENABLED_H
+
+#include <cstddef>
+
+namespace ape::Profiling
+{
+	/// <summary>
+	/// The ring of the host while processing a block, null otherwise. See BeginBlock().
+	/// Also null while parallel_for() runs, so the workers only ever read these.
+	/// </summary>
+	extern APE_ProfileRing* ring;
+	/// <summary>
+	/// Scopes that have begun in the ring, and have room reserved for their end.
+	/// </summary>
+	extern std::size_t openScopes;
+
+	inline unsigned long long stamp() noexcept
+	{
+	#if defined(__x86_64__) || defined(__i386__)
+		return __builtin_ia32_rdtsc();
+	#else
+		return __builtin_readcyclecounter();
+	#endif
+	}
+
+	inline void publish(APE_ProfileRing& target, const char* name) noexcept
+	{
+		const auto written = target.written;
+		target.events[written & target.mask] = { stamp(), name };
+		__atomic_store_n(&target.written, written + 1, __ATOMIC_RELEASE);
+	}
+
+	/// <summary>
+	/// Returns the ring the scope was written to, or null if it was dropped.
+	/// </summary>
+	inline APE_ProfileRing* beginScope(const char* name) noexcept
+	{
+		auto target = ring;
+
+		if (!target)
+			return nullptr;
+
+		const auto used = target->written - __atomic_load_n(&target->read, __ATOMIC_ACQUIRE);
+
+		// the beginning, its end and the ends of the open scopes
+		if (used + 2 + openScopes > target->mask + 1)
+		{
+			__atomic_fetch_add(&target->dropped, 1, __ATOMIC_RELAXED);
+			return nullptr;
+		}
+
+		publish(*target, name);
+		openScopes++;
+		return target;
+	}
+
+	inline void endScope(APE_ProfileRing* target) noexcept
+	{
+		// a different block has begun since, which would unbalance the scopes
+		if (target != ring)
+			return;
+
+		publish(*target, nullptr);
+		openScopes--;
+	}
+
+	class Scope
+	{
+	public:
+
+		Scope(const char* name) noexcept : target(beginScope(name)) {}
+		~Scope() { if (target) endScope(target); }
+
+		Scope(const Scope&) = delete;
+		Scope& operator = (const Scope&) = delete;
+
+	private:
+
+		APE_ProfileRing* target;
+	};
+}
+
+#undef APE_PROFILE_SCOPE
+
+#define CPPAPE_PROFILE_SCOPE_CONCAT_(a, b) a##b
+#define CPPAPE_PROFILE_SCOPE_CONCAT(a, b) CPPAPE_PROFILE_SCOPE_CONCAT_(a, b)
+#define APE_PROFILE_SCOPE(name) ::ape::Profiling::Scope CPPAPE_PROFILE_SCOPE_CONCAT(__cppape_scope_, __LINE__)(name)
+
+#endif
@@ -4,6 +4,7 @@
 #include <complex>
 #include <climits>
 #include "misc.h"
+#include <utility>
 #include <vector>
 
 namespace ape
@@ -87,6 +88,168 @@ namespace ape
 	{
 		return as_vectors(as_uarray(input));
 	}
+
+	/// <summary>
+	/// Instruction sets that kernels can be specialised for, see <see cref="isa_dispatch"/>.
+	/// </summary>
+	enum class instruction_set
+	{
+		generic,
+		/// <summary>
+		/// AVX2 with FMA and F16C.
+		/// </summary>
+		avx2,
+		/// <summary>
+		/// AVX-512 F, BW, DQ and VL.
+		/// </summary>
+		avx512
+	};
+
+	/// <summary>
+	/// The best instruction set the script is compiled for. In the editor that is the host processor, which also predefines
+	/// the usual macros for every supported extension (__AVX2__, __FMA__, __F16C__, __AVX512F__ and so on).
+	/// Exported scripts are compiled for a baseline processor instead, see <see cref="runtime_instruction_set()"/>.
+	/// </summary>
+	constexpr instruction_set native_instruction_set =
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512DQ__) && defined(__AVX512VL__)
+		instruction_set::avx512;
+#elif defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+		instruction_set::avx2;
+#else
+		instruction_set::generic;
+#endif
+
+/// <summary>
+/// Compiles a function for specific instruction set extensions, regardless of what the script is compiled for.
+/// Such functions must only be called if the processor supports them, see <see cref="isa_dispatch"/>.
+/// </summary>
+#define APE_TARGET(features) __attribute__((target(features)))
+#define APE_TARGET_AVX2 APE_TARGET("avx2,fma,f16c")
+#define APE_TARGET_AVX512 APE_TARGET("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,f16c")
+
+	namespace detail
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		inline void cpuid(unsigned leaf, unsigned (&registers)[4]) noexcept
+		{
+			__asm__ volatile ("cpuid" : "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3]) : "a" (leaf), "c" (0));
+		}
+
+		// which register states the operating system saves on context switches
+		inline unsigned long long enabled_states() noexcept
+		{
+			unsigned low, high;
+			__asm__ volatile ("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+			return (static_cast<unsigned long long>(high) << 32) | low;
+		}
+
+		inline bool bit(unsigned reg, int index) noexcept
+		{
+			return (reg >> index) & 1;
+		}
+#endif
+	}
+
+	/// <summary>
+	/// The best instruction set of the processor actually running the script, which may be better than
+	/// <see cref="native_instruction_set"/>. Detected on every call, so keep the result (like <see cref="isa_dispatch"/> does).
+	/// </summary>
+	inline instruction_set runtime_instruction_set() noexcept
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		using detail::bit;
+
+		unsigned basic[4], extended[4] = {};
+		detail::cpuid(0, basic);
+
+		const auto maxLeaf = basic[0];
+
+		if (maxLeaf < 1)
+			return instruction_set::generic;
+
+		detail::cpuid(1, basic);
+
+		if (maxLeaf >= 7)
+			detail::cpuid(7, extended);
+
+		// the vector extensions are useless unless the os preserves the registers
+		if (!bit(basic[2], 27))
+			return instruction_set::generic;
+
+		const auto states = detail::enabled_states();
+		const bool ymm = (states & 0x6) == 0x6;
+		const bool zmm = ymm && (states & 0xE0) == 0xE0;
+
+		const bool avx2 = ymm && bit(basic[2], 28) && bit(basic[2], 12) && bit(basic[2], 29) && bit(extended[1], 5);
+		const bool avx512 = avx2 && zmm && bit(extended[1], 16) && bit(extended[1], 17) && bit(extended[1], 30) && bit(extended[1], 31);
+
+		return avx512 ? instruction_set::avx512 : avx2 ? instruction_set::avx2 : instruction_set::generic;
+#else
+		return native_instruction_set;
+#endif
+	}
+
+	/// <summary>
+	/// Selects the best of a set of kernels for the processor running the script once, and forwards calls to it -
+	/// like the target_clones attribute. Kernels for extensions the processor doesn't support are never called.
+	/// The processor is detected when constructed, see <see cref="runtime_instruction_set()"/>.
+	/// Typically the specialised kernels are instantiations of the same template body marked with
+	/// <see cref="APE_TARGET_AVX2"/> / <see cref="APE_TARGET_AVX512"/>:
+	/// <code>
+	/// template&lt;typename T&gt; void gain(T* data, std::size_t n, T g) { for (std::size_t i = 0; i &lt; n; ++i) data[i] *= g; }
+	/// APE_TARGET_AVX512 void gain512(float* data, std::size_t n, float g) { gain(data, n, g); }
+	/// static const isa_dispatch&lt;void(float*, std::size_t, float)&gt; fastGain(gain&lt;float&gt;, nullptr, gain512);
+	/// </code>
+	/// </summary>
+	template<typename Signature>
+	class isa_dispatch;
+
+	template<typename R, typename... Args>
+	class isa_dispatch<R(Args...)>
+	{
+	public:
+
+		typedef R (*kernel)(Args...);
+
+		isa_dispatch(kernel generic, kernel avx2 = nullptr, kernel avx512 = nullptr)
+			: selected(select(runtime_instruction_set(), generic, avx2, avx512))
+		{
+
+		}
+
+		R operator()(Args... args) const
+		{
+			return selected(std::forward<Args>(args)...);
+		}
+
+		/// <summary>
+		/// The instruction set of the selected kernel.
+		/// </summary>
+		instruction_set target() const noexcept { return selectedSet; }
+
+	private:
+
+		kernel select(instruction_set supported, kernel generic, kernel avx2, kernel avx512)
+		{
+			if (supported >= instruction_set::avx512 && avx512)
+			{
+				selectedSet = instruction_set::avx512;
+				return avx512;
+			}
+
+			if (supported >= instruction_set::avx2 && avx2)
+			{
+				selectedSet = instruction_set::avx2;
+				return avx2;
+			}
+
+			selectedSet = instruction_set::generic;
+			return generic;
+		}
+
+		instruction_set selectedSet = instruction_set::generic;
+		kernel selected;
+	};
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,7 @@
+#include <effect.h>
+
+GlobalData(Empty, "");
+
+class Empty : public ape::Effect
+{
+};
@@ -0,0 +1,27 @@
+#include <effect.h>
+
+GlobalData(Gain, "");
+
+class Gain : public ape::Effect
+{
+public:
+
+	ape::Param<float> gain { "Gain", ape::Range(0, 2) };
+	ape::Param<bool> invert { "Invert" };
+
+private:
+
+	void process(ape::umatrix<const float> inputs, ape::umatrix<float> outputs, size_t frames) override
+	{
+		const auto shared = sharedChannels();
+		const float sign = invert ? -1.0f : 1.0f;
+
+		for (std::size_t c = 0; c < shared; ++c)
+		{
+			for (std::size_t n = 0; n < frames; ++n)
+				outputs[c][n] = sign * gain[n] * inputs[c][n];
+		}
+
+		clear(outputs, shared);
+	}
+};
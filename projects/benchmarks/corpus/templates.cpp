@@ -0,0 +1,137 @@
+/*
+	Stresses the frontend with a lot of template instantiations, like scripts
+	composing generic dsp building blocks do.
+*/
+#include <effect.h>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+GlobalData(Templates, "");
+
+namespace generic
+{
+	template<typename T, std::size_t Size>
+	constexpr std::array<T, Size> makeTable(T scale)
+	{
+		std::array<T, Size> table {};
+
+		for (std::size_t i = 0; i < Size; ++i)
+			table[i] = scale * static_cast<T>(i) / static_cast<T>(Size);
+
+		return table;
+	}
+
+	template<typename T, std::size_t Stage>
+	struct OnePole
+	{
+		T state {}, coefficient = static_cast<T>(1) / static_cast<T>(Stage + 2);
+
+		T operator()(T x) noexcept
+		{
+			state += coefficient * (x - state);
+			return state;
+		}
+	};
+
+	template<typename T, typename Indices>
+	struct CascadeOf;
+
+	template<typename T, std::size_t... Stages>
+	struct CascadeOf<T, std::index_sequence<Stages...>>
+	{
+		std::tuple<OnePole<T, Stages>...> stages;
+
+		T operator()(T x) noexcept
+		{
+			std::apply([&](auto&... stage) { ((x = stage(x)), ...); }, stages);
+			return x;
+		}
+	};
+
+	template<typename T, std::size_t Order>
+	using Cascade = CascadeOf<T, std::make_index_sequence<Order>>;
+
+	template<typename T, std::size_t... Orders>
+	struct Bank
+	{
+		std::tuple<Cascade<T, Orders>...> cascades;
+
+		T operator()(T x) noexcept
+		{
+			T sum {};
+			std::apply([&](auto&... cascade) { ((sum += cascade(x)), ...); }, cascades);
+			return sum / static_cast<T>(sizeof...(Orders));
+		}
+	};
+
+	template<typename T>
+	struct Voice
+	{
+		Bank<T, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16> bank;
+		T level = static_cast<T>(1);
+	};
+
+	template<typename T, typename Predicate>
+	void sortVoices(std::vector<std::unique_ptr<Voice<T>>>& voices, Predicate&& predicate)
+	{
+		std::stable_sort(voices.begin(), voices.end(), [&](const auto& a, const auto& b) { return predicate(*a, *b); });
+	}
+}
+
+class Templates : public ape::Effect
+{
+public:
+
+	ape::Param<float> mix { "Mix", ape::Range(0, 1) };
+
+	Templates()
+	{
+		for (std::size_t i = 0; i < voicesPerChannel; ++i)
+		{
+			floatVoices.emplace_back(std::make_unique<generic::Voice<float>>());
+			doubleVoices.emplace_back(std::make_unique<generic::Voice<double>>());
+			floatVoices.back()->level = table[(i * 37) % table.size()];
+			doubleVoices.back()->level = table[(i * 91) % table.size()];
+		}
+
+		generic::sortVoices(floatVoices, [](const auto& a, const auto& b) { return a.level < b.level; });
+		generic::sortVoices(doubleVoices, [](const auto& a, const auto& b) { return a.level > b.level; });
+	}
+
+private:
+
+	static constexpr std::size_t voicesPerChannel = 4;
+	static constexpr auto table = generic::makeTable<float, 256>(1.0f);
+
+	void process(ape::umatrix<const float> inputs, ape::umatrix<float> outputs, size_t frames) override
+	{
+		const auto shared = sharedChannels();
+
+		for (std::size_t c = 0; c < shared; ++c)
+		{
+			for (std::size_t n = 0; n < frames; ++n)
+			{
+				const float x = inputs[c][n];
+				float wet = 0;
+
+				for (auto& voice : floatVoices)
+					wet += voice->level * voice->bank(x);
+
+				for (auto& voice : doubleVoices)
+					wet += static_cast<float>(voice->level * voice->bank(static_cast<double>(x)));
+
+				outputs[c][n] = x + mix[n] * (wet / (2 * voicesPerChannel) - x);
+			}
+		}
+
+		clear(outputs, shared);
+	}
+
+	std::vector<std::unique_ptr<generic::Voice<float>>> floatVoices;
+	std::vector<std::unique_ptr<generic::Voice<double>>> doubleVoices;
+};
@@ -0,0 +1,541 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:CompileLatency.cpp
+		
+		Benchmarks the latency of compiling scripts with CppAPE, by driving the
+		exports of the compiler module directly over a fixed corpus of scripts
+		(projects/benchmarks/corpus, and the examples of the installation).
+		
+		Every script is compiled cold (with the caches and precompiled headers
+		cleaned) and then warm a number of times, reporting the phases measured
+		by the compiler (see APE_CompileTimings) as JSON, so regressions can be
+		tracked over time. A cold compilation that hits the cache anyway is
+		reported as an error of the script.
+
+*************************************************************************************/
+
+
+#include <ape/CompilerBindings.h>
+#include <cpl/CModule.h>
+#include <cpl/filesystem.h>
+#include <cpl/Misc.h>
+#include <cpl/simd.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	namespace fs = cpl::fs;
+	using Clock = std::chrono::steady_clock;
+
+	const char* Usage()
+	{
+		return
+			"usage: compile_latency [options] [scripts...]\n"
+			"\n"
+			"Compiles every script of the corpus cold and warm with CppAPE, and writes the\n"
+			"latencies of the phases as JSON (in milliseconds). Scripts given as arguments\n"
+			"are benchmarked instead of the corpus.\n"
+			"\n"
+			"options:\n"
+			"  --root <dir>      installation of APE (directory of the program)\n"
+			"  --corpus <dir>    scripts to benchmark besides the examples of the installation\n"
+			"                    (projects/benchmarks/corpus of the repository containing the\n"
+			"                    working directory)\n"
+			"  --runs <n>        warm compilations of every script (5)\n"
+			"  --quick           compile without optimizations, like quick builds in the editor\n"
+			"  --json <file>     where to write the results (standard output)\n";
+	}
+
+	double MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	class Compiler
+	{
+	public:
+
+		decltype(CreateProject) * createProject;
+		decltype(CompileProject) * compileProject;
+		decltype(InitProject) * initProject;
+		decltype(ReleaseProject) * releaseProject;
+		decltype(CleanCache) * cleanCache;
+
+		Compiler(const fs::path& root)
+		{
+			// see CompilerBinding
+			const auto directory = root / "compilers" / "CppAPE";
+
+			for (auto prefix : { "", "lib" })
+			{
+				for (auto extension : { ".dll", ".so", ".dylib" })
+				{
+					const auto candidate = directory / (std::string(prefix) + "CppAPE" + extension);
+					std::error_code ec;
+
+					if (!fs::is_regular_file(candidate, ec))
+						continue;
+
+					std::string error;
+
+					if (module.load(candidate.string(), error))
+						throw std::runtime_error("Error loading " + candidate.string() + ": " + error);
+
+					path = candidate;
+
+					createProject = resolve<decltype(CreateProject)>("CreateProject");
+					compileProject = resolve<decltype(CompileProject)>("CompileProject");
+					initProject = resolve<decltype(InitProject)>("InitProject");
+					releaseProject = resolve<decltype(ReleaseProject)>("ReleaseProject");
+					cleanCache = resolve<decltype(CleanCache)>("CleanCache");
+
+					return;
+				}
+			}
+
+			throw std::runtime_error("Unable to find the CppAPE module in " + directory.string());
+		}
+
+		const fs::path& getPath() const noexcept { return path; }
+
+	private:
+
+		template<typename Function>
+		Function * resolve(const char * name)
+		{
+			if (auto address = module.getFuncAddress(name))
+				return reinterpret_cast<Function *>(address);
+
+			throw std::runtime_error(std::string("Missing export ") + name + " in " + path.string());
+		}
+
+		cpl::CModule module;
+		fs::path path;
+	};
+
+	struct Script
+	{
+		std::string name;
+		fs::path path;
+		std::string source;
+	};
+
+	struct Measurement
+	{
+		double total = 0, compile = 0, init = 0;
+		APE_CompileTimings phases {};
+	};
+
+	using Field = std::pair<const char *, double (*)(const Measurement&)>;
+
+	const Field fields[] =
+	{
+		{ "total", [](const Measurement& m) { return m.total; } },
+		{ "compile", [](const Measurement& m) { return m.compile; } },
+		{ "init", [](const Measurement& m) { return m.init; } },
+		{ "environment", [](const Measurement& m) { return m.phases.environment; } },
+		{ "frontend", [](const Measurement& m) { return m.phases.frontend; } },
+		{ "load", [](const Measurement& m) { return m.phases.load; } },
+		{ "codegen", [](const Measurement& m) { return m.phases.codegen; } },
+		{ "prepareGlobals", [](const Measurement& m) { return m.phases.prepareGlobals; } },
+		{ "firstSymbol", [](const Measurement& m) { return m.phases.firstSymbol; } }
+	};
+
+	// errors of the compilation in progress
+	std::vector<std::string> errors;
+
+	void APE_API ReportDiagnostic(APE_Project *, APE_Diagnostic level, const char * message)
+	{
+		if (level == APE_Diag_Error || level == APE_Diag_CompilationError)
+			errors.emplace_back(message);
+	}
+
+	/// <summary>
+	/// Creates, compiles and initializes the script as a project like the plugin does, without activating it.
+	/// </summary>
+	Measurement Compile(Compiler& compiler, const Script& script, const fs::path& root, APE_Optimization_Level optimization)
+	{
+		const auto file = script.path.string();
+		const auto workingDirectory = script.path.parent_path().string();
+		const auto projectName = script.path.stem().string();
+		const auto rootPath = root.string();
+
+		std::vector<char> fileStorage(file.begin(), file.end());
+		fileStorage.push_back('\0');
+		char * const files[] = { fileStorage.data() };
+
+		APE_Project project {};
+		project.isSingleString = 1;
+		project.sourceString = script.source.c_str();
+		project.files = files;
+		project.nFiles = 1;
+		project.uniqueID = (unsigned)-1;
+		project.projectName = projectName.c_str();
+		project.workingDirectory = workingDirectory.c_str();
+		project.rootPath = rootPath.c_str();
+		project.reportDiagnostic = ReportDiagnostic;
+		project.floatPrecision = 32;
+		project.nativeVectorBitWidth = cpl::simd::max_vector_capacity<float>() * sizeof(float) * CHAR_BIT;
+		project.optimizationLevel = optimization;
+
+		errors.clear();
+
+		Measurement result;
+		const auto start = Clock::now();
+
+		if (compiler.createProject(&project) != STATUS_OK)
+			throw std::runtime_error("Unable to create a project");
+
+		struct Releaser
+		{
+			Compiler& compiler;
+			APE_Project& project;
+			~Releaser() { compiler.releaseProject(&project); }
+		} releaser { compiler, project };
+
+		auto check = [&](APE_Status status, const char * phase)
+		{
+			if (status == STATUS_OK)
+				return;
+
+			std::string message = std::string(phase) + " failed";
+
+			for (auto& error : errors)
+				message += "\n" + error;
+
+			throw std::runtime_error(message);
+		};
+
+		check(compiler.compileProject(&project), "Compilation");
+		result.compile = MillisecondsSince(start);
+
+		const auto initStart = Clock::now();
+		check(compiler.initProject(&project), "Initialization");
+		result.init = MillisecondsSince(initStart);
+
+		result.total = MillisecondsSince(start);
+		result.phases = project.timings;
+
+		return result;
+	}
+
+	Measurement Median(std::vector<Measurement> runs)
+	{
+		auto median = [&](auto&& member) -> double
+		{
+			std::vector<double> values;
+
+			for (auto& run : runs)
+				values.push_back(member(run));
+
+			std::sort(values.begin(), values.end());
+
+			const auto middle = values.size() / 2;
+			return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+		};
+
+		Measurement ret;
+		ret.total = median([](auto& m) { return m.total; });
+		ret.compile = median([](auto& m) { return m.compile; });
+		ret.init = median([](auto& m) { return m.init; });
+		ret.phases.environment = median([](auto& m) { return m.phases.environment; });
+		ret.phases.frontend = median([](auto& m) { return m.phases.frontend; });
+		ret.phases.load = median([](auto& m) { return m.phases.load; });
+		ret.phases.codegen = median([](auto& m) { return m.phases.codegen; });
+		ret.phases.prepareGlobals = median([](auto& m) { return m.phases.prepareGlobals; });
+		ret.phases.firstSymbol = median([](auto& m) { return m.phases.firstSymbol; });
+		ret.phases.cacheHits = runs.back().phases.cacheHits;
+		ret.phases.cacheMisses = runs.back().phases.cacheMisses;
+
+		return ret;
+	}
+
+	std::string Quoted(const std::string& text)
+	{
+		std::string ret = "\"";
+
+		for (auto c : text)
+		{
+			switch (c)
+			{
+			case '"': ret += "\\\""; break;
+			case '\\': ret += "\\\\"; break;
+			case '\n': ret += "\\n"; break;
+			case '\t': ret += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char buf[8];
+					std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+					ret += buf;
+				}
+				else
+				{
+					ret += c;
+				}
+			}
+		}
+
+		return ret + "\"";
+	}
+
+	void WriteMeasurement(std::ostream& json, const Measurement& m, const char * indent)
+	{
+		json << "{\n";
+
+		for (auto& field : fields)
+			json << indent << "\t" << Quoted(field.first) << ": " << field.second(m) << ",\n";
+
+		json << indent << "\t\"cacheHits\": " << m.phases.cacheHits << ",\n";
+		json << indent << "\t\"cacheMisses\": " << m.phases.cacheMisses << "\n";
+		json << indent << "}";
+	}
+
+	void AddScripts(std::vector<Script>& scripts, const fs::path& directory, const fs::path& nameRoot)
+	{
+		std::vector<fs::path> found;
+		std::error_code ec;
+
+		for (fs::recursive_directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+		{
+			const auto extension = it->path().extension();
+
+			if (extension == ".cpp" || extension == ".hpp")
+				found.push_back(it->path());
+		}
+
+		std::sort(found.begin(), found.end());
+
+		for (auto& path : found)
+		{
+			// the path below nameRoot
+			auto component = path.begin();
+
+			for (auto rootComponent = nameRoot.begin(); rootComponent != nameRoot.end() && component != path.end() && *rootComponent == *component; ++rootComponent)
+				++component;
+
+			fs::path name;
+
+			for (; component != path.end(); ++component)
+				name /= *component;
+
+			scripts.push_back({ name.generic_string(), path, {} });
+		}
+	}
+
+	// like tests::RepositoryRoot()
+	fs::path FindCorpus()
+	{
+		for (auto current = fs::current_path(); ; current = current.parent_path())
+		{
+			std::error_code ec;
+			const auto corpus = current / "projects" / "benchmarks" / "corpus";
+
+			if (fs::is_directory(corpus, ec))
+				return corpus;
+
+			if (!current.has_parent_path() || current.parent_path() == current)
+				return {};
+		}
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	fs::path root = cpl::Misc::DirFSPath(), corpus, jsonPath;
+	std::size_t runs = 5;
+	bool quick = false;
+	std::vector<Script> scripts;
+
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+
+			auto next = [&]() -> std::string
+			{
+				if (i + 1 >= argc)
+					throw std::invalid_argument("missing value for " + arg);
+
+				return argv[++i];
+			};
+
+			if (arg == "--root")
+				root = next();
+			else if (arg == "--corpus")
+				corpus = next();
+			else if (arg == "--runs")
+				runs = std::stoul(next());
+			else if (arg == "--quick")
+				quick = true;
+			else if (arg == "--json")
+				jsonPath = next();
+			else if (arg == "--help")
+				throw std::invalid_argument("");
+			else if (arg.size() > 1 && arg[0] == '-')
+				throw std::invalid_argument("unknown option " + arg);
+			else
+				scripts.push_back({ fs::path(arg).filename().string(), fs::absolute(arg), {} });
+		}
+
+		if (runs == 0)
+			throw std::invalid_argument("at least one warm run is needed");
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s%s%s", e.what(), *e.what() ? "\n\n" : "", Usage());
+		return 2;
+	}
+
+	try
+	{
+		if (scripts.empty())
+		{
+			if (corpus.empty())
+				corpus = FindCorpus();
+
+			if (corpus.empty())
+				throw std::runtime_error("Unable to find the corpus, specify it with --corpus");
+
+			AddScripts(scripts, fs::absolute(corpus), fs::absolute(corpus));
+			AddScripts(scripts, root / "examples", root);
+		}
+
+		for (auto& script : scripts)
+		{
+			std::ifstream stream(script.path.string(), std::ios::binary);
+
+			if (!stream.good())
+				throw std::runtime_error("Unable to read " + script.path.string());
+
+			script.source.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		}
+
+		Compiler compiler(root);
+		const auto optimization = quick ? APE_Optimization_Debug : APE_Optimization_Best;
+
+		std::ostringstream json;
+		json << std::fixed << std::setprecision(3);
+
+		const auto now = std::time(nullptr);
+		char timestamp[32];
+		std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+		json << "{\n";
+		json << "\t\"benchmark\": \"compile-latency\",\n";
+		json << "\t\"timestamp\": " << Quoted(timestamp) << ",\n";
+		json << "\t\"compiler\": " << Quoted(compiler.getPath().string()) << ",\n";
+		json << "\t\"optimization\": " << Quoted(quick ? "quick" : "best") << ",\n";
+		json << "\t\"warmRuns\": " << runs << ",\n";
+		json << "\t\"unit\": \"ms\",\n";
+		json << "\t\"scripts\": [";
+
+		bool failed = false;
+
+		for (std::size_t i = 0; i < scripts.size(); ++i)
+		{
+			auto& script = scripts[i];
+
+			json << (i ? "," : "") << "\n\t\t{\n";
+			json << "\t\t\t\"name\": " << Quoted(script.name) << ",\n";
+			json << "\t\t\t\"bytes\": " << script.source.size() << ",\n";
+
+			std::fprintf(stderr, "%-40s ", script.name.c_str());
+
+			try
+			{
+				// cleans the compile cache and the precompiled header, so the environment is set up again
+				if (compiler.cleanCache() != STATUS_OK)
+					throw std::runtime_error("Unable to clean the compiler cache");
+
+				const auto cold = Compile(compiler, script, root, optimization);
+
+				// a stale entry surviving the clean would make the cold run a warm one
+				if (cold.phases.cacheHits != 0)
+					throw std::runtime_error("The cold compilation hit the cache " + std::to_string(cold.phases.cacheHits) + " times after cleaning it");
+
+				std::vector<Measurement> warm;
+
+				for (std::size_t run = 0; run < runs; ++run)
+					warm.push_back(Compile(compiler, script, root, optimization));
+
+				const auto median = Median(warm);
+				const auto fastest = *std::min_element(warm.begin(), warm.end(), [](auto& a, auto& b) { return a.total < b.total; });
+
+				json << "\t\t\t\"cold\": ";
+				WriteMeasurement(json, cold, "\t\t\t");
+				json << ",\n\t\t\t\"warm\": {\n\t\t\t\t\"median\": ";
+				WriteMeasurement(json, median, "\t\t\t\t");
+				json << ",\n\t\t\t\t\"fastest\": ";
+				WriteMeasurement(json, fastest, "\t\t\t\t");
+				json << "\n\t\t\t}\n";
+
+				std::fprintf(stderr, "cold %9.1f ms, warm %9.1f ms (first symbol %7.1f ms)\n", cold.total, median.total, cold.phases.firstSymbol);
+			}
+			catch (const std::exception& e)
+			{
+				failed = true;
+				json << "\t\t\t\"error\": " << Quoted(e.what()) << "\n";
+				std::fprintf(stderr, "error: %s\n", e.what());
+			}
+
+			json << "\t\t}";
+		}
+
+		json << "\n\t]\n}\n";
+
+		if (jsonPath.empty())
+		{
+			std::cout << json.str();
+		}
+		else
+		{
+			std::ofstream file(jsonPath.string(), std::ios::trunc);
+
+			if (!(file << json.str()))
+				throw std::runtime_error("Unable to write " + jsonPath.string());
+		}
+
+		return failed ? 1 : 0;
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "compile_latency: %s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,495 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:HostOverhead.cpp
+		
+		Benchmarks the overhead of the engine around scripts, by running
+		Engine::processBlock() in a tight loop as a synthetic host, with a compiled
+		script passing its inputs through.
+		
+		Channel counts, block sizes, an attached oscilloscope and active traces
+		are swept, reporting the time per block spent in every phase of the engine
+		(see Engine::BlockPhaseTimings) as JSON, so regressions can be tracked over
+		time.
+
+*************************************************************************************/
+
+
+#include <Engine.h>
+#include <PluginState.h>
+#include <ProjectEx.h>
+#include <UIController.h>
+#include <CConsole.h>
+#include <UI/UICommands.h>
+#include <cpl/Misc.h>
+#include <cpl/simd.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace ape;
+	using Clock = std::chrono::steady_clock;
+
+	const char* Usage()
+	{
+		return
+			"usage: host_overhead [options]\n"
+			"\n"
+			"Runs the engine as a host would, with a script passing audio through, and writes\n"
+			"the time spent per block in the phases of the engine as JSON (in nanoseconds).\n"
+			"Every combination of channels, block sizes, scope and traces is measured.\n"
+			"The program must reside next to the configuration and compilers of APE.\n"
+			"\n"
+			"options:\n"
+			"  --channels <list>   comma separated input and output channels (1,2,8,16,32,64)\n"
+			"  --blocks <list>     comma separated frames per block (16,64,256,1024,4096)\n"
+			"  --traces <n>        traced statements in the script, measured besides none (8)\n"
+			"  --no-scope          only measure without the oscilloscope attached\n"
+			"  --rate <hz>         sample rate of the engine (48000)\n"
+			"  --time <ms>         time to process every combination for (100)\n"
+			"  --quick             compile without optimizations\n"
+			"  --quiet             don't print the console of the engine\n"
+			"  --json <file>       where to write the results (standard output)\n";
+	}
+
+	struct Options
+	{
+		std::vector<std::size_t> channels { 1, 2, 8, 16, 32, 64 };
+		std::vector<std::size_t> blocks { 16, 64, 256, 1024, 4096 };
+		std::size_t traces = 8;
+		bool scope = true;
+		double sampleRate = 48000;
+		double milliseconds = 100;
+		bool quick = false, quiet = false;
+		std::string jsonPath;
+	};
+
+	struct Measurement
+	{
+		std::size_t channels, blockSize, traces;
+		bool scope;
+		Engine::BlockPhaseTimings timings;
+	};
+
+	std::vector<std::size_t> ParseList(const std::string& list)
+	{
+		std::vector<std::size_t> ret;
+		std::istringstream stream(list);
+		std::string element;
+
+		while (std::getline(stream, element, ','))
+		{
+			const auto value = std::stoul(element);
+
+			if (value == 0)
+				throw std::invalid_argument("zero in list " + list);
+
+			ret.push_back(value);
+		}
+
+		if (ret.empty())
+			throw std::invalid_argument("empty list");
+
+		return ret;
+	}
+
+	/// <summary>
+	/// Writes a script copying its inputs to its outputs, with <paramref name="traces"/> traced statements
+	/// for every sample of the first channel. Returns the lines to trace.
+	/// </summary>
+	std::vector<int> WritePassthrough(const juce::File& file, std::size_t traces)
+	{
+		std::vector<std::string> lines
+		{
+			"#include <effect.h>",
+			"",
+			"GlobalData(HostOverhead, \"\");",
+			"",
+			"class HostOverhead : public ape::Effect",
+			"{",
+			"	void process(ape::umatrix<const float> inputs, ape::umatrix<float> outputs, size_t frames) override",
+			"	{",
+			"		const auto shared = sharedChannels();",
+			"",
+			"		for (std::size_t c = 0; c < shared; ++c)",
+			"		{",
+			"			for (std::size_t n = 0; n < frames; ++n)",
+			"				outputs[c][n] = inputs[c][n];",
+			"		}",
+			"",
+			"		clear(outputs, shared);",
+			"",
+			"		for (std::size_t n = 0; shared > 0 && n < frames; ++n)",
+			"		{",
+			"			const float x = inputs[0][n];"
+		};
+
+		std::vector<int> traced;
+
+		// distinct expressions, so every statement is a trace of its own
+		for (std::size_t i = 0; i < traces; ++i)
+		{
+			traced.push_back(static_cast<int>(lines.size()));
+			lines.push_back("			x * " + std::to_string(i + 1) + ";");
+		}
+
+		lines.insert(lines.end(), { "		}", "	}", "};", "" });
+
+		std::string source;
+
+		for (auto& line : lines)
+			source += line + "\n";
+
+		if (!file.replaceWithText(source))
+			throw std::runtime_error("Unable to write " + file.getFullPathName().toStdString());
+
+		return traced;
+	}
+
+	// see OfflineRender's CreateProject()
+	std::unique_ptr<ProjectEx> CreateProject(const juce::File& script, const std::vector<int>& traced, bool quick)
+	{
+		auto copyString = [](const std::string& orig)
+		{
+			auto pointer = new char[orig.size() + 1];
+			std::copy(orig.begin(), orig.end(), pointer);
+			pointer[orig.size()] = '\0';
+			return pointer;
+		};
+
+		auto project = std::make_unique<ProjectEx>();
+
+		project->files = new char *[1];
+		project->files[0] = copyString(script.getFullPathName().toStdString());
+		project->nFiles = 1;
+		project->uniqueID = (unsigned)-1;
+		project->isSingleString = true;
+
+		project->workingDirectory = copyString(script.getParentDirectory().getFullPathName().toStdString());
+		project->sourceString = copyString(script.loadFileAsString().toStdString());
+		project->projectName = copyString(script.getFileNameWithoutExtension().toStdString());
+		project->rootPath = copyString(cpl::Misc::DirectoryPath());
+		project->languageID = copyString("cpp");
+
+		if (!traced.empty())
+		{
+			project->traceLines = new int[traced.size()];
+			std::copy(traced.begin(), traced.end(), project->traceLines);
+			project->numTraceLines = traced.size();
+		}
+
+		project->floatPrecision = 32;
+		project->nativeVectorBitWidth = cpl::simd::max_vector_capacity<float>() * sizeof(float) * CHAR_BIT;
+		project->optimizationLevel = quick ? APE_Optimization_Debug : APE_Optimization_Best;
+
+		return project;
+	}
+
+	/// <summary>
+	/// Compiles the script and activates it in the engine through the controller, like the editor does.
+	/// The engine picks it up on the next processed block.
+	/// </summary>
+	void Install(Engine& engine, const juce::File& script, std::size_t traces, bool quick)
+	{
+		const auto traced = WritePassthrough(script, traces);
+
+		// throws on compilation errors, which are printed to the console
+		auto plugin = std::make_shared<PluginState>(engine, engine.getCodeGenerator(), CreateProject(script, traced, quick));
+
+		auto& controller = engine.getController();
+		controller.setPlugin(std::move(plugin));
+		controller.performCommand(UICommand::Activate);
+
+		if (!engine.isProcessingAPlugin())
+			throw std::runtime_error("Error activating the script");
+	}
+
+	void Configure(Engine& engine, std::size_t channels, std::size_t blockSize, double sampleRate)
+	{
+		// like a host changing the configuration, which also reconfigures the script
+		juce::AudioProcessor& processor = engine;
+
+		processor.releaseResources();
+		processor.setPlayConfigDetails(static_cast<int>(channels), static_cast<int>(channels), sampleRate, static_cast<int>(blockSize));
+		processor.prepareToPlay(sampleRate, static_cast<int>(blockSize));
+	}
+
+	Measurement Measure(Engine& engine, std::size_t channels, std::size_t blockSize, double milliseconds)
+	{
+		juce::AudioProcessor& processor = engine;
+		juce::AudioBuffer<float> buffer(static_cast<int>(channels), static_cast<int>(blockSize));
+		juce::MidiBuffer midi;
+
+		std::mt19937 generator(channels * blockSize);
+		std::uniform_real_distribution<float> noise(-1, 1);
+
+		for (int c = 0; c < buffer.getNumChannels(); ++c)
+		{
+			for (int n = 0; n < buffer.getNumSamples(); ++n)
+				buffer.setSample(c, n, noise(generator));
+		}
+
+		// exchanges plugins, fades them in and lets the scope and tracer settle
+		for (int i = 0; i < 32; ++i)
+			processor.processBlock(buffer, midi);
+
+		engine.pulse();
+
+		Measurement ret {};
+		engine.setBlockPhaseTimings(&ret.timings);
+
+		const auto budget = std::chrono::duration<double, std::milli>(milliseconds);
+		const auto start = Clock::now();
+
+		do
+		{
+			for (int i = 0; i < 64; ++i)
+				processor.processBlock(buffer, midi);
+
+			// between blocks, like the message thread of a host
+			engine.setBlockPhaseTimings(nullptr);
+			engine.pulse();
+			engine.setBlockPhaseTimings(&ret.timings);
+
+		} while (Clock::now() - start < budget);
+
+		engine.setBlockPhaseTimings(nullptr);
+
+		ret.channels = channels;
+		ret.blockSize = blockSize;
+
+		return ret;
+	}
+
+	double PerBlock(const Measurement& m, std::uint64_t Engine::BlockPhaseTimings::* phase)
+	{
+		return static_cast<double>(m.timings.*phase) / m.timings.blocks;
+	}
+
+	double Other(const Measurement& m)
+	{
+		const auto& t = m.timings;
+		const auto phases = t.copies + t.commands + t.plugin + t.scope;
+
+		return t.total > phases ? static_cast<double>(t.total - phases) / t.blocks : 0;
+	}
+
+	std::string Quoted(const std::string& text)
+	{
+		std::string ret = "\"";
+
+		for (auto c : text)
+		{
+			if (c == '"' || c == '\\')
+				ret += '\\';
+
+			ret += c;
+		}
+
+		return ret + "\"";
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	Options options;
+
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+
+			auto next = [&]() -> std::string
+			{
+				if (i + 1 >= argc)
+					throw std::invalid_argument("missing value for " + arg);
+
+				return argv[++i];
+			};
+
+			if (arg == "--channels")
+				options.channels = ParseList(next());
+			else if (arg == "--blocks")
+				options.blocks = ParseList(next());
+			else if (arg == "--traces")
+				options.traces = std::stoul(next());
+			else if (arg == "--no-scope")
+				options.scope = false;
+			else if (arg == "--rate")
+				options.sampleRate = std::stod(next());
+			else if (arg == "--time")
+				options.milliseconds = std::stod(next());
+			else if (arg == "--quick")
+				options.quick = true;
+			else if (arg == "--quiet")
+				options.quiet = true;
+			else if (arg == "--json")
+				options.jsonPath = next();
+			else if (arg == "--help")
+				throw std::invalid_argument("");
+			else
+				throw std::invalid_argument("unknown option " + arg);
+		}
+
+		if (options.sampleRate <= 0)
+			throw std::invalid_argument("the sample rate must be positive");
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s%s%s", e.what(), *e.what() ? "\n\n" : "", Usage());
+		return 2;
+	}
+
+	// message manager and such, no display is opened
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+	try
+	{
+		Engine engine;
+		engine.getController().getConsole().setStdWriting(!options.quiet);
+
+		const auto script = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("host_overhead.cpp");
+
+		std::vector<std::size_t> traceCounts { 0 };
+
+		if (options.traces)
+			traceCounts.push_back(options.traces);
+
+		std::vector<Measurement> results;
+
+		// installing and configuring needs the engine to play
+		Configure(engine, options.channels.front(), options.blocks.front(), options.sampleRate);
+
+		for (auto traces : traceCounts)
+		{
+			Install(engine, script, traces, options.quick);
+
+			for (int withScope = 0; withScope < (options.scope ? 2 : 1); ++withScope)
+			{
+				// the view only listens to the stream of the engine, nothing is displayed
+				std::unique_ptr<juce::Component> scopeWindow;
+
+				if (withScope)
+				{
+					scopeWindow = engine.getOscilloscopeData().createWindow();
+					scopeWindow->setVisible(true);
+				}
+
+				for (auto channels : options.channels)
+				{
+					for (auto blockSize : options.blocks)
+					{
+						Configure(engine, channels, blockSize, options.sampleRate);
+
+						auto m = Measure(engine, channels, blockSize, options.milliseconds);
+						m.traces = traces;
+						m.scope = withScope != 0;
+
+						std::fprintf(
+							stderr, "%3zu channels, %4zu frames, %s, %2zu traces: %10.0f ns/block (copies %8.0f, commands %6.0f, plugin %9.0f, scope %8.0f)\n",
+							channels, blockSize, m.scope ? "scope   " : "no scope", traces,
+							PerBlock(m, &Engine::BlockPhaseTimings::total),
+							PerBlock(m, &Engine::BlockPhaseTimings::copies),
+							PerBlock(m, &Engine::BlockPhaseTimings::commands),
+							PerBlock(m, &Engine::BlockPhaseTimings::plugin),
+							PerBlock(m, &Engine::BlockPhaseTimings::scope)
+						);
+
+						results.push_back(m);
+					}
+				}
+			}
+		}
+
+		static_cast<juce::AudioProcessor&>(engine).releaseResources();
+		script.deleteFile();
+
+		std::ostringstream json;
+		json << std::fixed << std::setprecision(1);
+
+		const auto now = std::time(nullptr);
+		char timestamp[32];
+		std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+		json << "{\n";
+		json << "\t\"benchmark\": \"host-overhead\",\n";
+		json << "\t\"timestamp\": " << Quoted(timestamp) << ",\n";
+		json << "\t\"optimization\": " << Quoted(options.quick ? "quick" : "best") << ",\n";
+		json << "\t\"sampleRate\": " << options.sampleRate << ",\n";
+		json << "\t\"unit\": \"ns/block\",\n";
+		json << "\t\"configurations\": [";
+
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			auto& m = results[i];
+
+			json << (i ? "," : "") << "\n\t\t{\n";
+			json << "\t\t\t\"channels\": " << m.channels << ",\n";
+			json << "\t\t\t\"blockSize\": " << m.blockSize << ",\n";
+			json << "\t\t\t\"scopeAttached\": " << (m.scope ? "true" : "false") << ",\n";
+			json << "\t\t\t\"traces\": " << m.traces << ",\n";
+			json << "\t\t\t\"blocks\": " << m.timings.blocks << ",\n";
+			json << "\t\t\t\"total\": " << PerBlock(m, &Engine::BlockPhaseTimings::total) << ",\n";
+			json << "\t\t\t\"copies\": " << PerBlock(m, &Engine::BlockPhaseTimings::copies) << ",\n";
+			json << "\t\t\t\"commands\": " << PerBlock(m, &Engine::BlockPhaseTimings::commands) << ",\n";
+			json << "\t\t\t\"plugin\": " << PerBlock(m, &Engine::BlockPhaseTimings::plugin) << ",\n";
+			json << "\t\t\t\"scope\": " << PerBlock(m, &Engine::BlockPhaseTimings::scope) << ",\n";
+			json << "\t\t\t\"other\": " << Other(m) << "\n";
+			json << "\t\t}";
+		}
+
+		json << "\n\t]\n}\n";
+
+		if (options.jsonPath.empty())
+		{
+			std::cout << json.str();
+		}
+		else
+		{
+			std::ofstream file(options.jsonPath, std::ios::trunc);
+
+			if (!(file << json.str()))
+				throw std::runtime_error("Unable to write " + options.jsonPath);
+		}
+
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "host_overhead: %s: %s\n", cpl::Misc::DemangledTypeName(e).c_str(), e.what());
+		return 1;
+	}
+}
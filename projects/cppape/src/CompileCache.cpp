@@ -0,0 +1,524 @@
+/*************************************************************************************
+
+	C++ compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:CompileCache.cpp
+
+		Implementation of CompileCache.h
+
+*************************************************************************************/
+
+#include "CompileCache.h"
+#include <cpl/MacroConstants.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <system_error>
+
+#ifdef CPL_WINDOWS
+	#include <Windows.h>
+#else
+	#include <cerrno>
+	#include <signal.h>
+	#include <unistd.h>
+#endif
+
+namespace CppAPE
+{
+	namespace
+	{
+		const char* diagnosticsExtension = ".diag";
+		const char* manifestExtension = ".deps";
+		const char* stagingExtension = ".tmp";
+		const char* loadExtension = ".load";
+
+		// distinguishes staged files of threads and processes compiling the same entry at the same time
+		const std::string& stagingSuffix()
+		{
+			static thread_local const std::string suffix = []
+			{
+				std::random_device device;
+				char buf[24];
+				std::snprintf(buf, sizeof(buf), ".%08x%08x", device(), device());
+				return std::string(buf);
+			}();
+
+			return suffix;
+		}
+
+		unsigned long currentProcess()
+		{
+		#ifdef CPL_WINDOWS
+			return GetCurrentProcessId();
+		#else
+			return static_cast<unsigned long>(getpid());
+		#endif
+		}
+
+		bool isRunning(unsigned long process)
+		{
+		#ifdef CPL_WINDOWS
+			HANDLE handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(process));
+
+			if (!handle)
+				return GetLastError() == ERROR_ACCESS_DENIED;
+
+			DWORD code = 0;
+			const bool running = GetExitCodeProcess(handle, &code) && code == STILL_ACTIVE;
+			CloseHandle(handle);
+			return running;
+		#else
+			return kill(static_cast<pid_t>(process), 0) == 0 || errno == EPERM;
+		#endif
+		}
+
+		// copies to load from are named <key>.<process>.<random>.load, see loadPath()
+		bool isInUse(const fs::path& copy)
+		{
+			const auto name = copy.stem().string();
+			const auto first = name.find('.');
+
+			if (first == std::string::npos)
+				return false;
+
+			const auto process = std::strtoul(name.c_str() + first + 1, nullptr, 10);
+			return process != 0 && isRunning(process);
+		}
+
+		bool readFile(const fs::path& file, std::string& contents)
+		{
+			std::ifstream stream(file.string().c_str(), std::ios::binary);
+
+			if (!stream.good())
+				return false;
+
+			contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+			return !stream.bad();
+		}
+
+		// the prerequisites of the make rule the compiler writes for -MD: "target: main.cpp header.h" continued over
+		// lines ending in backslashes, with spaces in names escaped.
+		std::vector<std::string> parseDependencies(const std::string& rule)
+		{
+			std::vector<std::string> words;
+			std::string word;
+
+			auto flush = [&]
+			{
+				if (!word.empty())
+					words.emplace_back(std::move(word));
+
+				word.clear();
+			};
+
+			for (std::size_t i = 0; i < rule.size(); ++i)
+			{
+				const auto c = rule[i];
+				const auto next = i + 1 < rule.size() ? rule[i + 1] : '\0';
+
+				if (c == '\\' && (next == '\n' || next == '\r'))
+				{
+					flush();
+				}
+				else if (c == '\\' && (next == ' ' || next == '#'))
+				{
+					word += next;
+					++i;
+				}
+				else if (c == '$' && next == '$')
+				{
+					word += '$';
+					++i;
+				}
+				else if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+				{
+					flush();
+				}
+				else
+				{
+					// windows paths keep their backslashes
+					word += c;
+				}
+			}
+
+			flush();
+
+			const auto target = std::find_if(words.begin(), words.end(), [](const std::string& w) { return w.back() == ':'; });
+
+			if (target == words.end())
+				return {};
+
+			return { target + 1, words.end() };
+		}
+	}
+
+	ContentHash& ContentHash::add(const void* data, std::size_t size) noexcept
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			// two independent lanes: FNV-1a and a multiply-xorshift mix
+			a = (a ^ bytes[i]) * 0x100000001b3ull;
+			b = (b + bytes[i] + 1) * 0xff51afd7ed558ccdull;
+			b ^= b >> 29;
+		}
+
+		length += size;
+		return *this;
+	}
+
+	ContentHash& ContentHash::add(const std::string& text) noexcept
+	{
+		// length prefixed, so consecutive strings can't be confused with each other
+		add(static_cast<std::uint64_t>(text.size()));
+		return add(text.data(), text.size());
+	}
+
+	ContentHash& ContentHash::add(std::uint64_t value) noexcept
+	{
+		unsigned char bytes[sizeof(value)];
+
+		for (std::size_t i = 0; i < sizeof(value); ++i)
+			bytes[i] = static_cast<unsigned char>(value >> (i * 8));
+
+		return add(bytes, sizeof(bytes));
+	}
+
+	bool ContentHash::addFile(const fs::path& file)
+	{
+		add(file.string());
+
+		std::string contents;
+
+		if (!readFile(file, contents))
+		{
+			add(std::uint64_t(0));
+			return false;
+		}
+
+		add(contents);
+		return true;
+	}
+
+	void ContentHash::addFileStamp(const fs::path& file)
+	{
+		std::error_code ec;
+
+		add(file.string());
+
+		const auto size = fs::file_size(file, ec);
+		add(ec ? std::uint64_t(0) : static_cast<std::uint64_t>(size));
+
+		const auto time = fs::last_write_time(file, ec);
+		add(ec ? std::uint64_t(0) : static_cast<std::uint64_t>(time.time_since_epoch().count()));
+	}
+
+	std::string ContentHash::toString() const
+	{
+		auto finalize = [this](std::uint64_t h)
+		{
+			h ^= length;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53ull;
+			h ^= h >> 33;
+			return h;
+		};
+
+		char buf[33];
+		std::snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)finalize(a), (unsigned long long)finalize(b));
+		return buf;
+	}
+
+	CompileCache::CompileCache(fs::path cacheDirectory, std::uint64_t maxBytes, std::size_t maxEntries, std::string entryExtension)
+		: directory(std::move(cacheDirectory))
+		, maxBytes(maxBytes)
+		, maxEntries(maxEntries)
+		, extension(std::move(entryExtension))
+	{
+		std::error_code ec;
+		fs::create_directories(directory, ec);
+	}
+
+	std::string CompileCache::resolve(const ContentHash& inputs)
+	{
+		std::error_code ec;
+		const auto manifest = manifestPath(inputs);
+		std::ifstream stream(manifest.string().c_str(), std::ios::binary);
+
+		if (!stream.good())
+			return {};
+
+		auto key = inputs;
+		std::string dependency;
+
+		while (std::getline(stream, dependency))
+			key.addFile(dependency);
+
+		fs::last_write_time(manifest, fs::file_time_type::clock::now(), ec);
+
+		return key.toString();
+	}
+
+	std::string CompileCache::record(const ContentHash& inputs, const fs::path& dependencyFile)
+	{
+		std::string rule;
+		std::error_code ec;
+
+		const bool read = readFile(dependencyFile, rule);
+		fs::remove(dependencyFile, ec);
+
+		auto dependencies = parseDependencies(rule);
+
+		if (!read || dependencies.empty())
+			return {};
+
+		// the main file is hashed by the caller, and may not even exist on disk
+		dependencies.erase(dependencies.begin());
+
+		auto key = inputs;
+		const auto staged = directory / (inputs.toString() + manifestExtension + stagingSuffix() + stagingExtension);
+
+		{
+			std::ofstream stream(staged.string().c_str(), std::ios::binary | std::ios::trunc);
+
+			for (auto& dependency : dependencies)
+			{
+				stream << dependency << "\n";
+				key.addFile(dependency);
+			}
+		}
+
+		fs::rename(staged, manifestPath(inputs), ec);
+
+		if (ec)
+		{
+			fs::remove(staged, ec);
+			return {};
+		}
+
+		return key.toString();
+	}
+
+	fs::path CompileCache::dependencyPath() const
+	{
+		return directory / ("dependencies" + stagingSuffix() + stagingExtension);
+	}
+
+	fs::path CompileCache::loadPath(const std::string& key) const
+	{
+		std::random_device device;
+		char buf[40];
+		std::snprintf(buf, sizeof(buf), ".%lu.%08x%08x", currentProcess(), device(), device());
+
+		return directory / (key + buf + loadExtension);
+	}
+
+	fs::path CompileCache::lookup(const std::string& key, std::vector<CompileCache::Diagnostic>& diagnostics)
+	{
+		std::error_code ec;
+		const auto entry = entryPath(key);
+
+		if (!fs::is_regular_file(entry, ec))
+			return {};
+
+		diagnostics.clear();
+
+		if (std::ifstream stream(diagnosticsPath(key).string().c_str(), std::ios::binary); stream.good())
+		{
+			int level;
+			std::size_t size;
+
+			while (stream >> level >> size && stream.get() == '\n')
+			{
+				std::string message(size, '\0');
+
+				if (!stream.read(&message[0], size))
+					break;
+
+				diagnostics.push_back({ static_cast<APE_Diagnostic>(level), std::move(message) });
+			}
+		}
+
+		// the modification time doubles as the time of last use
+		fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+
+		return entry;
+	}
+
+	fs::path CompileCache::stagingPath(const std::string& key) const
+	{
+		return directory / (key + extension + stagingSuffix() + stagingExtension);
+	}
+
+	void CompileCache::insert(const std::string& key, const std::vector<CompileCache::Diagnostic>& diagnostics)
+	{
+		std::error_code ec;
+		const auto stagedDiagnostics = directory / (key + diagnosticsExtension + stagingSuffix() + stagingExtension);
+
+		{
+			std::ofstream stream(stagedDiagnostics.string().c_str(), std::ios::binary | std::ios::trunc);
+
+			for (auto& diagnostic : diagnostics)
+				stream << static_cast<int>(diagnostic.level) << " " << diagnostic.message.size() << "\n" << diagnostic.message;
+		}
+
+		// renames are atomic, and the output is moved in last, so an entry is never visible before it's complete.
+		// another thread or process may have completed the same entry meanwhile, in which case this simply replaces it.
+		fs::rename(stagedDiagnostics, diagnosticsPath(key), ec);
+
+		if (!ec)
+			fs::rename(stagingPath(key), entryPath(key), ec);
+
+		if (ec)
+		{
+			remove(key);
+			return;
+		}
+
+		evict();
+	}
+
+	void CompileCache::remove(const std::string& key)
+	{
+		std::error_code ec;
+		fs::remove(entryPath(key), ec);
+		fs::remove(diagnosticsPath(key), ec);
+		fs::remove(stagingPath(key), ec);
+		fs::remove(directory / (key + diagnosticsExtension + stagingSuffix() + stagingExtension), ec);
+	}
+
+	void CompileCache::clear()
+	{
+		std::error_code ec;
+
+		for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+		{
+			// other caches nested in this one are cleared by their owners. files in use can't be removed
+			// on some systems, which mustn't stop the rest from being removed.
+			std::error_code entryError;
+
+			if (!it->is_directory(entryError))
+				fs::remove(it->path(), entryError);
+		}
+	}
+
+	fs::path CompileCache::entryPath(const std::string& key) const
+	{
+		return directory / (key + extension);
+	}
+
+	fs::path CompileCache::diagnosticsPath(const std::string& key) const
+	{
+		return directory / (key + diagnosticsExtension);
+	}
+
+	fs::path CompileCache::manifestPath(const ContentHash& inputs) const
+	{
+		return directory / (inputs.toString() + manifestExtension);
+	}
+
+	void CompileCache::evict()
+	{
+		struct Entry
+		{
+			std::string key;
+			fs::file_time_type lastUse;
+			std::uint64_t size;
+		};
+
+		std::vector<Entry> entries;
+		std::uint64_t totalSize = 0;
+		std::error_code ec;
+
+		for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+		{
+			const auto& path = it->path();
+
+			if (path.extension() == stagingExtension)
+			{
+				// left behind by a compiler that crashed or was killed while compiling
+				std::error_code stagingError;
+
+				if (fs::last_write_time(path, stagingError) < fs::file_time_type::clock::now() - std::chrono::hours(1) && !stagingError)
+					fs::remove(path, stagingError);
+
+				continue;
+			}
+
+			if (path.extension() == loadExtension)
+			{
+				// left behind by a process that crashed while the copy was loaded
+				std::error_code loadError;
+
+				if (!isInUse(path))
+					fs::remove(path, loadError);
+
+				continue;
+			}
+
+			if (path.extension() == manifestExtension)
+			{
+				// resolving touches them, so these are for sources no longer compiled
+				std::error_code manifestError;
+
+				if (fs::last_write_time(path, manifestError) < fs::file_time_type::clock::now() - std::chrono::hours(24 * 30) && !manifestError)
+					fs::remove(path, manifestError);
+
+				continue;
+			}
+
+			if (path.extension() != extension)
+				continue;
+
+			std::error_code entryError;
+			Entry entry { path.stem().string(), fs::last_write_time(path, entryError), fs::file_size(path, entryError) };
+
+			if (entryError)
+				continue;
+
+			totalSize += entry.size;
+			entries.push_back(std::move(entry));
+		}
+
+		if (totalSize <= maxBytes && entries.size() <= maxEntries)
+			return;
+
+		std::sort(entries.begin(), entries.end(), [](const Entry& left, const Entry& right) { return left.lastUse < right.lastUse; });
+
+		auto remaining = entries.size();
+
+		for (auto& entry : entries)
+		{
+			if (totalSize <= maxBytes && remaining <= maxEntries)
+				break;
+
+			remove(entry.key);
+			totalSize -= entry.size;
+			remaining--;
+		}
+	}
+};
@@ -0,0 +1,171 @@
+/*************************************************************************************
+
+	C++ Compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:CompileCache.h
+
+		Persistent, content-addressed cache of compiled translation units.
+		Entries are bitcode files (or other compiled code, like shared objects)
+		named by a hash of everything that went into the compilation, together
+		with the diagnostics emitted at the time. Headers are part of the hash
+		through the dependencies the compiler reported for the last compilation of
+		the same source, kept in a manifest per source.
+		The least recently used entries are evicted when the cache grows too big.
+
+		Safe to share between threads and processes: new entries are staged in
+		private files and moved into place atomically. An entry may be evicted by
+		someone else between lookup and use, in which case loading it simply fails.
+
+*************************************************************************************/
+#ifndef CPPAPE_COMPILECACHE_H
+#define CPPAPE_COMPILECACHE_H
+
+#include <ape/SharedInterface.h>
+#include <cpl/filesystem.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CppAPE
+{
+	namespace fs = cpl::fs;
+
+	/// <summary>
+	/// 128-bit non-cryptographic hash, for addressing content.
+	/// </summary>
+	class ContentHash
+	{
+	public:
+
+		ContentHash& add(const void* data, std::size_t size) noexcept;
+		ContentHash& add(const std::string& text) noexcept;
+		ContentHash& add(std::uint64_t value) noexcept;
+
+		/// <summary>
+		/// Hashes the contents of <paramref name="file"/>, and the file name.
+		/// Returns false (and hashes the name only) if the file couldn't be read.
+		/// </summary>
+		bool addFile(const fs::path& file);
+
+		/// <summary>
+		/// Hashes the size and modification time of <paramref name="file"/>, for files too big to hash
+		/// the contents of on every compilation.
+		/// </summary>
+		void addFileStamp(const fs::path& file);
+
+		std::string toString() const;
+
+	private:
+
+		std::uint64_t a = 0xcbf29ce484222325ull, b = 0x9e3779b97f4a7c15ull, length = 0;
+	};
+
+	class CompileCache
+	{
+	public:
+
+		struct Diagnostic
+		{
+			APE_Diagnostic level;
+			std::string message;
+		};
+
+		static constexpr std::uint64_t defaultMaxBytes = 256ull << 20;
+		static constexpr std::size_t defaultMaxEntries = 512;
+
+		/// <summary>
+		/// Entries are files ending in <paramref name="entryExtension"/>. Caches of different kinds of output
+		/// should use different directories.
+		/// </summary>
+		CompileCache(fs::path directory, std::uint64_t maxBytes = defaultMaxBytes, std::size_t maxEntries = defaultMaxEntries, std::string entryExtension = ".bc");
+
+		/// <summary>
+		/// Completes the hash of the <paramref name="inputs"/> of a compilation (the source, the arguments and the compiler)
+		/// with the contents of every file the compiler read when the same inputs were last compiled, see record().
+		/// Returns the key of the entry, or an empty string if the inputs were never compiled.
+		/// </summary>
+		std::string resolve(const ContentHash& inputs);
+
+		/// <summary>
+		/// Remembers the files listed in the make rule at <paramref name="dependencyFile"/> (written by the compiler for -MD)
+		/// as the dependencies of the <paramref name="inputs"/>, and returns the key of the entry as resolve() will from now on.
+		/// The first dependency is the main source file, which is part of the inputs already.
+		/// Returns an empty string if the file couldn't be read.
+		/// </summary>
+		std::string record(const ContentHash& inputs, const fs::path& dependencyFile);
+
+		/// <summary>
+		/// Where the compiler should write dependencies to (see -MF), before passing them to <see cref="record()"/>.
+		/// The path is private to the calling thread.
+		/// </summary>
+		fs::path dependencyPath() const;
+
+		/// <summary>
+		/// Returns the path to the entry stored for <paramref name="key"/>, and marks it as recently used.
+		/// Returns an empty path on misses.
+		/// </summary>
+		fs::path lookup(const std::string& key, std::vector<Diagnostic>& diagnostics);
+
+		/// <summary>
+		/// Where to save the output for a new entry, before passing it to <see cref="insert()"/>.
+		/// The path is private to the calling thread, so the same entry can be compiled concurrently.
+		/// </summary>
+		fs::path stagingPath(const std::string& key) const;
+
+		/// <summary>
+		/// A new, unique path for a private copy of the entry for <paramref name="key"/>, to be loaded from.
+		/// Eviction leaves the copy alone while this process runs, so it has to be removed by the caller.
+		/// </summary>
+		fs::path loadPath(const std::string& key) const;
+
+		/// <summary>
+		/// Moves the staged output for <paramref name="key"/> into the cache, and evicts the least
+		/// recently used entries until the cache is within limits again.
+		/// </summary>
+		void insert(const std::string& key, const std::vector<Diagnostic>& diagnostics);
+
+		/// <summary>
+		/// Removes a single entry, for instance if it turned out to be corrupt.
+		/// </summary>
+		void remove(const std::string& key);
+
+		/// <summary>
+		/// Removes every entry, as far as possible. Directories of nested caches are left alone.
+		/// </summary>
+		void clear();
+
+	private:
+
+		fs::path entryPath(const std::string& key) const;
+		fs::path diagnosticsPath(const std::string& key) const;
+		fs::path manifestPath(const ContentHash& inputs) const;
+		void evict();
+
+		fs::path directory;
+		std::uint64_t maxBytes;
+		std::size_t maxEntries;
+		std::string extension;
+	};
+};
+
+#endif
@@ -33,7 +33,17 @@
 #include <cpl/Common.h>
 #include <cpl/CExclusiveFile.h>
 #include "TranslationUnit.h"
+#include "CompileCache.h"
+#include "SystemToolchain.h"
+#include "HostTarget.h"
+#include "PerfMap.h"
+#include "StatementScanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
+#include <iterator>
+#include <optional>
 #include <sstream>
 
 namespace cpl
@@ -78,16 +88,39 @@ APE_Status CleanCompilerCache()
 	if (fs::exists(dirRoot / "runtime" / "common.h.pch") && !fs::remove(dirRoot / "runtime" / "common.h.pch"))
 		return Status::STATUS_ERROR;
 
+	CompileCache(dirRoot / "cache" / "native", CompileCache::defaultMaxBytes, CompileCache::defaultMaxEntries, SystemToolchain::sharedObjectExtension()).clear();
+	CompileCache(dirRoot / "cache").clear();
+
 	return Status::STATUS_OK;
 }
 
 namespace CppAPE
 {
+	// part of every cache key. the build time invalidates entries made by other builds of the compiler,
+	// as their bitcode isn't necessarily compatible.
+	static const char* cacheVersion = "CppAPE compile cache v2, " __DATE__ " " __TIME__;
+
 	const std::vector<const char*> ScriptCompiler::defines = {
 		"__cppape",
         "_LIBCPP_BUILDING_HAS_NO_ABI_LIBRARY"
 	};
 
+	// for APE_Project::timings
+	static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// runs f, adding the time it took to phase
+	template<typename Function>
+	static auto Timed(double& phase, Function&& f)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		auto result = f();
+		phase += MillisecondsSince(start);
+		return result;
+	}
+
 	APE_Diagnostic JitToDiagnostic(jit_error_t error)
 	{
 		switch (error)
@@ -101,10 +134,9 @@ namespace CppAPE
 		}
 	}
 
-	std::shared_ptr<CxxJitContext> ScriptCompiler::acquireCxxRuntime()
+	std::shared_ptr<const CxxRuntime> ScriptCompiler::acquireCxxRuntime()
 	{
-		static std::shared_ptr<CxxJitContext> cxxRuntime;
-		return cxxRuntime;
+		return CxxRuntime::acquire(fs::path(cpl::Misc::DirectoryPath()) / "runtime");
 	}
 
 
@@ -117,75 +149,86 @@ namespace CppAPE
 			print(APE_Diag_Error, "[CppAPE] : Leaked memory on script compiler destruction, unable to free!");
 		}
 		
+		PerfMap::retract(perfMapHandle);
 	}
 
 	Status ScriptCompiler::compileProject()
 	{
 		fs::path dirRoot = cpl::Misc::DirectoryPath();
 
-		cpl::CExclusiveFile lockFile;
+		// restoring a session: everything has to come from the cache, the frontend must not be invoked.
+		const char* restoreArtifact = getProject()->restoreArtifact;
+		struct RestoreMiss {};
 
-        auto lockFilePath = (dirRoot / "lockfile.l").string();
-        
-		if (!lockFile.open(lockFilePath.c_str()))
-		{
-            print(APE_Diag_Error, cpl::format("[CppAPE] : error: couldn't lock file at: %s", lockFilePath.c_str()).c_str());
-			return Status::STATUS_ERROR;
-		}
+		getProject()->artifact[0] = '\0';
 
-		if(!SetupEnvironment())
-		{
-			print(APE_Diag_Error, "[CppAPE] : Error setting up environment.");
-			return Status::STATUS_ERROR;
-		}
+		auto& timings = getProject()->timings;
+		timings = APE_CompileTimings();
+
+		// the jit has no profile runtime, so profile guided builds are always compiled natively.
+		// exports are too: the prebuilt runtime and pch are specific to the processor of this machine, see HostTarget.
+		if (usesSystemToolchain() || getProject()->profileGuidance != APE_ProfileGuidance_None || getProject()->exportPath)
+			return compileNative();
 
-		// TODO: Cache static
-		if (memoryEffectPCH.empty())
+		if (restoreArtifact && !HasEnvironment())
+			return Status::STATUS_MISS;
+
+		// only the shared runtime needs os-wide exclusion. once it's loaded, the compilation is private to
+		// this instance (and the compile cache is safe to share), so other instances can compile concurrently.
 		{
-			std::ifstream pchfile(
-                (dirRoot / "runtime" / "common.h.pch").string().c_str(),
-                std::ios::binary | std::ios::ate
-            );
-			std::streamsize size = pchfile.tellg();
-			pchfile.seekg(0, std::ios::beg);
-
-			memoryEffectPCH.resize(size);
-			if (size == 0 || size == -1 || !pchfile.read(memoryEffectPCH.data(), size))
+			cpl::CExclusiveFile lockFile;
+
+			auto lockFilePath = (dirRoot / "lockfile.l").string();
+
+			if (!lockFile.open(lockFilePath.c_str()))
 			{
-				print(APE_Diag_Error, "[CppAPE] : Failed to read pchfile into memory");
+				print(APE_Diag_Error, cpl::format("[CppAPE] : error: couldn't lock file at: %s", lockFilePath.c_str()).c_str());
 				return Status::STATUS_ERROR;
 			}
+
+			const auto environmentStart = std::chrono::steady_clock::now();
+
+			if (!SetupEnvironment())
+			{
+				print(APE_Diag_Error, "[CppAPE] : Error setting up environment.");
+				return Status::STATUS_ERROR;
+			}
+
+			try
+			{
+				if (!cxxRuntime || !cxxRuntime->isCurrent())
+					cxxRuntime = acquireCxxRuntime();
+			}
+			catch (const std::exception& e)
+			{
+				print(APE_Diag_Error, std::string("[CppAPE] : Error loading runtime: ") + e.what());
+				return Status::STATUS_ERROR;
+			}
+
+			timings.environment = MillisecondsSince(environmentStart);
 		}
 
 		try
 		{
+			std::vector<CompileCache::Diagnostic>* diagnosticLog = nullptr;
+
 			CxxTranslationUnit::Builder builder;
 			builder.onMessage(
-				[this](auto e, auto msg) 
+				[this, &diagnosticLog](auto e, auto msg) 
 				{
+					if (diagnosticLog)
+						diagnosticLog->push_back({ JitToDiagnostic(e), msg });
+
 					print(JitToDiagnostic(e), msg); 
 				}
 			);
 
 			auto root = fs::path(getProject()->rootPath);
 
-			std::string source;
-
-			if (getProject()->isSingleString)
-			{
-				source += getProject()->sourceString;
-			}
-
-			std::string startingPlace;
+			std::string source, startingPlace;
 
-			if (getProject()->workingDirectory)
-			{
-				startingPlace = getProject()->workingDirectory;
-			}
-			else if (getProject()->files && getProject()->files[0])
-			{
-				startingPlace = fs::path(getProject()->files[0]).parent_path().string();
-			}
+			if (!prepareSource(source, startingPlace))
+				return Status::STATUS_ERROR;
 
 			if (startingPlace.size())
 				builder.includeDirs({ startingPlace });
@@ -198,20 +241,22 @@ namespace CppAPE
 
 			});
 
-			if (std::ifstream postfix((dirRoot / "build" / "postfix.cpp").string().c_str()); postfix.good())
-			{
-				std::string temp;
-				while (std::getline(postfix, temp))
-					source += temp + "\n";
-			}
+			// quick builds still have to optimize a little: the PCH is built with -O2, and a mismatching
+			// __OPTIMIZE__ is an error. -O1 defines it as well, and the big saving is in code generation, see below.
+			const bool optimize = getProject()->optimizationLevel == APE_Optimization_Best;
 
-			if (!transformSource(*getProject(), source))
-				return Status::STATUS_ERROR;
+			// the jit can't link units together before optimizing them, so optimized builds compile the runtime and the tasks
+			// into the project's unit instead: calls into them (like getInterface() and the tracers) can be inlined then.
+			// quick builds reuse the prebuilt runtime.
+			const bool wholeProgram = optimize;
+
+			if (wholeProgram)
+				builder.includeDirs({ (dirRoot / "runtime").string() });
 
 			builder.args()
 				//.arg("fno-short-wchar")
 				.arg("-fms-extensions")
-				.arg("-O2")
+				.arg(optimize ? "-O2" : "-O1")
 				//.arg("--stdlib=libc++")
 				.arg("-D_LIBCPP_DISABLE_VISIBILITY_ANNOTATIONS")
 				.arg("-fexceptions")
@@ -223,18 +268,82 @@ namespace CppAPE
 				.argPair("-D__CPPAPE_PRECISION__=", std::to_string(getProject()->floatPrecision), cpl::Args::NoSpace)
 				.argPair("-D__CPPAPE_NATIVE_VECTOR_BIT_WIDTH__=", std::to_string(getProject()->nativeVectorBitWidth), cpl::Args::NoSpace)
 				.argPair("-D__STDC_VERSION__=", "199901L", cpl::Args::NoSpace)
-				.argPair("-std=", "c++17", cpl::Args::NoSpace)
-				.argPair("-include-pch", (dirRoot / "runtime" / "common.h.pch").string());
+				.argPair("-std=", "c++17", cpl::Args::NoSpace);
+
+			const auto staticConfigDefines = getStaticConfigDefines();
+
+			// the pch is built without a static configuration, so specialised builds have to parse the headers themselves.
+			// that's slower, but they're only compiled in the background.
+			if (staticConfigDefines.empty())
+				builder.args().argPair("-include-pch", (dirRoot / "runtime" / "common.h.pch").string());
+			else
+				builder.args().argPair("-include", "common.h");
+
+			for (auto& define : staticConfigDefines)
+				builder.args().arg(define);
+
+			// declares the line register used by the instrumented source, see transformSource()
+			if (getProject()->profileLines)
+				builder.args().argPair("-include", "profile.h");
 
 			if (getProject()->numTraceLines > 0)
 				builder.args().argPair("-D", "CPPAPE_TRACING_ENABLED", cpl::Args::NoSpace);
 
+			// the pch only has the disabled scopes, see profile_scope.h
+			if (getProject()->profileScopes)
+			{
+				builder.args().argPair("-D", "CPPAPE_PROFILING_ENABLED", cpl::Args::NoSpace);
+				builder.args().argPair("-include", "profile_scope.h");
+			}
+
 			for(auto define : defines)
 				builder.args().argPair("-D", define, cpl::Args::NoSpace);
 
-			builder.addMemoryFile("common.h.pch", memoryEffectPCH.data(), memoryEffectPCH.size());
+			// ahead of the source, so its macros and using directives can't reach the runtime, and its line numbers stay
+			if (wholeProgram)
+			{
+				builder.args().argPair("-include", "runtime.cpp");
+				builder.args().argPair("-include", "misc_tasks.cpp");
+			}
+
+			if (getProject()->optimizationRemarks)
+				builder.optimizationRemarks("loop-vectorize|slp-vectorizer|inline");
+
+			// must match the runtime, see SetupEnvironment()
+			for (auto& flag : HostTarget::get().getCompilerFlags())
+				builder.args().arg(flag);
+
+			// everything the output depends on besides the source: the arguments, the compiler itself
+			// and the prebuilt runtime, of which system headers are a part through the PCH.
+			// included files are added by the cache, as reported by the compiler.
+			ContentHash environment;
+			environment.add(std::string(cacheVersion));
+
+			for (std::size_t i = 0; i < builder.args().argc(); ++i)
+				environment.add(std::string(builder.args().argv()[i]));
 
-			state = std::make_unique<CxxJitContext>(0, false);
+			environment.add(cxxRuntime->getVersion());
+
+			auto projectInputs = environment;
+			projectInputs.add(std::string(getProject()->projectName ? getProject()->projectName : ""));
+			projectInputs.add(source);
+
+			const auto tasksPath = dirRoot / "runtime" / "misc_tasks.cpp";
+
+			auto tasksInputs = environment;
+			tasksInputs.addFile(tasksPath);
+
+			CompileCache cache(dirRoot / "cache");
+
+			// the source, its headers or the compiler changed since the session was saved
+			if (restoreArtifact && cache.resolve(projectInputs) != restoreArtifact)
+			{
+				print(APE_Diag_Info, "[CppAPE] : Compiled code of the session is out of date.");
+				return Status::STATUS_MISS;
+			}
+
+			// code generation at level 0 uses fast instruction selection
+			state = std::make_unique<CxxJitContext>(0, false, optimize ? jit_optimization_level_2 : jit_optimization_level_0);
 			state->setCallback(
 				[this](auto e, auto msg)
 				{
@@ -245,26 +354,118 @@ namespace CppAPE
 			state->injectSymbol("??_7type_info@@6B@", (*(void**)&typeid(*this)));
 			state->injectSymbol("snprintf", std::snprintf);
 
-			auto projectUnit = builder.fromString(source, getProject()->projectName, state.get());
-			auto tasks = builder.fromFile((dirRoot / "runtime" / "misc_tasks.cpp").string());
-			auto runtimeUnit = CxxTranslationUnit::loadSaved((dirRoot / "runtime" / "runtime.bc").string(), state.get());
-			auto libraryUnit = CxxTranslationUnit::loadSaved((dirRoot / "runtime" / "libcxx.bc").string(), state.get());
+			const auto dependencies = cache.dependencyPath();
+			bool prepared = false;
+
+			auto compileCached = [&](const ContentHash& inputs, std::string& key, auto&& compile)
+			{
+				std::vector<CompileCache::Diagnostic> diagnostics;
+				key = cache.resolve(inputs);
+
+				if (auto cached = key.empty() ? fs::path() : cache.lookup(key, diagnostics); !cached.empty())
+				{
+					try
+					{
+						auto unit = Timed(timings.load, [&] { return CxxTranslationUnit::loadSaved(cached.string(), state.get()); });
+						timings.cacheHits++;
+
+						for (auto& diagnostic : diagnostics)
+							print(diagnostic.level, diagnostic.message);
+
+						return unit;
+					}
+					catch (const LibCppJitExceptionBase& e)
+					{
+						print(APE_Diag_Warning, std::string("[CppAPE] : Discarding unreadable cache entry: ") + e.what());
+						cache.remove(key);
+						diagnostics.clear();
+					}
+				}
+
+				if (restoreArtifact)
+					throw RestoreMiss();
+
+				if (!prepared)
+				{
+					auto& pch = cxxRuntime->getPCH();
+					builder.addMemoryFile("common.h.pch", pch.data(), pch.size());
+					// every file read is part of the key, see CompileCache::record()
+					builder.args().arg("-MD").argPair("-MF", dependencies.string()).argPair("-MT", "unit");
+					prepared = true;
+				}
+
+				diagnosticLog = &diagnostics;
+				auto unit = Timed(timings.frontend, compile);
+				diagnosticLog = nullptr;
+				timings.cacheMisses++;
+
+				key = cache.record(inputs, dependencies);
+
+				if (key.empty())
+				{
+					print(APE_Diag_Warning, "[CppAPE] : Unable to read the dependencies of the translation unit, so it isn't cached.");
+					return unit;
+				}
+
+				try
+				{
+					unit.save(cache.stagingPath(key).string());
+					cache.insert(key, diagnostics);
+				}
+				catch (const LibCppJitExceptionBase& e)
+				{
+					print(APE_Diag_Warning, std::string("[CppAPE] : Unable to cache translation unit: ") + e.what());
+					cache.remove(key);
+				}
+
+				return unit;
+			};
+
+			std::string artifact, tasksKey;
+
+			auto projectUnit = compileCached(projectInputs, artifact, [&] { return builder.fromString(source, getProject()->projectName, state.get()); });
+			auto libraryUnit = Timed(timings.load, [&] { return CxxTranslationUnit::loadSaved(cxxRuntime->getLibraryBitcode().string(), state.get()); });
 
 #if defined(_DEBUG) || defined(DEBUG)
 			projectUnit.save((dirRoot / "build" / "compiled_source.bc").string().c_str());
-			tasks.save((dirRoot / "build" / "tasks.bc").string().c_str());
 #endif
-			tasks.addDependencyOn(runtimeUnit);
-			projectUnit.addDependencyOn(tasks);
-			projectUnit.addDependencyOn(libraryUnit);
-			projectUnit.addDependencyOn(runtimeUnit);
-			libraryUnit.addDependencyOn(runtimeUnit);
-			runtimeUnit.addDependencyOn(tasks);
-
-			state->addTranslationUnit(projectUnit);
-			state->addTranslationUnit(tasks);
-			state->addTranslationUnit(runtimeUnit);
-			state->addTranslationUnit(libraryUnit);
+
+			if (wholeProgram)
+			{
+				projectUnit.addDependencyOn(libraryUnit);
+				libraryUnit.addDependencyOn(projectUnit);
+
+				state->addTranslationUnit(projectUnit);
+				state->addTranslationUnit(libraryUnit);
+			}
+			else
+			{
+				auto tasks = compileCached(tasksInputs, tasksKey, [&] { return builder.fromFile(tasksPath.string()); });
+				auto runtimeUnit = Timed(timings.load, [&] { return CxxTranslationUnit::loadSaved(cxxRuntime->getRuntimeBitcode().string(), state.get()); });
+
+#if defined(_DEBUG) || defined(DEBUG)
+				tasks.save((dirRoot / "build" / "tasks.bc").string().c_str());
+#endif
+				tasks.addDependencyOn(runtimeUnit);
+				projectUnit.addDependencyOn(tasks);
+				projectUnit.addDependencyOn(libraryUnit);
+				projectUnit.addDependencyOn(runtimeUnit);
+				libraryUnit.addDependencyOn(runtimeUnit);
+				runtimeUnit.addDependencyOn(tasks);
+
+				state->addTranslationUnit(projectUnit);
+				state->addTranslationUnit(tasks);
+				state->addTranslationUnit(runtimeUnit);
+				state->addTranslationUnit(libraryUnit);
+			}
+
+			std::snprintf(getProject()->artifact, sizeof(getProject()->artifact), "%s", artifact.c_str());
+		}
+		catch (const RestoreMiss&)
+		{
+			print(APE_Diag_Info, "[CppAPE] : Compiled code of the session is no longer cached.");
+			state = nullptr;
+			return Status::STATUS_MISS;
 		}
 		catch (const std::exception& e)
 		{
@@ -275,17 +476,134 @@ namespace CppAPE
 		return Status::STATUS_OK;
 	}
 
+	bool ScriptCompiler::prepareSource(std::string& source, std::string& startingPlace)
+	{
+		fs::path dirRoot = cpl::Misc::DirectoryPath();
+
+		if (getProject()->isSingleString)
+		{
+			source += getProject()->sourceString;
+		}
+
+		// only the project's own lines are profiled, not the postfix
+		const auto sourceLines = static_cast<std::size_t>(std::count(source.begin(), source.end(), '\n')) + 1;
+
+		if (getProject()->workingDirectory)
+		{
+			startingPlace = getProject()->workingDirectory;
+		}
+		else if (getProject()->files && getProject()->files[0])
+		{
+			startingPlace = fs::path(getProject()->files[0]).parent_path().string();
+		}
+
+		if (std::ifstream postfix((dirRoot / "build" / "postfix.cpp").string().c_str()); postfix.good())
+		{
+			std::string temp;
+			while (std::getline(postfix, temp))
+				source += temp + "\n";
+		}
+
+		return transformSource(*getProject(), source, sourceLines);
+	}
+
+	std::vector<std::string> ScriptCompiler::getStaticConfigDefines()
+	{
+		auto config = getProject()->staticConfig;
+
+		if (!config)
+			return {};
+
+		char sampleRate[32];
+		// round trips exactly, so the script compares equal to the configuration at runtime
+		std::snprintf(sampleRate, sizeof(sampleRate), "%.17g", config->sampleRate);
+
+		return {
+			"-D__CPPAPE_STATIC_CONFIG__",
+			"-D__CPPAPE_STATIC_INPUTS__=" + std::to_string(config->inputs),
+			"-D__CPPAPE_STATIC_OUTPUTS__=" + std::to_string(config->outputs),
+			"-D__CPPAPE_STATIC_BLOCK_SIZE__=" + std::to_string(config->blockSize),
+			"-D__CPPAPE_STATIC_SAMPLE_RATE__=" + std::string(sampleRate)
+		};
+	}
+
+	bool ScriptCompiler::hasArgument(const std::string& argument)
+	{
+		if (!getProject()->arguments)
+			return false;
+
+		std::istringstream arguments(getProject()->arguments);
+		std::string current;
+
+		while (arguments >> current)
+		{
+			if (current == argument)
+				return true;
+		}
+
+		return false;
+	}
+
+	std::string ScriptCompiler::getArgumentValue(const std::string& name)
+	{
+		if (!getProject()->arguments)
+			return {};
+
+		std::istringstream arguments(getProject()->arguments);
+		std::string current;
+
+		while (arguments >> current)
+		{
+			if (current.size() > name.size() && current.compare(0, name.size(), name) == 0 && current[name.size()] == '=')
+				return current.substr(name.size() + 1);
+		}
+
+		return {};
+	}
+
+	int ScriptCompiler::getProfilerFormats()
+	{
+		return (hasArgument("--perf-map") ? PerfMap::MapFile : 0) | (hasArgument("--jitdump") ? PerfMap::JitDump : 0);
+	}
+
 	Status ScriptCompiler::releaseProject()
 	{
+		// before the code is freed, so the addresses aren't attributed to this script when reused
+		PerfMap::retract(perfMapHandle);
+		perfMapHandle = 0;
+
 		state = nullptr;
+
+		// see pgo_module.cpp
+		if (getProject()->profileGuidance == APE_ProfileGuidance_Instrument && nativeModule.getHandle())
+		{
+			if (auto writeProfile = reinterpret_cast<int (*)()>(nativeModule.getFuncAddress("__cppape_write_profile")))
+			{
+				if (writeProfile() != 0)
+					print(APE_Diag_Warning, "[CppAPE] : Unable to write the profile of the instrumented build.");
+			}
+		}
+
+		nativeModule.release();
+		currentLine = nullptr;
+
+		if (!nativeModuleCopy.empty())
+		{
+			std::error_code ec;
+			fs::remove(nativeModuleCopy, ec);
+			nativeModuleCopy.clear();
+		}
+
 		return Status::STATUS_OK;
 	}
 
 	Status ScriptCompiler::initProject()
 	{
 		globalData = nullptr;
+		currentLine = nullptr;
+		getProject()->currentLine = nullptr;
 
-		if (!state)
+		if (!state && !nativeModule.getHandle())
 		{
 			print(APE_Diag_Error, "[CppAPE] : No existing jit context.");
 			return Status::STATUS_ERROR;
@@ -293,13 +611,56 @@ namespace CppAPE
 
 		try
 		{
-			state->finalize();
-			state->prepareGlobals();
+			if (state)
+			{
+				const auto profilerFormats = getProfilerFormats();
+				std::optional<PerfMap::Recorder> recorder;
+
+				// code may be emitted as late as when the symbols are looked up
+				if (profilerFormats && PerfMap::isSupported())
+					recorder.emplace();
 
-			plugin.entrypoint = state->getFunction<APE_Init>(SYMBOL_INIT);
-			plugin.exitpoint = state->getFunction<APE_End>(SYMBOL_END);
-			plugin.processor = state->getFunction<APE_ProcessReplacer>(SYMBOL_PROCESS_REPLACE);
-			plugin.handler = state->getFunction<APE_EventHandler>(SYMBOL_EVENT_HANDLER);
+				auto& timings = getProject()->timings;
+				auto phaseStart = std::chrono::steady_clock::now();
+
+				state->finalize();
+				timings.codegen = MillisecondsSince(phaseStart);
+
+				phaseStart = std::chrono::steady_clock::now();
+				state->prepareGlobals();
+				timings.prepareGlobals = MillisecondsSince(phaseStart);
+
+				phaseStart = std::chrono::steady_clock::now();
+				plugin.entrypoint = state->getFunction<APE_Init>(SYMBOL_INIT);
+				timings.firstSymbol = MillisecondsSince(phaseStart);
+
+				plugin.exitpoint = state->getFunction<APE_End>(SYMBOL_END);
+				plugin.processor = state->getFunction<APE_ProcessReplacer>(SYMBOL_PROCESS_REPLACE);
+				plugin.handler = state->getFunction<APE_EventHandler>(SYMBOL_EVENT_HANDLER);
+				globalData = state->getGlobal<PluginGlobalData>(SYMBOL_GLOBAL_DATA);
+
+				if (getProject()->profileLines)
+					currentLine = state->getGlobal<volatile int>("__cppape_current_line");
+
+				if (recorder)
+				{
+					const std::string name = std::string("cppape::") + (getProject()->projectName ? getProject()->projectName : "script");
+
+					PerfMap::retract(perfMapHandle);
+					perfMapHandle = PerfMap::publish(name, recorder->finish(), profilerFormats);
+				}
+			}
+			else
+			{
+				plugin.entrypoint = reinterpret_cast<APE_Init>(nativeModule.getFuncAddress(SYMBOL_INIT));
+				plugin.exitpoint = reinterpret_cast<APE_End>(nativeModule.getFuncAddress(SYMBOL_END));
+				plugin.processor = reinterpret_cast<APE_ProcessReplacer>(nativeModule.getFuncAddress(SYMBOL_PROCESS_REPLACE));
+				plugin.handler = reinterpret_cast<APE_EventHandler>(nativeModule.getFuncAddress(SYMBOL_EVENT_HANDLER));
+				globalData = reinterpret_cast<PluginGlobalData*>(nativeModule.getFuncAddress(SYMBOL_GLOBAL_DATA));
+
+				if (getProject()->profileLines)
+					currentLine = reinterpret_cast<volatile int*>(nativeModule.getFuncAddress("__cppape_current_line"));
+			}
 
 			if (!plugin.test(true))
 			{
@@ -307,7 +668,6 @@ namespace CppAPE
 				return Status::STATUS_ERROR;
 			}
 
-			globalData = state->getGlobal<PluginGlobalData>(SYMBOL_GLOBAL_DATA);
 			if(!globalData)
 			{
 				print(APE_Diag_CompilationError, "[CppAPE] :  Unable to find certain global data, did you forget the line GlobalData(\"your plugin name\") "
@@ -315,6 +675,14 @@ namespace CppAPE
 				return Status::STATUS_ERROR;
 			}
 
+			if (getProject()->profileLines && !currentLine)
+			{
+				print(APE_Diag_Error, "[CppAPE] : Unable to find the line register of the profiled build.");
+				return Status::STATUS_ERROR;
+			}
+
+			getProject()->currentLine = currentLine;
+
 			#ifdef _DEBUG
 				char buf[8192];
 				sprintf_s(buf, "[CppApe] symbol \"%s\" loaded at 0x%p", SYMBOL_INIT, plugin.entrypoint);
@@ -419,14 +787,22 @@ namespace CppAPE
 		return false;
 	}
 
-	bool ScriptCompiler::transformSource(const Project& project, std::string& source)
+	bool ScriptCompiler::transformSource(const Project& project, std::string& source, std::size_t sourceLines)
 	{
-		if (project.traceLines == nullptr || project.numTraceLines == 0)
+		const bool tracing = project.traceLines != nullptr && project.numTraceLines != 0;
+
+		if (!tracing && !project.profileLines)
 			return true;
 
-		std::string result = "#include <trace.h>\n";
+		std::vector<bool> statements;
+
+		// every statement records its line first. the markers are prepended on the same line, so lines don't move
+		if (project.profileLines)
+			statements = FindStatementLines(source, sourceLines);
+
+		std::string result = tracing ? "#include <trace.h>\n" : "";
 		result.reserve(source.size());
-		int lineCounter = 0;
+		std::size_t lineCounter = 0;
 		std::string line;
 
 		const auto traceBegin = project.traceLines;
@@ -443,7 +819,10 @@ namespace CppAPE
 				}
 				case '\n':
 				{
-					if (std::find(traceBegin, traceEnd, lineCounter) != traceEnd)
+					if (lineCounter < statements.size() && statements[lineCounter])
+						result += "CPPAPE_PROFILE_LINE(" + std::to_string(lineCounter + 1) + "); ";
+
+					if (tracing && std::find(traceBegin, traceEnd, static_cast<int>(lineCounter)) != traceEnd)
 					{
 						auto terminal = line.find_first_of(';');
 
@@ -483,6 +862,10 @@ namespace CppAPE
 
 	Status ScriptCompiler::processReplacing(const float * const * in, float * const * out, size_t frames)
 	{
+		// whatever runs before the first line of the block isn't attributed to the last line of the previous one
+		if (currentLine)
+			*currentLine = 0;
+
 		return (*plugin.processor)(pluginData, getProject()->iface, in, out, frames);
 	}
 	
@@ -490,7 +873,9 @@ namespace CppAPE
 	{
 		try
 		{
-			state->openRuntime();
+			// shared objects run their global constructors when loaded
+			if (state)
+				state->openRuntime();
 
 			if (!initLocalMemory())
 				return Status::STATUS_ERROR;
@@ -523,7 +908,8 @@ namespace CppAPE
 			pluginData = nullptr;
 
 			// TODO: Always call?
-			state->closeRuntime();
+			if (state)
+				state->closeRuntime();
 
 		}
 		catch (const LibCppJitExceptionBase& e)
@@ -36,7 +36,9 @@
 #include <tcc4ape/ScriptBindings.h>
 #include <memory>
 #include <cpl/filesystem.h>
+#include <cpl/CModule.h>
 #include "TranslationUnit.h"
+#include "CxxRuntime.h"
 
 namespace CppAPE
 {
@@ -94,22 +96,72 @@ namespace CppAPE
 
 	private:
 
-		bool transformSource(const Project& project, std::string& source);
+		/// <summary>
+		/// Applies breakpoints, and instruments the first <paramref name="sourceLines"/> lines if the project profiles lines.
+		/// </summary>
+		bool transformSource(const Project& project, std::string& source, std::size_t sourceLines);
+		/// <summary>
+		/// Assembles the complete source of the project, including the postfix, breakpoints and line profiling.
+		/// <paramref name="startingPlace"/> is the directory of the project, if any, for relative includes.
+		/// </summary>
+		bool prepareSource(std::string& source, std::string& startingPlace);
+
+		/// <summary>
+		/// Whether <paramref name="argument"/> is one of the project's arguments.
+		/// </summary>
+		bool hasArgument(const std::string& argument);
+		/// <summary>
+		/// The value of the project's argument of the form <paramref name="name"/>=value, or an empty string.
+		/// </summary>
+		std::string getArgumentValue(const std::string& name);
+		/// <summary>
+		/// Whether the project asks to be compiled with the system toolchain, through the "--system-toolchain" argument.
+		/// </summary>
+		bool usesSystemToolchain();
+		/// <summary>
+		/// The PerfMap formats the project asks compiled code to be published in, through the "--perf-map" 
+		/// and "--jitdump" arguments.
+		/// </summary>
+		int getProfilerFormats();
+		/// <summary>
+		/// Definitions of the configuration the project is specialised for (see ape::static_config), 
+		/// or nothing if it isn't.
+		/// </summary>
+		std::vector<std::string> getStaticConfigDefines();
+		/// <summary>
+		/// Compiles the project with the system toolchain into a cached shared object, and loads it in place of the JIT.
+		/// Exports are built the same way, into the project's export path. See NativeBackend.cpp.
+		/// </summary>
+		Status compileNative();
 
 		/// <summary>
 		/// Mutual (os-wide) exclusion should be provided by the parent caller.
 		/// </summary>
 		bool SetupEnvironment();
-		static std::shared_ptr<CxxJitContext> acquireCxxRuntime();
+		/// <summary>
+		/// Whether the runtime is built, so SetupEnvironment() has nothing to do.
+		/// </summary>
+		static bool HasEnvironment();
+		/// <summary>
+		/// Returns the process-wide runtime image, loading it if no other compiler holds a current one.
+		/// </summary>
+		static std::shared_ptr<const CxxRuntime> acquireCxxRuntime();
 
 		static const std::vector<const char*> defines;
-		std::vector<char> memoryEffectPCH;
 		std::unique_ptr<CxxJitContext> state;
 		ScriptPlugin plugin;
 
 		ScriptInstance * pluginData = nullptr;
 		PluginGlobalData * globalData = nullptr;
-		std::shared_ptr<CxxTranslationUnit> cxxRuntime;
+		std::shared_ptr<const CxxRuntime> cxxRuntime;
+		// the shared object built by compileNative(), used instead of the jit context if loaded
+		cpl::CModule nativeModule;
+		// kept while loaded if profiling, so profilers can read the symbols
+		fs::path nativeModuleCopy;
+		// see PerfMap::publish()
+		std::uint64_t perfMapHandle = 0;
+		// the line being executed in builds profiling lines, see profile.h
+		volatile int * currentLine = nullptr;
 	};
 };
 
@@ -0,0 +1,145 @@
+/*************************************************************************************
+
+	C++ compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:CxxRuntime.cpp
+
+		Implementation of CxxRuntime.h
+
+*************************************************************************************/
+
+#include "CxxRuntime.h"
+#include "CompileCache.h"
+#include <cpl/MacroConstants.h>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#ifndef CPL_WINDOWS
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace CppAPE
+{
+	MappedFile::MappedFile(const fs::path& file)
+		: begin(nullptr)
+		, length(0)
+	{
+	#ifdef CPL_WINDOWS
+		// mapped files can't be deleted on windows, which would break CleanCompilerCache()
+		// while any instance is alive. the image is still only read once per process.
+		std::ifstream stream(file.string().c_str(), std::ios::binary | std::ios::ate);
+		const std::streamsize size = stream.tellg();
+		stream.seekg(0, std::ios::beg);
+
+		if (size <= 0)
+			throw std::runtime_error("Unable to read " + file.string());
+
+		buffer.resize(static_cast<std::size_t>(size));
+
+		if (!stream.read(buffer.data(), size))
+			throw std::runtime_error("Unable to read " + file.string());
+
+		begin = buffer.data();
+		length = buffer.size();
+	#else
+		const int fd = ::open(file.string().c_str(), O_RDONLY);
+
+		if (fd == -1)
+			throw std::runtime_error("Unable to open " + file.string());
+
+		struct stat info;
+
+		if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+		{
+			::close(fd);
+			throw std::runtime_error("Unable to read " + file.string());
+		}
+
+		auto mapping = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		// the mapping keeps the file alive by itself
+		::close(fd);
+
+		if (mapping == MAP_FAILED)
+			throw std::runtime_error("Unable to map " + file.string());
+
+		begin = static_cast<const char*>(mapping);
+		length = static_cast<std::size_t>(info.st_size);
+	#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+	#ifndef CPL_WINDOWS
+		if (begin)
+			::munmap(const_cast<char*>(begin), length);
+	#endif
+	}
+
+	std::shared_ptr<const CxxRuntime> CxxRuntime::acquire(const fs::path& runtimeDirectory)
+	{
+		static std::mutex mutex;
+		static std::weak_ptr<const CxxRuntime> shared;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto version = versionOf(runtimeDirectory);
+
+		if (auto current = shared.lock(); current && current->directory == runtimeDirectory && current->version == version)
+			return current;
+
+		// older images stay alive until every compiler using them lets go
+		auto image = std::make_shared<const CxxRuntime>(runtimeDirectory, std::move(version));
+		shared = image;
+
+		return image;
+	}
+
+	CxxRuntime::CxxRuntime(const fs::path& runtimeDirectory, std::string runtimeVersion)
+		: directory(runtimeDirectory)
+		, runtimeBitcode(runtimeDirectory / "runtime.bc")
+		, libraryBitcode(runtimeDirectory / "libcxx.bc")
+		, version(std::move(runtimeVersion))
+		, pch(runtimeDirectory / "common.h.pch")
+	{
+
+	}
+
+	bool CxxRuntime::isCurrent() const
+	{
+		return versionOf(directory) == version;
+	}
+
+	std::string CxxRuntime::versionOf(const fs::path& runtimeDirectory)
+	{
+		ContentHash hash;
+
+		hash.addFileStamp(runtimeDirectory / "common.h.pch");
+		hash.addFileStamp(runtimeDirectory / "runtime.bc");
+		hash.addFileStamp(runtimeDirectory / "libcxx.bc");
+
+		return hash.toString();
+	}
+};
@@ -0,0 +1,110 @@
+/*************************************************************************************
+
+	C++ Compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:CxxRuntime.h
+
+		The prebuilt parts every script is compiled and linked against: the
+		precompiled common header, and the runtime and libc++ bitcode.
+		A single, immutable image is shared by every compiler in the process, for
+		as long as any of them refer to it, and replaced when the files change.
+
+*************************************************************************************/
+#ifndef CPPAPE_CXXRUNTIME_H
+#define CPPAPE_CXXRUNTIME_H
+
+#include <cpl/filesystem.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CppAPE
+{
+	namespace fs = cpl::fs;
+
+	/// <summary>
+	/// Read-only view of a whole file. Memory mapped where possible, so the pages are shared
+	/// with other processes using the same file.
+	/// </summary>
+	class MappedFile
+	{
+	public:
+
+		/// <summary>
+		/// Throws std::runtime_error if the file can't be opened or is empty.
+		/// </summary>
+		MappedFile(const fs::path& file);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator = (const MappedFile&) = delete;
+
+		const char* data() const noexcept { return begin; }
+		std::size_t size() const noexcept { return length; }
+
+	private:
+
+		const char* begin;
+		std::size_t length;
+		// used instead of a mapping on platforms that lock mapped files against deletion
+		std::vector<char> buffer;
+	};
+
+	class CxxRuntime
+	{
+	public:
+
+		/// <summary>
+		/// Returns the runtime image of <paramref name="runtimeDirectory"/>, which is shared if it's already
+		/// loaded and up to date. Thread safe. Throws if the runtime files can't be read.
+		/// </summary>
+		static std::shared_ptr<const CxxRuntime> acquire(const fs::path& runtimeDirectory);
+
+		/// <summary>
+		/// Whether the files on disk are still the ones this image was loaded from.
+		/// </summary>
+		bool isCurrent() const;
+
+		const MappedFile& getPCH() const noexcept { return pch; }
+		const fs::path& getRuntimeBitcode() const noexcept { return runtimeBitcode; }
+		const fs::path& getLibraryBitcode() const noexcept { return libraryBitcode; }
+
+		/// <summary>
+		/// Identifies the exact version of the runtime files, for use in cache keys.
+		/// </summary>
+		const std::string& getVersion() const noexcept { return version; }
+
+		CxxRuntime(const fs::path& runtimeDirectory, std::string version);
+
+	private:
+
+		static std::string versionOf(const fs::path& runtimeDirectory);
+
+		fs::path directory, runtimeBitcode, libraryBitcode;
+		std::string version;
+		MappedFile pch;
+	};
+};
+
+#endif
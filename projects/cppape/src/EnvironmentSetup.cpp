@@ -28,21 +28,35 @@
 *************************************************************************************/
 
 #include "CppAPE.h"
+#include "HostTarget.h"
 #include <ape/CompilerBindings.h>
 #include <cpl/CExclusiveFile.h>
 #include <cstdarg>
+#include <fstream>
 
 namespace CppAPE
 {
+	bool ScriptCompiler::HasEnvironment()
+	{
+		auto root = fs::path(cpl::Misc::DirectoryPath());
+
+		if (!fs::exists(root / "runtime" / "runtime.bc") || !fs::exists(root / "runtime" / "libcxx.bc") || !fs::exists(root / "runtime" / "common.h.pch"))
+			return false;
+
+		// the pch can't be used with other target features than it was built with
+		std::string target;
+		std::ifstream stamp((root / "runtime" / "target.txt").string().c_str());
+
+		return std::getline(stamp, target) && target == HostTarget::get().toString();
+	}
+
 	bool ScriptCompiler::SetupEnvironment()
 	{
 		auto root = fs::path(cpl::Misc::DirectoryPath());
 
-		if (fs::exists(root / "runtime" / "runtime.bc") && fs::exists(root / "runtime" / "libcxx.bc") && fs::exists(root / "runtime" / "common.h.pch"))
+		if (HasEnvironment())
 			return true;
 
-		memoryEffectPCH.clear();
-
 		CxxTranslationUnit::Builder builder;
 
 		builder
@@ -83,6 +97,11 @@ namespace CppAPE
 			for (auto define : defines)
 				builder.args().argPair("-D", define, cpl::Args::NoSpace);
 
+			for (auto& flag : HostTarget::get().getCompilerFlags())
+				builder.args().arg(flag);
+
+			print(APE_Diag_Info, "Targeting host features: " + HostTarget::get().toString());
+
 			builder
 				.fromFile((root / "runtime" / "runtime.cpp").string())
 				.save((root / "runtime" / "runtime.bc").string());
@@ -100,6 +119,8 @@ namespace CppAPE
 
 			print(APE_Diag_Info, "libcxx.cpp -> libcxx.bc");
 
+			std::ofstream((root / "runtime" / "target.txt").string().c_str(), std::ios::trunc) << HostTarget::get().toString() << "\n";
+
 			return true;
 		}
 		catch (const CxxTranslationUnit::CompilationException& e)
@@ -0,0 +1,165 @@
+/*************************************************************************************
+
+	C++ compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:HostTarget.cpp
+
+		Implementation of HostTarget.h
+
+*************************************************************************************/
+
+#include "HostTarget.h"
+#include <algorithm>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>
+	#define CPPAPE_X86
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <cpuid.h>
+	#define CPPAPE_X86
+#endif
+
+namespace CppAPE
+{
+#ifdef CPPAPE_X86
+	namespace
+	{
+		struct CpuidRegisters
+		{
+			std::uint32_t eax, ebx, ecx, edx;
+		};
+
+		CpuidRegisters cpuid(std::uint32_t leaf, std::uint32_t subleaf = 0)
+		{
+			CpuidRegisters r {};
+		#ifdef _MSC_VER
+			int regs[4];
+			__cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subleaf));
+			r = { static_cast<std::uint32_t>(regs[0]), static_cast<std::uint32_t>(regs[1]), static_cast<std::uint32_t>(regs[2]), static_cast<std::uint32_t>(regs[3]) };
+		#else
+			__cpuid_count(leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+		#endif
+			return r;
+		}
+
+		// which register states the operating system saves on context switches
+		std::uint64_t enabledStates()
+		{
+		#ifdef _MSC_VER
+			return _xgetbv(0);
+		#else
+			std::uint32_t low, high;
+			__asm__ volatile ("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+			return (static_cast<std::uint64_t>(high) << 32) | low;
+		#endif
+		}
+
+		bool bit(std::uint32_t reg, int index)
+		{
+			return (reg >> index) & 1;
+		}
+	}
+#endif
+
+	const HostTarget& HostTarget::get()
+	{
+		static const HostTarget target;
+		return target;
+	}
+
+	HostTarget::HostTarget()
+	{
+	#ifdef CPPAPE_X86
+		const auto maxLeaf = cpuid(0).eax;
+
+		if (maxLeaf < 1)
+			return;
+
+		const auto basic = cpuid(1);
+		const auto extended = maxLeaf >= 7 ? cpuid(7) : CpuidRegisters {};
+
+		auto add = [this](bool supported, const char* name)
+		{
+			if (supported)
+				features.emplace_back(name);
+		};
+
+		add(bit(basic.ecx, 19), "sse4.1");
+		add(bit(basic.ecx, 20), "sse4.2");
+		add(bit(basic.ecx, 23), "popcnt");
+		add(bit(extended.ebx, 3), "bmi");
+		add(bit(extended.ebx, 8), "bmi2");
+
+		// the vector extensions are useless unless the os preserves the registers
+		const bool osSavesState = bit(basic.ecx, 27);
+		const auto states = osSavesState ? enabledStates() : 0;
+		const bool ymm = (states & 0x6) == 0x6;
+		const bool zmm = ymm && (states & 0xE0) == 0xE0;
+
+		if (ymm && bit(basic.ecx, 28))
+		{
+			add(true, "avx");
+			add(bit(basic.ecx, 12), "fma");
+			add(bit(basic.ecx, 29), "f16c");
+			add(bit(extended.ebx, 5), "avx2");
+		}
+
+		if (zmm && bit(extended.ebx, 16))
+		{
+			add(true, "avx512f");
+			add(bit(extended.ebx, 17), "avx512dq");
+			add(bit(extended.ebx, 28), "avx512cd");
+			add(bit(extended.ebx, 30), "avx512bw");
+			add(bit(extended.ebx, 31), "avx512vl");
+		}
+	#endif
+	}
+
+	bool HostTarget::has(const std::string& feature) const
+	{
+		return std::find(features.begin(), features.end(), feature) != features.end();
+	}
+
+	std::vector<std::string> HostTarget::getCompilerFlags() const
+	{
+		std::vector<std::string> flags;
+
+		for (auto& feature : features)
+			flags.emplace_back("-m" + feature);
+
+		return flags;
+	}
+
+	std::string HostTarget::toString() const
+	{
+		if (features.empty())
+			return "generic";
+
+		std::string ret;
+
+		for (auto& feature : features)
+			ret += (ret.empty() ? "" : ",") + feature;
+
+		return ret;
+	}
+};
@@ -0,0 +1,73 @@
+/*************************************************************************************
+
+	C++ Compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:HostTarget.h
+
+		Detects the instruction set extensions of the processor running the host,
+		so scripts and the runtime can be compiled specifically for it.
+
+*************************************************************************************/
+#ifndef CPPAPE_HOSTTARGET_H
+#define CPPAPE_HOSTTARGET_H
+
+#include <string>
+#include <vector>
+
+namespace CppAPE
+{
+	class HostTarget
+	{
+	public:
+
+		/// <summary>
+		/// The features of the processor of this process, detected on first use. Thread safe.
+		/// </summary>
+		static const HostTarget& get();
+
+		/// <summary>
+		/// Names of the supported extensions, as understood by clang's -m flags and the target attribute,
+		/// for example "avx2" or "avx512f". Only extensions the operating system has enabled are included.
+		/// </summary>
+		const std::vector<std::string>& getFeatures() const noexcept { return features; }
+
+		bool has(const std::string& feature) const;
+
+		/// <summary>
+		/// Frontend arguments enabling every feature, which also predefines the matching macros (__AVX2__, __FMA__ etc.).
+		/// </summary>
+		std::vector<std::string> getCompilerFlags() const;
+
+		/// <summary>
+		/// Comma separated list of the features, or "generic" if there are none.
+		/// </summary>
+		std::string toString() const;
+
+	private:
+
+		HostTarget();
+
+		std::vector<std::string> features;
+	};
+};
+
+#endif
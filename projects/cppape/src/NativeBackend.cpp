@@ -0,0 +1,362 @@
+/*************************************************************************************
+
+	C++ compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:NativeBackend.cpp
+
+		Compiles projects with the C++ compiler installed on the system instead of
+		the JIT, with every optimization for the host machine enabled. The output
+		is a shared object, which is cached by the hash of its inputs and loaded
+		in place of the JIT context.
+
+*************************************************************************************/
+
+#include "CppAPE.h"
+#include "CompileCache.h"
+#include "SystemToolchain.h"
+#include <chrono>
+#include <cpl/Misc.h>
+#include <cpl/Common.h>
+#include <fstream>
+
+namespace CppAPE
+{
+	// part of every cache key, see cacheVersion in CppAPE.cpp
+	static const char* nativeCacheVersion = "CppAPE native cache v2, " __DATE__ " " __TIME__;
+
+	bool ScriptCompiler::usesSystemToolchain()
+	{
+		return hasArgument("--system-toolchain");
+	}
+
+	Status ScriptCompiler::compileNative()
+	{
+	#ifdef CPL_WINDOWS
+		if (getProject()->exportPath)
+			print(APE_Diag_Error, "[CppAPE] : Exporting native modules is not supported on Windows.");
+		else
+			print(APE_Diag_Error, "[CppAPE] : The system toolchain is not supported on Windows, remove --system-toolchain from the compiler arguments.");
+		return Status::STATUS_ERROR;
+	#else
+		const fs::path dirRoot = cpl::Misc::DirectoryPath();
+		const fs::path root = getProject()->rootPath;
+		const char* restoreArtifact = getProject()->restoreArtifact;
+		const auto profileGuidance = getProject()->profileGuidance;
+
+		if (profileGuidance != APE_ProfileGuidance_None && !getProject()->profileDirectory)
+		{
+			print(APE_Diag_Error, "[CppAPE] : No profile directory given for profile guided optimization.");
+			return Status::STATUS_ERROR;
+		}
+
+		state = nullptr;
+		nativeModule.release();
+
+		try
+		{
+			std::string source, startingPlace;
+
+			if (!prepareSource(source, startingPlace))
+				return Status::STATUS_ERROR;
+
+			SystemToolchain toolchain;
+			const auto toolchainVersion = toolchain.getVersion();
+
+			if (toolchainVersion.empty())
+			{
+				print(APE_Diag_Error, "[CppAPE] : Unable to run " + toolchain.getDriver() + ", is it installed? Set CPPAPE_CXX to use another compiler.");
+				return Status::STATUS_ERROR;
+			}
+
+			std::vector<fs::path> searchDirs;
+
+			if (startingPlace.size())
+				searchDirs.emplace_back(startingPlace);
+
+			searchDirs.emplace_back(root / "includes");
+			searchDirs.emplace_back(dirRoot / "runtime");
+
+			std::vector<std::string> args {
+				"-O3",
+				"-flto",
+				"-std=c++17",
+				"-fexceptions",
+				"-D__CPPAPE_PRECISION__=" + std::to_string(getProject()->floatPrecision),
+				"-D__CPPAPE_NATIVE_VECTOR_BIT_WIDTH__=" + std::to_string(getProject()->nativeVectorBitWidth),
+			#ifndef CPL_MAC
+				// scripts define functions like printf, which mustn't interpose the host's
+				"-Wl,-Bsymbolic"
+			#endif
+			};
+
+			for (auto& dir : searchDirs)
+				args.emplace_back("-I" + dir.string());
+
+			// exports run on other machines, so they target the baseline of the architecture unless a processor
+			// is named through "--export-target=<cpu>" (as understood by -march, for example x86-64-v3)
+			if (!getProject()->exportPath)
+				args.emplace_back("-march=native");
+			else if (auto target = getArgumentValue("--export-target"); !target.empty())
+				args.emplace_back("-march=" + target);
+
+			if (getProject()->numTraceLines > 0)
+				args.emplace_back("-DCPPAPE_TRACING_ENABLED");
+
+			// common.h includes the enabled scopes itself, see profile_scope.h
+			if (getProject()->profileScopes)
+				args.emplace_back("-DCPPAPE_PROFILING_ENABLED");
+
+			fs::path profile;
+
+			if (profileGuidance == APE_ProfileGuidance_Instrument)
+			{
+				args.emplace_back("-fprofile-generate=" + std::string(getProject()->profileDirectory));
+			}
+			else if (profileGuidance == APE_ProfileGuidance_Optimize)
+			{
+				profile = fs::path(getProject()->profileDirectory) / "merged.profdata";
+				std::string log;
+
+				if (!toolchain.mergeProfiles(getProject()->profileDirectory, profile, log))
+				{
+					print(APE_Diag_Error, "[CppAPE] : Unable to merge the profile of the instrumented build: " + log);
+					return Status::STATUS_ERROR;
+				}
+
+				args.emplace_back("-fprofile-use=" + profile.string());
+				// the profile is of the same source, but code without any samples is still worth compiling silently
+				args.emplace_back("-Wno-profile-instr-unprofiled");
+				args.emplace_back("-Wno-profile-instr-out-of-date");
+			}
+
+			for (auto define : defines)
+				args.emplace_back(std::string("-D") + define);
+
+			for (auto& define : getStaticConfigDefines())
+				args.emplace_back(define);
+
+			// a single translation unit with the runtime: the headers define the allocation operators, which
+			// the jit tolerates in every unit but a linker doesn't. common.h is otherwise included by the pch.
+			std::string unit = "#include <common.h>\n";
+
+			// the line register of instrumented sources, see transformSource()
+			if (getProject()->profileLines)
+				unit += "#include <profile.h>\n";
+
+			// the runtime goes first, so the macros and using directives of the source can't reach it
+			unit += "#include <runtime.cpp>\n#include <misc_tasks.cpp>\n";
+
+			if (getProject()->exportPath)
+				unit += "#include <aot_module.cpp>\n";
+
+			if (profileGuidance == APE_ProfileGuidance_Instrument)
+				unit += "#include <pgo_module.cpp>\n";
+
+			unit += "#line 1 \"" + std::string(getProject()->projectName ? getProject()->projectName : "source") + "\"\n";
+			unit += source;
+
+			// included files are added by the cache, as reported by the compiler
+			ContentHash inputs;
+			inputs.add(std::string(nativeCacheVersion));
+			inputs.add(toolchain.getDriver());
+			inputs.add(toolchainVersion);
+
+			for (auto& arg : args)
+				inputs.add(arg);
+
+			// -march=native means something else on every machine, and the cache may be shared between them
+			if (!getProject()->exportPath)
+				inputs.add(toolchain.getNativeTarget());
+
+			inputs.add(unit);
+
+			if (!profile.empty())
+				inputs.addFile(profile);
+
+			CompileCache cache(dirRoot / "cache" / "native", CompileCache::defaultMaxBytes, CompileCache::defaultMaxEntries, SystemToolchain::sharedObjectExtension());
+			auto artifact = cache.resolve(inputs);
+
+			if (restoreArtifact && artifact != restoreArtifact)
+			{
+				print(APE_Diag_Info, "[CppAPE] : Compiled code of the session is out of date.");
+				return Status::STATUS_MISS;
+			}
+
+			std::vector<CompileCache::Diagnostic> diagnostics;
+
+			auto build = [&](const fs::path& output, std::vector<std::string> buildArgs)
+			{
+				const auto unitPath = fs::path(output.string() + ".cpp");
+				std::error_code ec;
+
+				{
+					std::ofstream stream(unitPath.string().c_str(), std::ios::binary | std::ios::trunc);
+
+					if (!stream.write(unit.data(), unit.size()))
+						throw std::runtime_error("Unable to write " + unitPath.string());
+				}
+
+				print(APE_Diag_Info, "[CppAPE] : Compiling with " + toolchain.getDriver() + "...");
+
+				std::string log;
+				auto start = std::chrono::high_resolution_clock::now();
+				const bool built = toolchain.buildSharedObject({ unitPath }, buildArgs, output, log);
+				std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+
+				fs::remove(unitPath, ec);
+
+				if (!log.empty())
+					diagnostics.push_back({ built ? APE_Diag_Warning : APE_Diag_CompilationError, log });
+
+				if (built)
+					print(APE_Diag_Info, cpl::format("[CppAPE] : Compiled natively (%f ms).", time.count()));
+
+				return built;
+			};
+
+			// exports aren't cached. they're staged privately and moved into place, so concurrent exports don't
+			// build over each other, and a failed export leaves a previous module at the destination alone.
+			if (getProject()->exportPath)
+			{
+				fs::path destination = getProject()->exportPath;
+
+				if (!destination.has_extension())
+					destination += SystemToolchain::sharedObjectExtension();
+
+				const auto staged = cache.stagingPath(inputs.toString());
+				bool built = build(staged, args);
+
+				for (auto& diagnostic : diagnostics)
+					print(diagnostic.level, diagnostic.message);
+
+				std::error_code ec;
+
+				if (built)
+				{
+					fs::rename(staged, destination, ec);
+
+					// the destination may be on another file system
+					if (ec && fs::copy_file(staged, destination, fs::copy_options::overwrite_existing, ec))
+						ec.clear();
+
+					if (ec)
+					{
+						print(APE_Diag_Error, "[CppAPE] : Unable to write " + destination.string() + ": " + ec.message());
+						built = false;
+					}
+				}
+
+				fs::remove(staged, ec);
+
+				if (built)
+					print(APE_Diag_Info, "[CppAPE] : Exported to " + destination.string() + ".");
+
+				return built ? Status::STATUS_OK : Status::STATUS_ERROR;
+			}
+
+			auto cached = artifact.empty() ? fs::path() : cache.lookup(artifact, diagnostics);
+
+			if (cached.empty())
+			{
+				if (restoreArtifact)
+				{
+					print(APE_Diag_Info, "[CppAPE] : Compiled code of the session is no longer cached.");
+					return Status::STATUS_MISS;
+				}
+
+				diagnostics.clear();
+
+				// the key depends on the headers read, so it's only known once compiled
+				const auto staged = cache.stagingPath(inputs.toString());
+				const auto dependencies = cache.dependencyPath();
+				auto buildArgs = args;
+				buildArgs.insert(buildArgs.end(), { "-MD", "-MF", dependencies.string(), "-MT", "unit" });
+
+				if (!build(staged, std::move(buildArgs)))
+				{
+					std::error_code ec;
+					fs::remove(staged, ec);
+					fs::remove(dependencies, ec);
+
+					for (auto& diagnostic : diagnostics)
+						print(diagnostic.level, diagnostic.message);
+
+					return Status::STATUS_ERROR;
+				}
+
+				artifact = cache.record(inputs, dependencies);
+
+				if (artifact.empty())
+				{
+					std::error_code ec;
+					fs::remove(staged, ec);
+					throw std::runtime_error("Unable to read the dependencies reported by " + toolchain.getDriver());
+				}
+
+				fs::rename(staged, cache.stagingPath(artifact));
+				cache.insert(artifact, diagnostics);
+
+				std::vector<CompileCache::Diagnostic> ignored;
+				cached = cache.lookup(artifact, ignored);
+
+				if (cached.empty())
+					throw std::runtime_error("Compiled shared object was evicted from the cache");
+			}
+
+			for (auto& diagnostic : diagnostics)
+				print(diagnostic.level, diagnostic.message);
+
+			// loading the same file twice returns the same module, but every instance needs its own globals.
+			// the loader keeps its own reference to a private copy, so it can be deleted straight away -
+			// unless profilers have to read the symbols from it later.
+			const auto privateCopy = cache.loadPath(artifact);
+
+			std::error_code ec;
+			fs::copy_file(cached, privateCopy);
+
+			std::string errorMsg;
+			const auto error = nativeModule.load(privateCopy.string(), errorMsg);
+
+			if (!error && getProfilerFormats())
+				nativeModuleCopy = privateCopy;
+			else
+				fs::remove(privateCopy, ec);
+
+			if (error)
+			{
+				print(APE_Diag_Error, cpl::format("[CppAPE] : Error loading compiled module (%d): %s", (int)error, errorMsg.c_str()));
+				return Status::STATUS_ERROR;
+			}
+
+			std::snprintf(getProject()->artifact, sizeof(getProject()->artifact), "%s", artifact.c_str());
+		}
+		catch (const std::exception& e)
+		{
+			print(APE_Diag_Error, std::string("[CppAPE] : Exception while compiling natively: ") + e.what());
+			nativeModule.release();
+			return Status::STATUS_ERROR;
+		}
+
+		return Status::STATUS_OK;
+	#endif
+	}
+}
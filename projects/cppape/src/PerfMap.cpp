@@ -0,0 +1,339 @@
+/*************************************************************************************
+
+	C++ compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:PerfMap.cpp
+
+		Implementation of PerfMap.h
+
+*************************************************************************************/
+
+#include "PerfMap.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+	#include <time.h>
+	#include <unistd.h>
+#endif
+
+namespace CppAPE
+{
+	namespace
+	{
+	#ifdef __linux__
+
+		std::mutex emissionMutex;
+
+		// see tools/perf/Documentation/jitdump-specification.txt in the linux sources
+		struct JitHeader
+		{
+			std::uint32_t magic, version, totalSize, elfMachine, pad, pid;
+			std::uint64_t timestamp, flags;
+		};
+
+		struct JitRecordHeader
+		{
+			std::uint32_t id, totalSize;
+			std::uint64_t timestamp;
+		};
+
+		struct JitCodeLoad
+		{
+			JitRecordHeader header;
+			std::uint32_t pid, tid;
+			std::uint64_t vma, codeAddress, codeSize, codeIndex;
+		};
+
+		constexpr std::uint32_t jitMagic = 0x4A695444, jitCodeLoadRecord = 0;
+
+		constexpr std::uint32_t elfMachine =
+		#if defined(__x86_64__)
+			62;
+		#elif defined(__aarch64__)
+			183;
+		#elif defined(__i386__)
+			3;
+		#else
+			0;
+		#endif
+
+		// perf record -k mono samples with this clock
+		std::uint64_t timestamp()
+		{
+			timespec time;
+			clock_gettime(CLOCK_MONOTONIC, &time);
+			return static_cast<std::uint64_t>(time.tv_sec) * 1000000000ull + time.tv_nsec;
+		}
+
+		std::vector<PerfMap::Region> executableRegions()
+		{
+			std::vector<PerfMap::Region> regions;
+			std::ifstream maps("/proc/self/maps");
+			std::string line;
+
+			while (std::getline(maps, line))
+			{
+				std::istringstream fields(line);
+				std::string range, permissions, offset, device, inode, path;
+
+				fields >> range >> permissions >> offset >> device >> inode;
+				std::getline(fields >> std::ws, path);
+
+				// the jit allocates anonymous memory, everything else is a loaded module
+				if (permissions.size() < 3 || permissions[2] != 'x' || inode != "0" || (!path.empty() && path.compare(0, 6, "[anon:") != 0))
+					continue;
+
+				const auto dash = range.find('-');
+
+				if (dash == std::string::npos)
+					continue;
+
+				regions.push_back({
+					static_cast<std::uintptr_t>(std::strtoull(range.c_str(), nullptr, 16)),
+					static_cast<std::uintptr_t>(std::strtoull(range.c_str() + dash + 1, nullptr, 16))
+				});
+			}
+
+			return regions;
+		}
+
+		// the parts of sorted, disjoint "after" that aren't in "before"
+		std::vector<PerfMap::Region> subtract(const std::vector<PerfMap::Region>& after, const std::vector<PerfMap::Region>& before)
+		{
+			std::vector<PerfMap::Region> result;
+
+			for (auto region : after)
+			{
+				for (auto& old : before)
+				{
+					if (old.end <= region.begin || old.begin >= region.end)
+						continue;
+
+					if (old.begin > region.begin)
+						result.push_back({ region.begin, old.begin });
+
+					region.begin = std::max(region.begin, old.end);
+
+					if (region.begin >= region.end)
+						break;
+				}
+
+				if (region.begin < region.end)
+					result.push_back(region);
+			}
+
+			return result;
+		}
+
+		class Publisher
+		{
+		public:
+
+			static Publisher& get()
+			{
+				static Publisher publisher;
+				return publisher;
+			}
+
+			std::uint64_t publish(const std::string& name, const std::vector<PerfMap::Region>& regions, int formats)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (formats & PerfMap::JitDump)
+				{
+					for (auto& region : regions)
+						writeCodeLoad(name, region);
+				}
+
+				if (!(formats & PerfMap::MapFile))
+					return 0;
+
+				const auto handle = ++handles;
+
+				for (auto& region : regions)
+					entries.push_back({ handle, region, name });
+
+				writeMapFile();
+				return handle;
+			}
+
+			void retract(std::uint64_t handle)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				const auto size = entries.size();
+				entries.erase(std::remove_if(entries.begin(), entries.end(), [&](auto& entry) { return entry.handle == handle; }), entries.end());
+
+				if (entries.size() != size)
+					writeMapFile();
+			}
+
+		private:
+
+			struct Entry
+			{
+				std::uint64_t handle;
+				PerfMap::Region region;
+				std::string name;
+			};
+
+			// the map has to be rewritten to remove anything, as readers take the first entry for an address.
+			// the replacement is moved in place atomically, so a profiler never reads a partial map.
+			void writeMapFile()
+			{
+				const std::string path = "/tmp/perf-" + std::to_string(::getpid()) + ".map";
+				const std::string staging = path + ".tmp";
+
+				if (std::FILE* file = std::fopen(staging.c_str(), "w"))
+				{
+					for (auto& entry : entries)
+						std::fprintf(file, "%llx %llx %s\n", (unsigned long long)entry.region.begin, (unsigned long long)(entry.region.end - entry.region.begin), entry.name.c_str());
+
+					std::fclose(file);
+					std::rename(staging.c_str(), path.c_str());
+				}
+			}
+
+			bool openJitDump()
+			{
+				if (jitDump != -1)
+					return true;
+
+				const char* directory = std::getenv("JITDUMPDIR");
+				const std::string path = std::string(directory ? directory : "/tmp") + "/jit-" + std::to_string(::getpid()) + ".dump";
+
+				jitDump = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644);
+
+				if (jitDump == -1)
+					return false;
+
+				// perf finds the dump through this executable mapping of it, which has to stay alive
+				jitDumpMarker = ::mmap(nullptr, ::sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC, MAP_PRIVATE, jitDump, 0);
+
+				JitHeader header { jitMagic, 1, sizeof(JitHeader), elfMachine, 0, static_cast<std::uint32_t>(::getpid()), timestamp(), 0 };
+
+				if (jitDumpMarker == MAP_FAILED || ::write(jitDump, &header, sizeof(header)) != sizeof(header))
+				{
+					::close(jitDump);
+					jitDump = -1;
+					return false;
+				}
+
+				return true;
+			}
+
+			void writeCodeLoad(const std::string& name, PerfMap::Region region)
+			{
+				if (!openJitDump())
+					return;
+
+				const auto codeSize = static_cast<std::uint64_t>(region.end - region.begin);
+
+				JitCodeLoad record {};
+				record.header.id = jitCodeLoadRecord;
+				record.header.totalSize = static_cast<std::uint32_t>(sizeof(JitCodeLoad) + name.size() + 1 + codeSize);
+				record.header.timestamp = timestamp();
+				record.pid = static_cast<std::uint32_t>(::getpid());
+				record.tid = static_cast<std::uint32_t>(::syscall(SYS_gettid));
+				record.vma = record.codeAddress = region.begin;
+				record.codeSize = codeSize;
+				record.codeIndex = ++codeIndex;
+
+				// a copy of the code, so perf annotate can disassemble it after the process is gone
+				if (::write(jitDump, &record, sizeof(record)) != sizeof(record) ||
+					::write(jitDump, name.c_str(), name.size() + 1) != static_cast<ssize_t>(name.size() + 1) ||
+					::write(jitDump, reinterpret_cast<const void*>(region.begin), codeSize) != static_cast<ssize_t>(codeSize))
+				{
+					// a torn record makes the rest unreadable
+					::close(jitDump);
+					jitDump = -1;
+				}
+			}
+
+			std::mutex mutex;
+			std::vector<Entry> entries;
+			std::uint64_t handles = 0, codeIndex = 0;
+			int jitDump = -1;
+			void* jitDumpMarker = nullptr;
+		};
+
+	#endif
+	}
+
+	PerfMap::Recorder::Recorder()
+	{
+	#ifdef __linux__
+		lock = std::unique_lock<std::mutex>(emissionMutex);
+		before = executableRegions();
+	#endif
+	}
+
+	std::vector<PerfMap::Region> PerfMap::Recorder::finish()
+	{
+		std::vector<Region> regions;
+
+	#ifdef __linux__
+		if (lock.owns_lock())
+		{
+			regions = subtract(executableRegions(), before);
+			lock.unlock();
+		}
+	#endif
+
+		return regions;
+	}
+
+	bool PerfMap::isSupported() noexcept
+	{
+	#ifdef __linux__
+		return true;
+	#else
+		return false;
+	#endif
+	}
+
+	std::uint64_t PerfMap::publish(const std::string& name, const std::vector<Region>& regions, int formats)
+	{
+	#ifdef __linux__
+		if (!regions.empty())
+			return Publisher::get().publish(name, regions, formats);
+	#endif
+
+		return 0;
+	}
+
+	void PerfMap::retract(std::uint64_t handle)
+	{
+	#ifdef __linux__
+		if (handle)
+			Publisher::get().retract(handle);
+	#endif
+	}
+};
@@ -0,0 +1,101 @@
+/*************************************************************************************
+
+	C++ Compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:PerfMap.h
+
+		Publishes jit compiled code to system profilers like perf, through the
+		perf map (/tmp/perf-<pid>.map) and jitdump (jit-<pid>.dump) conventions,
+		so samples in scripts aren't anonymous addresses.
+		The jit doesn't expose its symbol tables, so code is found as the executable
+		memory appearing while it's emitted, and named after the script.
+		Only supported on Linux, does nothing elsewhere.
+
+*************************************************************************************/
+#ifndef CPPAPE_PERFMAP_H
+#define CPPAPE_PERFMAP_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace CppAPE
+{
+	class PerfMap
+	{
+	public:
+
+		enum Format
+		{
+			/// <summary>
+			/// /tmp/perf-&lt;pid&gt;.map, read by perf report directly.
+			/// </summary>
+			MapFile = 1 << 0,
+			/// <summary>
+			/// jit-&lt;pid&gt;.dump in $JITDUMPDIR or /tmp, including the code for perf annotate.
+			/// Needs perf record -k mono and perf inject --jit.
+			/// </summary>
+			JitDump = 1 << 1
+		};
+
+		struct Region
+		{
+			std::uintptr_t begin, end;
+		};
+
+		/// <summary>
+		/// Finds the executable memory created while it's alive, by code being emitted.
+		/// Emission of code to be recorded is serialized process-wide, so it can't be mistaken for another's.
+		/// </summary>
+		class Recorder
+		{
+		public:
+
+			Recorder();
+			/// <summary>
+			/// Stops recording, and returns the new executable memory.
+			/// </summary>
+			std::vector<Region> finish();
+
+		private:
+
+			std::unique_lock<std::mutex> lock;
+			std::vector<Region> before;
+		};
+
+		static bool isSupported() noexcept;
+
+		/// <summary>
+		/// Names the <paramref name="regions"/> in the <paramref name="formats"/>. 
+		/// Returns a handle for <see cref="retract()"/>, or zero if nothing was published.
+		/// </summary>
+		static std::uint64_t publish(const std::string& name, const std::vector<Region>& regions, int formats);
+		/// <summary>
+		/// Removes published code from the map file, before the memory is freed and possibly reused.
+		/// jitdump readers order code by time instead, so nothing is written there.
+		/// </summary>
+		static void retract(std::uint64_t handle);
+	};
+};
+
+#endif
@@ -0,0 +1,527 @@
+/*************************************************************************************
+
+	C++ compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:StatementScanner.cpp
+
+		Implementation of StatementScanner.h
+
+*************************************************************************************/
+
+#include "StatementScanner.h"
+#include <cctype>
+
+namespace CppAPE
+{
+	namespace
+	{
+		bool isIdentifier(char c)
+		{
+			return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+		}
+
+		struct Scope
+		{
+			// function bodies and nested blocks, as opposed to classes, namespaces, initializers
+			bool block;
+			// constexpr functions can't have side effects
+			bool instrumentable;
+			int nesting;
+		};
+
+		class Scanner
+		{
+		public:
+
+			Scanner(const std::string& source, std::size_t numLines)
+				: source(source)
+				, lines(numLines, false)
+			{
+				scopes.push_back({ false, false, 0 });
+			}
+
+			std::vector<bool> run()
+			{
+				bool lineStart = true;
+
+				for (pos = 0; pos < source.size() && line < lines.size(); )
+				{
+					const char c = source[pos];
+
+					if (c == '\n')
+					{
+						line++;
+						pos++;
+						lineStart = true;
+						continue;
+					}
+
+					if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v')
+					{
+						pos++;
+						continue;
+					}
+
+					if (c == '/' && peek(1) == '/')
+					{
+						skipLine();
+						continue;
+					}
+
+					if (c == '/' && peek(1) == '*')
+					{
+						const auto start = line;
+						skipBlockComment();
+
+						// the rest of the line is preceded by the end of the comment
+						if (line != start)
+							lineStart = false;
+
+						continue;
+					}
+
+					if (lineStart)
+					{
+						lineStart = false;
+
+						if (c == '#')
+						{
+							directive();
+							continue;
+						}
+
+						lines[line] = !unbalanced && canInsertBefore(c);
+					}
+
+					token(c);
+				}
+
+				return std::move(lines);
+			}
+
+		private:
+
+			char peek(std::size_t offset) const
+			{
+				return pos + offset < source.size() ? source[pos + offset] : '\0';
+			}
+
+			bool canInsertBefore(char c) const
+			{
+				auto& scope = scopes.back();
+
+				if (!scope.block || !scope.instrumentable || scope.nesting != 0 || !atBoundary)
+					return false;
+
+				switch (c)
+				{
+				case '}': case ')': case ']': case ',': case '.': case '?': case '=':
+				case '<': case '>': case '|': case '^': case '%': case '"': case '\'':
+					return false;
+				}
+
+				if (!isIdentifier(c))
+					return true;
+
+				const auto word = readWord(pos);
+
+				if (word == "else" || word == "catch")
+					return false;
+
+				// the condition of a do-while
+				if (word == "while" && (previous == '}' || afterBracelessDo))
+					return false;
+
+				return true;
+			}
+
+			std::string readWord(std::size_t start) const
+			{
+				auto end = start;
+
+				while (end < source.size() && isIdentifier(source[end]))
+					end++;
+
+				return source.substr(start, end - start);
+			}
+
+			void token(char c)
+			{
+				if (isIdentifier(c))
+				{
+					word(c);
+					return;
+				}
+
+				pos++;
+
+				switch (c)
+				{
+				case '"': skipString('"'); break;
+				case '\'': skipString('\''); break;
+				case '(': case '[': scopes.back().nesting++; break;
+				case ')': case ']': if (scopes.back().nesting > 0) scopes.back().nesting--; break;
+				case '{': openScope(); return;
+				case '}': closeScope(); return;
+				case ';':
+					if (scopes.back().nesting == 0)
+					{
+						boundary();
+						afterBracelessDo = bracelessDo;
+						bracelessDo = false;
+						previous = c;
+						qualifiedPrevious = c;
+						return;
+					}
+					break;
+				case ':':
+					if (peek(0) == ':')
+					{
+						pos++;
+					}
+					else if (scopes.back().nesting == 0 && label)
+					{
+						// case and default labels are followed by statements
+						boundary();
+						previous = c;
+						qualifiedPrevious = c;
+						return;
+					}
+					break;
+				}
+
+				previous = c;
+				qualifiedPrevious = c;
+				atBoundary = false;
+				awaitingDo = false;
+			}
+
+			void word(char c)
+			{
+				const auto start = pos;
+
+				// numbers, including digit separators and exponents
+				if (std::isdigit(static_cast<unsigned char>(c)))
+				{
+					while (pos < source.size())
+					{
+						const char n = source[pos];
+
+						if (isIdentifier(n) || n == '.' || (n == '\'' && isIdentifier(peek(1))))
+							pos++;
+						else if ((n == '+' || n == '-') && (source[pos - 1] == 'e' || source[pos - 1] == 'E' || source[pos - 1] == 'p' || source[pos - 1] == 'P'))
+							pos++;
+						else
+							break;
+					}
+
+					previous = '0';
+					qualifiedPrevious = '0';
+					atBoundary = false;
+					awaitingDo = false;
+					return;
+				}
+
+				const auto name = readWord(start);
+				pos += name.size();
+
+				// string and character literal prefixes
+				if (peek(0) == '"' || peek(0) == '\'')
+				{
+					const bool raw = name.back() == 'R';
+					const char quote = source[pos++];
+
+					if (raw && quote == '"')
+						skipRawString();
+					else
+						skipString(quote);
+
+					previous = quote;
+					qualifiedPrevious = quote;
+					atBoundary = false;
+					awaitingDo = false;
+					return;
+				}
+
+				if (atBoundary)
+					label = name == "case" || name == "default";
+
+				if (name == "constexpr" && lastWord != "if")
+					constexprSeen = true;
+
+				awaitingDo = name == "do";
+
+				if (name == "do")
+					bracelessDo = true;
+
+				lastWord = name;
+				previous = 'a';
+				atBoundary = false;
+
+				// qualifiers between the parameters and the body of a function
+				if (name != "const" && name != "noexcept" && name != "override" && name != "final" && name != "mutable" && name != "volatile")
+					qualifiedPrevious = 'a';
+			}
+
+			void openScope()
+			{
+				auto& outer = scopes.back();
+				bool block = false;
+
+				if (qualifiedPrevious == ')')
+					// function bodies, control statements, lambdas
+					block = true;
+				else if (previous == 'a' && (lastWord == "else" || lastWord == "do" || lastWord == "try"))
+					block = true;
+				else if (outer.block && outer.nesting == 0 && atBoundary)
+					// nested blocks
+					block = true;
+
+				if (awaitingDo)
+				{
+					// the body of a do-while in braces, which ends in '}'
+					bracelessDo = false;
+					awaitingDo = false;
+				}
+
+				const bool instrumentable = block && !constexprSeen && (outer.instrumentable || !outer.block);
+
+				scopes.push_back({ block, block ? instrumentable : false, 0 });
+
+				constexprSeen = false;
+				previous = '{';
+				qualifiedPrevious = '{';
+				atBoundary = block;
+				label = false;
+			}
+
+			void closeScope()
+			{
+				bool wasBlock = false;
+
+				if (scopes.size() > 1)
+				{
+					wasBlock = scopes.back().block;
+					scopes.pop_back();
+				}
+
+				previous = '}';
+				qualifiedPrevious = '}';
+				label = false;
+				afterBracelessDo = false;
+				constexprSeen = false;
+				// the ends of initializers and classes are followed by the rest of the declaration instead
+				atBoundary = wasBlock && scopes.back().nesting == 0;
+			}
+
+			void boundary()
+			{
+				atBoundary = true;
+				constexprSeen = false;
+				label = false;
+			}
+
+			void skipLine()
+			{
+				while (pos < source.size() && source[pos] != '\n')
+					pos++;
+			}
+
+			void skipBlockComment()
+			{
+				pos += 2;
+
+				while (pos < source.size() && !(source[pos] == '*' && peek(1) == '/'))
+				{
+					if (source[pos] == '\n')
+						line++;
+
+					pos++;
+				}
+
+				pos += 2;
+			}
+
+			void directive()
+			{
+				auto start = pos + 1;
+
+				while (start < source.size() && (source[start] == ' ' || source[start] == '\t'))
+					start++;
+
+				const auto name = readWord(start);
+
+				if (name == "if" || name == "ifdef" || name == "ifndef")
+				{
+					conditionals.push_back({ save(), {}, false, false });
+				}
+				else if ((name == "elif" || name == "else") && !conditionals.empty())
+				{
+					// every branch starts where the first one did, and has to end where it did
+					branchEnded();
+					restore(conditionals.back().start);
+					conditionals.back().sawElse = name == "else";
+				}
+				else if (name == "endif" && !conditionals.empty())
+				{
+					branchEnded();
+
+					// without an #else, the code may also continue from where the first branch started
+					if (!conditionals.back().sawElse && !sameDepth(conditionals.back().end, conditionals.back().start))
+						unbalanced = true;
+
+					conditionals.pop_back();
+				}
+
+				skipDirective();
+			}
+
+			void skipDirective()
+			{
+				while (pos < source.size() && source[pos] != '\n')
+				{
+					// continued on the next line
+					if (source[pos] == '\\' && (peek(1) == '\n' || (peek(1) == '\r' && peek(2) == '\n')))
+					{
+						pos += peek(1) == '\r' ? 2 : 1;
+						line++;
+					}
+
+					pos++;
+				}
+			}
+
+			void skipString(char quote)
+			{
+				while (pos < source.size() && source[pos] != quote && source[pos] != '\n')
+				{
+					if (source[pos] == '\\' && pos + 1 < source.size())
+					{
+						if (source[pos + 1] == '\n')
+							line++;
+
+						pos++;
+					}
+
+					pos++;
+				}
+
+				if (pos < source.size() && source[pos] == quote)
+					pos++;
+			}
+
+			void skipRawString()
+			{
+				const auto open = source.find('(', pos);
+
+				if (open == std::string::npos)
+				{
+					pos = source.size();
+					return;
+				}
+
+				const auto terminator = ")" + source.substr(pos, open - pos) + "\"";
+				auto end = source.find(terminator, open);
+				end = end == std::string::npos ? source.size() : end + terminator.size();
+
+				for (; pos < end; ++pos)
+				{
+					if (source[pos] == '\n')
+						line++;
+				}
+			}
+
+			// the state of the scan that preprocessor conditionals can alter
+			struct Snapshot
+			{
+				std::vector<Scope> scopes;
+				std::string lastWord;
+				char previous, qualifiedPrevious;
+				bool atBoundary, label, constexprSeen, awaitingDo, bracelessDo, afterBracelessDo;
+			};
+
+			struct Conditional
+			{
+				Snapshot start, end;
+				bool ended, sawElse;
+			};
+
+			Snapshot save() const
+			{
+				return { scopes, lastWord, previous, qualifiedPrevious, atBoundary, label, constexprSeen, awaitingDo, bracelessDo, afterBracelessDo };
+			}
+
+			void restore(const Snapshot& snapshot)
+			{
+				scopes = snapshot.scopes;
+				lastWord = snapshot.lastWord;
+				previous = snapshot.previous;
+				qualifiedPrevious = snapshot.qualifiedPrevious;
+				atBoundary = snapshot.atBoundary;
+				label = snapshot.label;
+				constexprSeen = snapshot.constexprSeen;
+				awaitingDo = snapshot.awaitingDo;
+				bracelessDo = snapshot.bracelessDo;
+				afterBracelessDo = snapshot.afterBracelessDo;
+			}
+
+			static bool sameDepth(const Snapshot& a, const Snapshot& b)
+			{
+				return a.scopes.size() == b.scopes.size() && a.scopes.back().nesting == b.scopes.back().nesting;
+			}
+
+			void branchEnded()
+			{
+				auto& conditional = conditionals.back();
+				auto current = save();
+
+				if (!conditional.ended)
+				{
+					conditional.end = std::move(current);
+					conditional.ended = true;
+				}
+				else if (!sameDepth(conditional.end, current))
+				{
+					unbalanced = true;
+				}
+			}
+
+			const std::string& source;
+			std::vector<bool> lines;
+			std::vector<Conditional> conditionals;
+			// branches of a conditional left the braces at different depths, so nothing after is certain
+			bool unbalanced = false;
+			std::vector<Scope> scopes;
+			std::string lastWord;
+			std::size_t pos = 0, line = 0;
+			// the last significant character, and the same disregarding qualifiers of functions
+			char previous = ';', qualifiedPrevious = ';';
+			bool atBoundary = false, label = false, constexprSeen = false;
+			bool awaitingDo = false, bracelessDo = false, afterBracelessDo = false;
+		};
+	}
+
+	std::vector<bool> FindStatementLines(const std::string& source, std::size_t numLines)
+	{
+		return Scanner(source, numLines).run();
+	}
+};
@@ -0,0 +1,51 @@
+/*************************************************************************************
+
+	C++ Compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:StatementScanner.h
+
+		Finds the lines of C++ source where a statement inside a function body
+		begins, so something can be inserted in front of it - like a marker of
+		the line being executed, for profiling.
+		This is a conservative lexical scan, not a parser: lines are only
+		reported where an extra statement is certain to be valid, anything
+		ambiguous (braceless do-while bodies, constexpr functions, statements
+		spanning lines, macros) is left out.
+
+*************************************************************************************/
+#ifndef CPPAPE_STATEMENTSCANNER_H
+#define CPPAPE_STATEMENTSCANNER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace CppAPE
+{
+	/// <summary>
+	/// Returns a flag for each of the first <paramref name="numLines"/> lines of <paramref name="source"/>
+	/// (zero-based), set if a statement may be inserted at the start of the line.
+	/// </summary>
+	std::vector<bool> FindStatementLines(const std::string& source, std::size_t numLines);
+};
+
+#endif
@@ -0,0 +1,307 @@
+/*************************************************************************************
+
+	C++ compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:SystemToolchain.cpp
+
+		Implementation of SystemToolchain.h
+
+*************************************************************************************/
+
+#include "SystemToolchain.h"
+#include <cpl/MacroConstants.h>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <system_error>
+
+#ifdef CPL_WINDOWS
+	#include <Windows.h>
+#else
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <spawn.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+	#ifdef CPL_MAC
+		#include <crt_externs.h>
+	#else
+		extern char** environ;
+	#endif
+#endif
+
+namespace CppAPE
+{
+	SystemToolchain::SystemToolchain()
+	{
+		for (auto variable : { "CPPAPE_CXX", "CXX" })
+		{
+			if (auto value = std::getenv(variable); value && value[0])
+			{
+				driver = value;
+				return;
+			}
+		}
+
+		driver = "clang++";
+	}
+
+	const char* SystemToolchain::sharedObjectExtension() noexcept
+	{
+	#if defined(CPL_WINDOWS)
+		return ".dll";
+	#elif defined(CPL_MAC)
+		return ".dylib";
+	#else
+		return ".so";
+	#endif
+	}
+
+	bool SystemToolchain::buildSharedObject(const std::vector<fs::path>& inputs, const std::vector<std::string>& args, const fs::path& output, std::string& log) const
+	{
+		std::error_code ec;
+
+	#if defined(CPL_MAC)
+		std::vector<std::string> arguments { "-dynamiclib" };
+	#else
+		std::vector<std::string> arguments { "-shared" };
+	#endif
+
+	#ifndef CPL_WINDOWS
+		arguments.emplace_back("-fPIC");
+	#endif
+
+		arguments.insert(arguments.end(), args.begin(), args.end());
+
+		for (auto& input : inputs)
+			arguments.emplace_back(input.string());
+
+		arguments.emplace_back("-o");
+		arguments.emplace_back(output.string());
+
+		fs::remove(output, ec);
+
+		const int result = run(driver, arguments, output.string() + ".log", log);
+
+		return result == 0 && fs::exists(output, ec);
+	}
+
+	std::string SystemToolchain::getVersion() const
+	{
+		return query({ "--version" });
+	}
+
+	std::string SystemToolchain::getNativeTarget() const
+	{
+	#ifdef CPL_WINDOWS
+		const std::string nothing = "NUL";
+	#else
+		const std::string nothing = "/dev/null";
+	#endif
+
+		// -### prints the commands the driver would run, with -march=native resolved to a processor and its features.
+		// only preprocessing, so there are no temporary files named in the commands.
+		return query({ "-march=native", "-###", "-x", "c++", "-E", nothing });
+	}
+
+	std::string SystemToolchain::query(const std::vector<std::string>& arguments) const
+	{
+		static std::mutex mutex;
+		static std::map<std::vector<std::string>, std::string> results;
+
+		std::vector<std::string> key { driver };
+		key.insert(key.end(), arguments.begin(), arguments.end());
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (auto it = results.find(key); it != results.end())
+			return it->second;
+
+		std::random_device device;
+		std::string log;
+
+		const auto logFile = fs::temp_directory_path() / ("cppape-query-" + std::to_string(device()) + ".log");
+
+		if (run(driver, arguments, logFile, log) != 0)
+			return {};
+
+		return results[key] = log;
+	}
+
+	bool SystemToolchain::mergeProfiles(const fs::path& directory, const fs::path& output, std::string& log) const
+	{
+		std::error_code ec;
+		std::vector<std::string> arguments { "merge", "-o", output.string() };
+		bool found = false;
+
+		for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+		{
+			if (it->path().extension() == ".profraw")
+			{
+				arguments.emplace_back(it->path().string());
+				found = true;
+			}
+		}
+
+		if (!found)
+		{
+			log = "No profiles were written to " + directory.string();
+			return false;
+		}
+
+		std::string program = "llvm-profdata";
+
+		if (auto value = std::getenv("CPPAPE_PROFDATA"); value && value[0])
+			program = value;
+
+		fs::remove(output, ec);
+
+		const int result = run(program, arguments, output.string() + ".log", log);
+
+		if (result != 0 && log.empty())
+			log = "Unable to run " + program + ", is it installed? Set CPPAPE_PROFDATA to use another one.";
+
+		return result == 0 && fs::exists(output, ec);
+	}
+
+	int SystemToolchain::run(const std::string& program, const std::vector<std::string>& arguments, const fs::path& logFile, std::string& log)
+	{
+		std::error_code ec;
+		int result = -1;
+
+		// the program is started directly, without a shell to interpret the arguments.
+		// both output streams go to the log file, and there's no input.
+	#ifdef CPL_WINDOWS
+		std::string command = quote(program);
+
+		for (auto& argument : arguments)
+			command += " " + quote(argument);
+
+		SECURITY_ATTRIBUTES inherited { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+		HANDLE output = CreateFileA(logFile.string().c_str(), GENERIC_WRITE, FILE_SHARE_READ, &inherited, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		HANDLE input = CreateFileA("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, &inherited, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (output != INVALID_HANDLE_VALUE && input != INVALID_HANDLE_VALUE)
+		{
+			STARTUPINFOA startup {};
+			startup.cb = sizeof(startup);
+			startup.dwFlags = STARTF_USESTDHANDLES;
+			startup.hStdInput = input;
+			startup.hStdOutput = output;
+			startup.hStdError = output;
+
+			PROCESS_INFORMATION process {};
+
+			if (CreateProcessA(nullptr, &command[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &startup, &process))
+			{
+				WaitForSingleObject(process.hProcess, INFINITE);
+
+				DWORD code = 0;
+
+				if (GetExitCodeProcess(process.hProcess, &code))
+					result = static_cast<int>(code);
+
+				CloseHandle(process.hThread);
+				CloseHandle(process.hProcess);
+			}
+		}
+
+		if (input != INVALID_HANDLE_VALUE)
+			CloseHandle(input);
+
+		if (output != INVALID_HANDLE_VALUE)
+			CloseHandle(output);
+	#else
+		std::vector<char*> argv { const_cast<char*>(program.c_str()) };
+
+		for (auto& argument : arguments)
+			argv.push_back(const_cast<char*>(argument.c_str()));
+
+		argv.push_back(nullptr);
+
+	#ifdef CPL_MAC
+		char** environment = *_NSGetEnviron();
+	#else
+		char** environment = environ;
+	#endif
+
+		posix_spawn_file_actions_t actions;
+		posix_spawn_file_actions_init(&actions);
+		posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+		posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, logFile.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+		pid_t child = 0;
+
+		if (posix_spawnp(&child, program.c_str(), &actions, nullptr, argv.data(), environment) == 0)
+		{
+			int status = 0;
+			pid_t waited;
+
+			while ((waited = waitpid(child, &status, 0)) == -1 && errno == EINTR)
+				;
+
+			if (waited == child && WIFEXITED(status))
+				result = WEXITSTATUS(status);
+		}
+
+		posix_spawn_file_actions_destroy(&actions);
+	#endif
+
+		if (std::ifstream stream(logFile.string().c_str(), std::ios::binary); stream.good())
+			log.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+		fs::remove(logFile, ec);
+
+		return result;
+	}
+
+	std::string SystemToolchain::quote(const std::string& argument)
+	{
+		// the rules of CommandLineToArgvW: backslashes are only special in front of quotes
+		std::string ret = "\"";
+		std::size_t backslashes = 0;
+
+		for (auto c : argument)
+		{
+			if (c == '\\')
+			{
+				backslashes++;
+			}
+			else
+			{
+				if (c == '"')
+					ret.append(backslashes + 1, '\\');
+
+				backslashes = 0;
+			}
+
+			ret += c;
+		}
+
+		ret.append(backslashes, '\\');
+		return ret + "\"";
+	}
+};
@@ -0,0 +1,104 @@
+/*************************************************************************************
+
+	C++ Compiler for Audio Programming Environment.
+
+    Copyright (C) 2017 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:SystemToolchain.h
+
+		The C++ compiler and linker installed on the system, for building native
+		code ahead of time, outside of the JIT.
+
+*************************************************************************************/
+#ifndef CPPAPE_SYSTEMTOOLCHAIN_H
+#define CPPAPE_SYSTEMTOOLCHAIN_H
+
+#include <cpl/filesystem.h>
+#include <string>
+#include <vector>
+
+namespace CppAPE
+{
+	namespace fs = cpl::fs;
+
+	class SystemToolchain
+	{
+	public:
+
+		/// <summary>
+		/// Uses the compiler driver named by CPPAPE_CXX or CXX in the environment, or clang++ from the path.
+		/// The driver has to accept LLVM bitcode as input, so it should be a clang matching the JIT.
+		/// </summary>
+		SystemToolchain();
+
+		/// <summary>
+		/// ".dll", ".dylib" or ".so".
+		/// </summary>
+		static const char* sharedObjectExtension() noexcept;
+
+		/// <summary>
+		/// Compiles and links <paramref name="inputs"/> (sources, bitcode or objects) into a shared object at <paramref name="output"/>.
+		/// Returns false on errors. The output of the toolchain is returned in <paramref name="log"/> in any case.
+		/// </summary>
+		bool buildSharedObject(const std::vector<fs::path>& inputs, const std::vector<std::string>& args, const fs::path& output, std::string& log) const;
+
+		/// <summary>
+		/// The version banner of the driver, for use in cache keys. Empty if the driver can't be run.
+		/// The result is remembered for the lifetime of the process.
+		/// </summary>
+		std::string getVersion() const;
+
+		/// <summary>
+		/// What -march=native resolves to for the driver on this machine (the processor and its features), for use in
+		/// cache keys. Empty if the driver can't be run. The result is remembered for the lifetime of the process.
+		/// </summary>
+		std::string getNativeTarget() const;
+
+		/// <summary>
+		/// Merges the raw profiles written by instrumented code into <paramref name="directory"/> into an indexed profile at
+		/// <paramref name="output"/>, for -fprofile-use. Uses the llvm-profdata named by CPPAPE_PROFDATA in the environment,
+		/// or the one from the path. Returns false if there are no profiles or on errors, with the reason in <paramref name="log"/>.
+		/// </summary>
+		bool mergeProfiles(const fs::path& directory, const fs::path& output, std::string& log) const;
+
+		const std::string& getDriver() const noexcept { return driver; }
+
+	private:
+
+		/// <summary>
+		/// Quotes <paramref name="argument"/> for a Windows command line.
+		/// </summary>
+		static std::string quote(const std::string& argument);
+		/// <summary>
+		/// Runs <paramref name="program"/> with <paramref name="arguments"/>, capturing the output in <paramref name="log"/> through <paramref name="logFile"/>.
+		/// Returns the exit code, or -1 if the program couldn't be run.
+		/// </summary>
+		static int run(const std::string& program, const std::vector<std::string>& arguments, const fs::path& logFile, std::string& log);
+		/// <summary>
+		/// The output of the driver run with <paramref name="arguments"/>, remembered for the lifetime of the process.
+		/// Empty if the driver fails.
+		/// </summary>
+		std::string query(const std::vector<std::string>& arguments) const;
+
+		std::string driver;
+	};
+};
+
+#endif
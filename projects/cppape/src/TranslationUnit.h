@@ -79,6 +79,19 @@ namespace CppAPE
 				return *this;
 			}
 
+			/// <summary>
+			/// Reports what the optimization passes matching the regular expression <paramref name="passes"/> did,
+			/// missed and why, as jit_error_compilation_remark messages located in the source.
+			/// </summary>
+			Builder& optimizationRemarks(const std::string& passes)
+			{
+				argPair("-Rpass=", passes, NoSpace);
+				argPair("-Rpass-missed=", passes, NoSpace);
+				argPair("-Rpass-analysis=", passes, NoSpace);
+
+				return *this;
+			}
+
 			Builder& onMessage(ErrorCallback onMessageCallback)
 			{
 				callback = std::move(onMessageCallback);
@@ -170,8 +183,9 @@ namespace CppAPE
 	public:
 
 		typedef std::function<void(jit_error_t errorType, const char * msg)> ErrorCallback;
+		typedef decltype(JitOptions::optimization_level) OptimizationLevel;
 
-		CxxJitContext(int numThreads, bool lazy)
+		CxxJitContext(int numThreads, bool lazy, OptimizationLevel optimizationLevel = jit_optimization_level_2)
 		{
 			MemoryContext* localMemory;
 			if (auto ret = jit_create_mcontext(&localMemory); ret != jit_error_none)
@@ -184,7 +198,7 @@ namespace CppAPE
             JitOptions options {};
             options.memory_context = localMemory;
             options.enable_symbol_lookup_in_process = true;
-            options.optimization_level = jit_optimization_level_2;
+            options.optimization_level = optimizationLevel;
             options.num_compile_threads = numThreads;
             options.enable_lazy_compilation = lazy;
             
@@ -30,82 +30,348 @@
 #include "CAllocator.h"
 #include <cpl/Protected.h>
 #include <cpl/Misc.h>
+#include <algorithm>
+#include <cstring>
+#include <new>
 
 namespace ape 
 {
+	namespace
+	{
+		// ids are never reused, so stale entries of dead allocators can never match.
+		std::atomic<std::uint64_t> allocatorIDs { 1 };
+
+		struct LocalCacheEntry
+		{
+			std::uint64_t allocator;
+			void * cache;
+		};
+
+		thread_local LocalCacheEntry localCaches[4];
+		thread_local unsigned nextLocalCache;
 
-	CAllocator::CAllocator(unsigned align) : alignment(align) {};
+		void throwMemoryError(const char * what, void * block)
+		{
+			cpl::CProtected::instance().throwException<std::runtime_error>(what + std::to_string((std::uintptr_t)block));
+		}
+	}
 
-	void * CAllocator::alloc(CAllocator::Label l, std::size_t memsize)
+	CAllocator::CAllocator(unsigned align)
+		: alignment(align)
+		, id(allocatorIDs.fetch_add(1))
+		, currentChunk(nullptr)
+		, registry(nullptr)
 	{
-		// calculate needed size.
-		size_t size = sizeof(mem_block) + memsize + sizeof(mem_block::mem_end);
-		// calculate if it's unaligned
-		unsigned rem = size % alignment;
-		// check remainder, and add it if needed.
-		if(rem) {
-			memsize += rem;
-			size = sizeof(mem_block) + memsize + sizeof(mem_block::mem_end);
+		for (auto& list : sharedFree)
+			list.store(nullptr);
+
+		for (auto& list : sharedSpans)
+			list.store(nullptr);
+
+		for (auto& cache : threadCaches)
+		{
+			cache.owner.store(std::thread::id());
+			resetBins(cache);
 		}
-		// allocate the memory
-		void * m = cpl::Misc::alignedMalloc<std::byte>(size);
-		// crash here perhaps.
-		if(!m)
-			return nullptr;
-		// zero out memory
-		memset(m, 0, size);
-		mem_block * header = reinterpret_cast<mem_block *>(m);
-		header->memLabel = l;
-		header->totalSize = size;
-		header->end = reinterpret_cast<mem_block::mem_end *>
-			(		// end = start + size - size of end header
-				(reinterpret_cast<char*>(m) + size) - sizeof(mem_block::mem_end)
-			);
-		// set a unique value in the end to so we can check if memory has been overwritten.
-		header->end->ncheck = end_marker;
 
+		overflowCache.owner.store(std::thread::id());
+		resetBins(overflowCache);
+	}
+
+	std::size_t CAllocator::classFor(std::size_t size) noexcept
+	{
+		std::size_t sizeClass = 0;
+
+		while (sizeClass < num_classes && classSize(sizeClass) < size)
+			sizeClass++;
+
+		return sizeClass;
+	}
+
+	std::size_t CAllocator::spanClassFor(std::size_t size) noexcept
+	{
+		std::size_t spanClass = 0;
+
+		while (spanClass < num_span_classes && spanSize(spanClass) < size)
+			spanClass++;
+
+		return spanClass;
+	}
+
+	CAllocator::slab_header * CAllocator::slabFrom(void * block) noexcept
+	{
+		return reinterpret_cast<slab_header *>(reinterpret_cast<std::uintptr_t>(block) & ~std::uintptr_t(slab_size - 1));
+	}
+
+	unsigned int & CAllocator::requestedSize(void * block, std::size_t sizeClass) noexcept
+	{
+		// the last bytes of the size class, which overruns only reach after passing the canary.
+		return *reinterpret_cast<unsigned int *>(reinterpret_cast<std::byte *>(block) + classSize(sizeClass) - sizeof(unsigned int));
+	}
 
-		cpl::CMutex lock(mutex);
-		allocations.push_back(header);
-		return header->getMemory();
+	void CAllocator::setCanary(std::byte * end) noexcept
+	{
+		// right after the requested bytes, so it may be unaligned.
+		unsigned int const marker = end_marker;
+		std::memcpy(end, &marker, sizeof(marker));
 	}
 
-	CAllocator::mem_block * CAllocator::headerFromBlock(void * block)
+	bool CAllocator::hasCanary(const std::byte * end) noexcept
 	{
+		unsigned int canary;
+		std::memcpy(&canary, end, sizeof(canary));
+		return canary == end_marker;
+	}
+
+	void * CAllocator::alloc(CAllocator::Label l, std::size_t memsize, std::size_t align)
+	{
+		align = std::max<std::size_t>(align, alignment);
+
+		// blocks inside slabs are naturally aligned to their size, up to the alignment of the slab header.
+		auto const sizeClass = classFor(std::max(memsize + trailer_size, align));
+
+		if (sizeClass == large_class || align > alignof(slab_header))
+			return allocLarge(memsize, align);
+
+		void * block = nullptr;
+
+		if (auto cache = localCache())
+		{
+			block = allocFrom(cache->bins[sizeClass], sizeClass);
+		}
+		else
+		{
+			cpl::CMutex lock(overflowMutex);
+			block = allocFrom(overflowCache.bins[sizeClass], sizeClass);
+		}
+
+		// crash here perhaps.
 		if (!block)
 			return nullptr;
 		
-		mem_block * header = reinterpret_cast<mem_block *> 
-			(	// the header is located before the actual block of memory, so subtract that value.
-				reinterpret_cast<char*>(block) - sizeof(mem_block)
-			);
+		std::memset(block, 0, memsize);
+		setCanary(static_cast<std::byte *>(block) + memsize);
+		requestedSize(block, sizeClass) = static_cast<unsigned int>(memsize);
+
+		return block;
+	}
+
+	CAllocator::thread_cache * CAllocator::localCache()
+	{
+		for (auto& entry : localCaches)
+		{
+			if (entry.allocator == id)
+				return static_cast<thread_cache *>(entry.cache);
+		}
+
+		// slow path: find the cache this thread claimed earlier, or claim a free one.
+		auto const self = std::this_thread::get_id();
+		thread_cache * found = nullptr;
+
+		for (auto& cache : threadCaches)
+		{
+			if (cache.owner.load(std::memory_order_acquire) == self)
+			{
+				found = &cache;
+				break;
+			}
+		}
+
+		if (!found)
+		{
+			for (auto& cache : threadCaches)
+			{
+				std::thread::id none;
+				if (cache.owner.compare_exchange_strong(none, self, std::memory_order_acq_rel))
+				{
+					found = &cache;
+					break;
+				}
+			}
+		}
+
+		if (found)
+			localCaches[nextLocalCache++ % std::extent<decltype(localCaches)>::value] = { id, found };
+
+		return found;
+	}
 
-		if(header->end && header->end->ncheck != end_marker)
-			// either we didnt allocate this or the block is corrupted: return null
+	void * CAllocator::allocFrom(bin & b, std::size_t sizeClass)
+	{
+		if (!b.head && b.cursor == b.end && !refill(b, sizeClass))
 			return nullptr;
 
-		return header;
+		if (b.head)
+		{
+			auto node = b.head;
+			b.head = node->next;
+			if (b.count)
+				b.count--;
+
+			return node;
+		}
+
+		auto block = b.cursor;
+		b.cursor += classSize(sizeClass);
+		return block;
+	}
+
+	bool CAllocator::refill(bin & b, std::size_t sizeClass)
+	{
+		// take everything other threads have returned in one go; popping single nodes would suffer from ABA.
+		if ((b.head = sharedFree[sizeClass].exchange(nullptr, std::memory_order_acquire)))
+		{
+			// the length is unknown, count only tracks what is known to be there.
+			b.count = 0;
+			return true;
+		}
+
+		auto header = acquireSlab();
+
+		if (!header)
+			return false;
+
+		header->owner = this;
+		header->sizeClass = sizeClass;
+
+		auto const blockSize = classSize(sizeClass);
+		auto const slab = reinterpret_cast<std::byte *>(header);
+		b.cursor = slab + sizeof(slab_header);
+		b.end = b.cursor + ((slab_size - sizeof(slab_header)) / blockSize) * blockSize;
+
+		return true;
 	}
 
-	bool CAllocator::removeBlock(mem_block * header)
+	CAllocator::slab_header * CAllocator::acquireSlab()
 	{
-		mem_it ret_it;
-		bool found(false);
+		auto chunk = currentChunk.load(std::memory_order_acquire);
 
-		for(ret_it = allocations.begin(); ret_it != allocations.end(); ret_it++) 
+		while (true)
 		{
+			if (chunk)
+			{
+				auto const index = chunk->taken.fetch_add(1, std::memory_order_relaxed);
+
+				if (index < slabs_per_chunk)
+				{
+					auto slab = reinterpret_cast<std::byte *>(chunk) + index * slab_size;
+					return new (slab) slab_header {};
+				}
+			}
 
-			if((*ret_it) == header) 
+			// the chunk is used up. the first slab of a new one is kept for this thread, the rest are handed out through the counter.
+			auto memory = cpl::Misc::alignedMalloc<std::byte, slab_size>(chunk_size);
+
+			if (!memory)
+				return nullptr;
+
+			auto fresh = new (memory) slab_header {};
+			fresh->taken.store(1, std::memory_order_relaxed);
+
+			auto slot = track(memory);
+
+			if (!slot)
 			{
-				found = true;
-				break;
+				cpl::Misc::alignedFree(static_cast<std::byte *>(memory));
+				return nullptr;
+			}
+
+			if (currentChunk.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+				return fresh;
+
+			// another thread replaced the chunk first, take from that one instead
+			slot->store(nullptr, std::memory_order_release);
+			cpl::Misc::alignedFree(static_cast<std::byte *>(memory));
+		}
+	}
+
+	std::atomic<void *> * CAllocator::track(void * memory)
+	{
+		for (auto page = registry.load(std::memory_order_acquire); page; page = page->next)
+		{
+			for (auto& slot : page->slots)
+			{
+				void * empty = nullptr;
+
+				if (!slot.load(std::memory_order_relaxed) && slot.compare_exchange_strong(empty, memory, std::memory_order_acq_rel))
+					return &slot;
 			}
 		}
 
-		if(found)
-			allocations.erase(ret_it);
+		// every slot is taken, publish a new page with the memory in its first slot.
+		auto page = new (std::nothrow) registry_page {};
 
-		return found;
+		if (!page)
+			return nullptr;
+
+		page->slots[0].store(memory, std::memory_order_relaxed);
+
+		auto head = registry.load(std::memory_order_relaxed);
+
+		do
+		{
+			page->next = head;
+		} while (!registry.compare_exchange_weak(head, page, std::memory_order_release, std::memory_order_relaxed));
+
+		return &page->slots[0];
+	}
+
+	void * CAllocator::allocLarge(std::size_t memsize, std::size_t align)
+	{
+		auto const offset = std::max(sizeof(slab_header), align);
+
+		// the data must start within the first slab, otherwise slabFrom() can't find the header.
+		if (offset >= slab_size)
+			return nullptr;
+
+		auto const size = offset + memsize + sizeof(end_marker);
+		auto const spanClass = spanClassFor(size);
+
+		slab_header * header = nullptr;
+
+		if (spanClass < num_span_classes)
+		{
+			if (auto cache = localCache())
+			{
+				header = takeSpan(cache->spans[spanClass], spanClass);
+			}
+			else
+			{
+				cpl::CMutex lock(overflowMutex);
+				header = takeSpan(overflowCache.spans[spanClass], spanClass);
+			}
+		}
+
+		if (!header)
+		{
+			auto memory = cpl::Misc::alignedMalloc<std::byte, slab_size>(spanClass < num_span_classes ? spanSize(spanClass) : size);
+
+			if (!memory)
+				return nullptr;
+
+			header = new (memory) slab_header {};
+			header->owner = this;
+			header->sizeClass = large_class;
+			header->spanClass = spanClass;
+			header->slot = track(memory);
+
+			if (!header->slot)
+			{
+				cpl::Misc::alignedFree(memory);
+				return nullptr;
+			}
+		}
+
+		header->dataOffset = offset;
+		header->size = memsize;
+
+		auto block = reinterpret_cast<std::byte *>(header) + offset;
+		std::memset(block, 0, memsize);
+
+		// set a unique value in the end to so we can check if memory has been overwritten.
+		setCanary(block + memsize);
+
+		return block;
 	}
 
 	void CAllocator::free(void * block) 
@@ -113,30 +379,195 @@ namespace ape
 		if(!block)
 			return;
 
-		cpl::CMutex lock (mutex);
+		auto header = slabFrom(block);
 
-		mem_block * header = headerFromBlock(block);
+		if (header->owner != this)
+			throwMemoryError("free of pointer not owned by allocator: ", block);
 
-		if (!header)
-			cpl::CProtected::instance().throwException<std::runtime_error>("double free of pointer: " + std::to_string((std::uintptr_t)block));
+		if (header->sizeClass == large_class)
+			return freeLarge(header, block);
+
+		auto const sizeClass = header->sizeClass;
+		auto const offset = static_cast<std::size_t>(reinterpret_cast<std::byte *>(block) - reinterpret_cast<std::byte *>(header + 1));
+
+		if (sizeClass >= num_classes || offset % classSize(sizeClass) != 0)
+			throwMemoryError("free of invalid pointer: ", block);
+
+		auto& size = requestedSize(block, sizeClass);
+
+		if (size == free_marker)
+			throwMemoryError("double free of pointer: ", block);
+		else if (size > classSize(sizeClass) - trailer_size || !hasCanary(static_cast<std::byte *>(block) + size))
+			throwMemoryError("heap corruption detected at pointer: ", block);
+
+		size = free_marker;
+
+		auto node = static_cast<free_node *>(block);
+
+		if (auto cache = localCache())
+		{
+			freeTo(cache->bins[sizeClass], sizeClass, node);
+		}
+		else
+		{
+			cpl::CMutex lock(overflowMutex);
+			freeTo(overflowCache.bins[sizeClass], sizeClass, node);
+		}
+	}
+
+	void CAllocator::freeTo(bin & b, std::size_t sizeClass, free_node * node)
+	{
+		node->next = b.head;
+		b.head = node;
+		b.count++;
+
+		auto const limit = std::max<std::size_t>(4, local_cache_bytes / classSize(sizeClass));
+
+		if (b.count <= limit)
+			return;
+
+		// hand half of the cache back, so blocks freed here can be reused by other threads.
+		// amortized O(1), as it happens once per limit / 2 frees.
+		auto const spill = limit / 2;
+		auto first = b.head, last = b.head;
+
+		for (std::size_t i = 1; i < spill; ++i)
+			last = last->next;
+
+		b.head = last->next;
+		b.count -= spill;
 
-		removeBlock(header);
-		cpl::Misc::alignedFree(header);
+		pushShared(sharedFree[sizeClass], first, last);
 	}
 
+	void CAllocator::freeLarge(slab_header * header, void * block)
+	{
+		auto m = reinterpret_cast<std::byte *>(header);
+
+		if (header->dataOffset == 0)
+			throwMemoryError("double free of pointer: ", block);
+
+		if (reinterpret_cast<std::byte *>(block) != m + header->dataOffset)
+			throwMemoryError("free of invalid pointer: ", block);
+
+		if (!hasCanary(m + header->dataOffset + header->size))
+			throwMemoryError("heap corruption detected at pointer: ", block);
+
+		header->dataOffset = 0;
+
+		auto const spanClass = header->spanClass;
+
+		if (spanClass == num_span_classes)
+		{
+			header->slot->store(nullptr, std::memory_order_release);
+			cpl::Misc::alignedFree(m);
+			return;
+		}
+
+		if (auto cache = localCache())
+		{
+			cacheSpan(cache->spans[spanClass], spanClass, header);
+		}
+		else
+		{
+			cpl::CMutex lock(overflowMutex);
+			cacheSpan(overflowCache.spans[spanClass], spanClass, header);
+		}
+	}
+
+	CAllocator::slab_header * CAllocator::takeSpan(bin & b, std::size_t spanClass)
+	{
+		// same as refill(): take everything other threads have returned in one go.
+		if (!b.head)
+		{
+			b.head = sharedSpans[spanClass].exchange(nullptr, std::memory_order_acquire);
+			b.count = 0;
+		}
+
+		if (!b.head)
+			return nullptr;
+
+		auto node = b.head;
+		b.head = node->next;
+		if (b.count)
+			b.count--;
+
+		return reinterpret_cast<slab_header *>(node) - 1;
+	}
+
+	void CAllocator::cacheSpan(bin & b, std::size_t spanClass, slab_header * header)
+	{
+		// the header stays intact, so the span keeps its registry slot while cached.
+		auto node = reinterpret_cast<free_node *>(header + 1);
+
+		if (b.count < local_cache_spans)
+		{
+			node->next = b.head;
+			b.head = node;
+			b.count++;
+			return;
+		}
+
+		// let other threads reuse what this one doesn't keep around
+		pushShared(sharedSpans[spanClass], node, node);
+	}
+
+	void CAllocator::pushShared(std::atomic<free_node *>& list, free_node * first, free_node * last) noexcept
+	{
+		auto head = list.load(std::memory_order_relaxed);
+
+		do
+		{
+			last->next = head;
+		} while (!list.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	void CAllocator::resetBins(thread_cache & cache) noexcept
+	{
+		for (auto& b : cache.bins)
+			b = bin { nullptr, 0, nullptr, nullptr };
+
+		for (auto& b : cache.spans)
+			b = bin { nullptr, 0, nullptr, nullptr };
+	}
 
 	void CAllocator::clear()
 	{
-		cpl::CMutex lock (mutex);
-		for(auto it = allocations.begin(); it != allocations.end(); it++)
+		currentChunk.store(nullptr, std::memory_order_release);
+
+		// chunks and large allocations
+		for (auto page = registry.load(std::memory_order_acquire); page; page = page->next)
 		{
-			cpl::Misc::alignedFree(*it);
+			for (auto& slot : page->slots)
+			{
+				if (auto memory = slot.exchange(nullptr, std::memory_order_acq_rel))
+					cpl::Misc::alignedFree(static_cast<std::byte *>(memory));
+			}
 		}
-		allocations.clear();
+
+		for (auto& list : sharedFree)
+			list.store(nullptr, std::memory_order_release);
+
+		for (auto& list : sharedSpans)
+			list.store(nullptr, std::memory_order_release);
+
+		// caches stay claimed by their threads, but lose their (now released) blocks.
+		for (auto& cache : threadCaches)
+			resetBins(cache);
+
+		cpl::CMutex lock(overflowMutex);
+		resetBins(overflowCache);
 	}
 
 	CAllocator::~CAllocator()
 	{
 		clear();
+
+		for (auto page = registry.load(); page; )
+		{
+			auto next = page->next;
+			delete page;
+			page = next;
+		}
 	}
 };
\ No newline at end of file
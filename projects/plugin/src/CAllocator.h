@@ -27,6 +27,17 @@
 		free'd on destruction).
 		All memory is zeroinitialized and contains corrupted memory checks.
 
+		Small allocations are served from power-of-two size classes carved out of
+		slabs, through per-thread caches backed by lock-free shared free lists.
+		The slab a block lives in is found by masking the pointer, so frees are O(1)
+		and need no per-block header.
+		Large allocations of up to a megabyte live in power-of-two spans of slabs,
+		which are cached per size when freed the same way blocks are. Only growing
+		past the peak usage reaches the system allocator, which takes no lock of
+		its own. Only threads beyond the number of caches share a locked fallback cache.
+		Every block ends in a canary right after the requested bytes, so overruns
+		of even a single byte are caught when the block is freed.
+
 *************************************************************************************/
 
 #ifndef _CALLOCATOR_H
@@ -34,12 +45,14 @@
 	#define _CALLOCATOR_H
 	#define CALLOCATOR_CATCH_DOUBLEFREE
 
-	#include <list>
 	#include <cstdlib>
+	#include <cstddef>
+	#include <cstdint>
+	#include <atomic>
+	#include <thread>
 	#include <cpl/MacroConstants.h>
 	#include <ape/SharedInterface.h>
 	#include <cpl/CMutex.h>
-	#include <set>
 	
 	namespace ape 
 	{
@@ -51,16 +64,34 @@
 
 		public:
 			CAllocator(unsigned align);
-			void * alloc(Label l, size_t memsize);
+			CAllocator(const CAllocator&) = delete;
+			CAllocator& operator = (const CAllocator&) = delete;
+
+			/// <summary>
+			/// Returns zeroed memory of at least <paramref name="memsize"/> bytes, aligned to
+			/// at least <paramref name="align"/> or the alignment given in the constructor.
+			/// Safe to call concurrently with other allocs and frees.
+			/// </summary>
+			void * alloc(Label l, std::size_t memsize, std::size_t align = 0);
 			
 			template <typename T> 
 				T * alloc(Label l)
 				{
-					return reinterpret_cast<T*> (this->alloc(l, sizeof (T)));
+					return reinterpret_cast<T*> (this->alloc(l, sizeof (T), alignof(T)));
 				}
 
-
+			/// <summary>
+			/// Returns a block to the allocator. May be called from any thread, not only
+			/// the allocating one. Throws on corrupted blocks, blocks of other allocators and
+			/// double frees, unless the memory was handed to another allocation in between or
+			/// (for large blocks above the cached sizes) released to the system.
+			/// Pointers that never came from a CAllocator are undefined behaviour.
+			/// </summary>
 			void free(void * block);
+
+			/// <summary>
+			/// Releases every allocation at once. Must not race with alloc() or free().
+			/// </summary>
 			void clear();
 
 			~CAllocator();
@@ -68,41 +99,101 @@
 		private:
 
 			static const unsigned int end_marker = 0xBADC0DE; 
+			// stored in place of the requested size of freed blocks. Larger than any size class.
+			static const unsigned int free_marker = 0xDEADF4EE;
+
+			static constexpr std::size_t slab_size = 1 << 16;
+			static constexpr std::size_t slabs_per_chunk = 16;
+			static constexpr std::size_t chunk_size = slab_size * slabs_per_chunk;
+			static constexpr std::size_t min_class_shift = 5;
+			static constexpr std::size_t num_classes = 10;
+			static constexpr std::size_t large_class = num_classes;
+			// large allocations of 64 KB to 1 MB are rounded up to spans of this many size classes, which are reused
+			static constexpr std::size_t num_span_classes = 5;
+			static constexpr std::size_t local_cache_spans = 2;
+			static constexpr std::size_t max_thread_caches = 16;
+			static constexpr std::size_t local_cache_bytes = slab_size;
+			static constexpr std::size_t registry_slots = 64;
+			// the canary after the requested bytes, and the requested size in the last bytes of the size class
+			static constexpr std::size_t trailer_size = 2 * sizeof(unsigned int);
+
+			struct free_node
+			{
+				free_node * next;
+			};
 
-			unsigned alignment;
-			struct mem_block;
-			std::list<mem_block*> allocations;
+			// sits at the start of every slab_size aligned slab, and of every large allocation.
+			struct alignas(64) slab_header
+			{
+				CAllocator * owner;
+				std::size_t sizeClass;
+				// large allocations only, with a data offset of zero when freed
+				std::size_t dataOffset;
+				std::size_t size;
+				std::size_t spanClass;
+				std::atomic<void *> * slot;
+				// first slab of a chunk only: slabs of the chunk handed out so far
+				std::atomic<std::size_t> taken;
+			};
+
+			// memory to release on clear(). Pages are only ever added, slots are claimed and emptied with atomics.
+			struct registry_page
+			{
+				std::atomic<void *> slots[registry_slots];
+				registry_page * next;
+			};
 
-			typedef std::list<mem_block*>::iterator mem_it;
+			struct bin
+			{
+				free_node * head;
+				std::size_t count;
+				std::byte * cursor, * end;
+			};
 
-			struct mem_block
+			struct thread_cache
 			{
-				struct mem_end
-				{
-					unsigned int ncheck;
-				};
+				std::atomic<std::thread::id> owner;
+				bin bins[num_classes];
+				// freed large allocations, linked through the memory after their header
+				bin spans[num_span_classes];
+			};
 
-				union
-				{
-					struct
-					{
-						// sizeof start of header + memoryblock + mem_end
-						std::size_t totalSize;
-						mem_end * end;
-						Label memLabel;
-					};
+			static constexpr std::size_t classSize(std::size_t sizeClass) noexcept { return std::size_t(1) << (sizeClass + min_class_shift); }
+			static constexpr std::size_t spanSize(std::size_t spanClass) noexcept { return slab_size << spanClass; }
+			static std::size_t classFor(std::size_t size) noexcept;
+			static std::size_t spanClassFor(std::size_t size) noexcept;
+			static slab_header * slabFrom(void * block) noexcept;
+			static unsigned int& requestedSize(void * block, std::size_t sizeClass) noexcept;
+			static void setCanary(std::byte * end) noexcept;
+			static bool hasCanary(const std::byte * end) noexcept;
+
+			thread_cache * localCache();
+			void * allocFrom(bin& b, std::size_t sizeClass);
+			void freeTo(bin& b, std::size_t sizeClass, free_node * node);
+			bool refill(bin& b, std::size_t sizeClass);
+			slab_header * acquireSlab();
+			std::atomic<void *> * track(void * memory);
+			void * allocLarge(std::size_t memsize, std::size_t align);
+			void freeLarge(slab_header * header, void * block);
+			slab_header * takeSpan(bin& b, std::size_t spanClass);
+			void cacheSpan(bin& b, std::size_t spanClass, slab_header * header);
+			static void pushShared(std::atomic<free_node *>& list, free_node * first, free_node * last) noexcept;
+			void resetBins(thread_cache& cache) noexcept;
 
-					std::byte align[32];
-				};
+			unsigned alignment;
+			const std::uint64_t id;
 
+			std::atomic<free_node *> sharedFree[num_classes];
+			std::atomic<free_node *> sharedSpans[num_span_classes];
+			thread_cache threadCaches[max_thread_caches];
 
-				// held memory is after this block, so we add the size of this block to it's pointer.
-				void * getMemory() { return reinterpret_cast<char*>(this) + sizeof(*this); }
-			};
+			// used by threads that couldn't claim a cache of their own
+			cpl::CMutex::Lockable overflowMutex;
+			thread_cache overflowCache;
 
-			mem_block * headerFromBlock(void * block);
-			bool removeBlock(mem_block * header);
-			cpl::CMutex::Lockable mutex;
+			// the chunk slabs are currently handed out from
+			std::atomic<slab_header *> currentChunk;
+			std::atomic<registry_page *> registry;
 		};
 
 	};
@@ -42,6 +42,9 @@
 #include "Plugin/PluginAudioFile.h"
 #include "Plugin/PluginFFT.h"
 #include "Plugin/PluginAudioWriter.h"
+#include "Engine/RealtimePool.h"
+#include <atomic>
+#include <exception>
 
 namespace ape::api
 {
@@ -240,14 +243,26 @@ namespace ape::api
 	void * APE_API alloc(APE_SharedInterface * iface, APE_AllocationLabel label, size_t size, size_t align) 
 	{
 		VALIDATE_IFACE(iface);
-		return IEx::downcast(*iface).getCurrentPluginState().getPluginAllocator().alloc(label, size);
+
+		auto& state = IEx::downcast(*iface).getCurrentPluginState();
+
+		if (label == APE_Alloc_Temp)
+			return state.getScratchArena().alloc(size, align);
+
+		return state.getPluginAllocator().alloc(label, size, align);
 	}
 
 	void APE_API free(APE_SharedInterface * iface, void * ptr) 
 	{
 		VALIDATE_IFACE(iface);
 
-		IEx::downcast(*iface).getCurrentPluginState().getPluginAllocator().free(ptr);
+		auto& state = IEx::downcast(*iface).getCurrentPluginState();
+
+		// scratch memory is released in bulk after each block
+		if (state.getScratchArena().owns(ptr))
+			return;
+
+		state.getPluginAllocator().free(ptr);
 	}
 
 	void APE_API setInitialDelay(APE_SharedInterface * iface, int samples) 
@@ -335,7 +350,7 @@ namespace ape::api
 		if (!pstate.isProcessing())
 			THROW("Can only be called from a processing callback");
 
-		engine.handleTraceCallback(nameTuple, numNames, values, numValues);
+		engine.handleTraceCallback(pstate, nameTuple, numNames, values, numValues);
 
 		return 1;
 	}
@@ -704,5 +719,84 @@ namespace ape::api
         return 0;
     }
 
+	namespace
+	{
+		struct ParallelLoop
+		{
+			APE_ParallelBody body;
+			void* context;
+			std::atomic<bool> failed;
+			std::exception_ptr failure;
+		};
+
+		void runParallelChunk(void* context, std::size_t begin, std::size_t end)
+		{
+			auto& loop = *static_cast<ParallelLoop*>(context);
+
+			// no reason to keep going, the plugin is being disabled
+			if (loop.failed.load(std::memory_order_relaxed))
+				return;
+
+			if (RealtimePool::isWorkerThread())
+				clearThreadFaults();
 
+			try
+			{
+				// faults must not unwind through the pool, so every chunk is protected - not just the ones on workers.
+				cpl::CProtected::instance().runProtectedCode(
+					[&] { loop.body(loop.context, begin, end); }
+				);
+			}
+			catch (...)
+			{
+				// published to the calling thread when the pool joins the chunk
+				if (!loop.failed.exchange(true))
+					loop.failure = std::current_exception();
+			}
+		}
+	}
+
+	void APE_API parallelFor(APE_SharedInterface * iface, size_t count, size_t grain, APE_ParallelBody body, void* context)
+	{
+		VALIDATE_IFACE(iface);
+		REQUIRES_NOTNULL(body);
+
+		auto& engine = IEx::downcast(*iface).getEngine();
+		auto& pstate = IEx::downcast(*iface).getCurrentPluginState();
+
+		if (!pstate.isProcessing())
+			THROW("Can only be called from a processing callback");
+
+		if (count == 0)
+			return;
+
+		auto pool = engine.getRealtimePool();
+
+		if (!pool)
+		{
+			body(context, 0, count);
+			return;
+		}
+
+		ParallelLoop loop { body, context, { false }, nullptr };
+
+		pool->parallelFor(count, grain, &runParallelChunk, &loop);
+
+		if (loop.failed.load(std::memory_order_acquire))
+			std::rethrow_exception(loop.failure);
+	}
+
+	APE_ProfileRing* APE_API getProfileRing(APE_SharedInterface * iface)
+	{
+		VALIDATE_IFACE(iface);
+
+		auto& pstate = IEx::downcast(*iface).getCurrentPluginState();
+
+		// the ring is single producer, which is the processing thread
+		if (!pstate.isProcessing())
+			THROW("Can only be called from a processing callback");
+
+		auto timeline = pstate.getScopeTimeline();
+		return timeline ? &timeline->getRing() : nullptr;
+	}
 }
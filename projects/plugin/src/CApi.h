@@ -71,6 +71,7 @@
 		/// <summary>
 		/// The memory allocation routine used by the hosted code. It's wrapped here so we can change
 		/// the routine at will.At some point, register all allocations in a list for free'ing at exit.
+		/// APE_Alloc_Temp allocations are uninitialized, and only valid until the current block has been processed.
 		/// </summary>
 		void *		APE_API			alloc(APE_SharedInterface * iface, APE_AllocationLabel label, size_t size, size_t align);
 		/// <summary>
@@ -130,5 +131,15 @@
 		void		APE_API			writeAudioFile(APE_SharedInterface * iface, int file, unsigned int numSamples, const float* const* data);
 		void		APE_API			closeAudioFile(APE_SharedInterface * iface, int file);
         int         APE_API         getPlayHeadPosition(APE_SharedInterface * iface, APE_PlayHeadPosition* result);
+		/// <summary>
+		/// Runs body over [0, count) in chunks of grain indices, on the audio thread and the engine's
+		/// real-time workers. Runs serially if the workers are busy or not started yet.
+		/// Faults inside the body are rethrown on the calling thread after the loop has joined.
+		/// </summary>
+		void		APE_API			parallelFor(APE_SharedInterface * iface, size_t count, size_t grain, APE_ParallelBody body, void* context);
+		/// <summary>
+		/// The ring of events written by APE_PROFILE_SCOPE() while processing, or null if the project doesn't profile scopes.
+		/// </summary>
+		APE_ProfileRing* APE_API	getProfileRing(APE_SharedInterface * iface);
 	};
 #endif
@@ -59,6 +59,9 @@ namespace ape
 
 		auto& engine = SharedInterfaceEx::downcast(*project->iface).getEngine();
 
+		if (diag == APE_Diag_Info && project->optimizationRemarks && engine.getController().optimizationRemark(*project, text))
+			return;
+
 		engine.getController().externalDiagnostic(diag, text);
 	}
 
@@ -121,7 +124,7 @@ namespace ape
 		return project.compiler->bindings.onEvent(&project, e);
 	}
 
-	bool CCodeGenerator::compileProject(ProjectEx& project)
+	Status CCodeGenerator::compileProject(ProjectEx& project)
 	{
 		if (project.state < CodeState::Created) 
 		{
@@ -133,13 +136,19 @@ namespace ape
 		}
 		else 
 		{
-			if(project.compiler->bindings.compileProject(&project) == Status::STATUS_OK)
+			const auto status = project.compiler->bindings.compileProject(&project);
+
+			if(status == Status::STATUS_OK)
 			{
 				project.state = CodeState::Compiled;
-				return true;
+				return status;
+			}
+			else if (status == Status::STATUS_MISS)
+			{
+				return status;
 			}
 		}
-		return false;
+		return Status::STATUS_ERROR;
 	}
 
 	bool CCodeGenerator::initProject(ProjectEx& project)
@@ -178,49 +187,71 @@ namespace ape
 			// ensure lID is valid here !
 			try
 			{
-				const libconfig::Setting& languages = engine.getSettings().root()["languages"];
-				std::string langID;
-                
-				for (auto && lang : languages)
+				if (CompilerBinding::isPrebuiltModule(fileID) && project.files && project.files[0])
 				{
-					if (!lang.isGroup())
-						continue;
-					for (auto && ext : lang["extensions"])
+					// keyed by the modification time as well, so exporting again to the same file is picked up
+					// while projects still use the previous module
+					std::error_code ec;
+					const cpl::fs::path modulePath = project.files[0];
+					const auto stamp = cpl::fs::last_write_time(modulePath, ec).time_since_epoch().count();
+					const auto key = modulePath.string() + "@" + std::to_string(stamp);
+
+					std::lock_guard<std::mutex> lock(prebuiltMutex);
+					auto module = prebuilt.find(key);
+
+					if (module == prebuilt.end())
+						module = prebuilt.emplace(key, PrebuiltModule { std::make_unique<CompilerBinding>(modulePath, engine.uniqueInstanceID()) }).first;
+
+					module->second.projects++;
+					project.arguments = new char[1] { '\0' };
+					project.compiler = module->second.binding.get();
+				}
+				else
+				{
+					const libconfig::Setting& languages = engine.getSettings().root()["languages"];
+					std::string langID;
+
+					for (auto && lang : languages)
 					{
-						if (fileID == ext.c_str())
+						if (!lang.isGroup())
+							continue;
+						for (auto && ext : lang["extensions"])
 						{
-							langID = lang.getName();
-							break;
+							if (fileID == ext.c_str())
+							{
+								langID = lang.getName();
+								break;
+							}
 						}
 					}
-				}
 
-				if (!langID.size())
-				{
-					printError("Cannot find compatible compiler for file id \"" + fileID + "\", check your extension settings");
-					return false;
-				}
+					if (!langID.size())
+					{
+						printError("Cannot find compatible compiler for file id \"" + fileID + "\", check your extension settings");
+						return false;
+					}
+
+					const libconfig::Setting & langstts = languages[langID]["compiler"];
 
-				const libconfig::Setting & langstts = languages[langID]["compiler"];
-
-				// compiler is automatically constructed and loaded if it doesn't exist.
-				// if it does, we get a reference to it.
-                
-                auto compiler = compilers.find(langID);
-                
-                if(compiler == compilers.end())
-                {
-                    auto binding = std::make_unique<CompilerBinding>(langstts);
-                    compilers[langID] = std::move(binding);
-                    compiler = compilers.find(langID);
-                }
-                
-				std::string const args = langstts["arguments"].c_str();
-				auto argString = new char[args.length() + 1];
-				std::copy(args.begin(), args.end(), argString);
-				argString[args.length()] = '\0';
-				project.arguments = argString;
-				project.compiler = compiler->second.get();
+					// compiler is automatically constructed and loaded if it doesn't exist.
+					// if it does, we get a reference to it.
+
+					auto compiler = compilers.find(langID);
+
+					if(compiler == compilers.end())
+					{
+						auto binding = std::make_unique<CompilerBinding>(langstts);
+						compilers[langID] = std::move(binding);
+						compiler = compilers.find(langID);
+					}
+
+					std::string const args = langstts["arguments"].c_str();
+					auto argString = new char[args.length() + 1];
+					std::copy(args.begin(), args.end(), argString);
+					argString[args.length()] = '\0';
+					project.arguments = argString;
+					project.compiler = compiler->second.get();
+				}
 			}
 			catch (libconfig::ParseException & e)
 			{
@@ -261,6 +292,8 @@ namespace ape
 			return true;
 		}
 
+		// never released otherwise
+		releasePrebuilt(project.compiler);
 		return false;
 	}
 
@@ -277,7 +310,10 @@ namespace ape
 			printError("Warning: Releasing activated project!");
 		}
 
-		if(project.compiler->bindings.releaseProject(&project) == STATUS_OK) 
+		const bool released = project.compiler->bindings.releaseProject(&project) == STATUS_OK;
+		releasePrebuilt(project.compiler);
+
+		if(released) 
 		{
 			project.state = CodeState::Released;
 			return true;
@@ -285,6 +321,22 @@ namespace ape
 		return false;
 	}
 
+	void CCodeGenerator::releasePrebuilt(const CompilerBinding* binding)
+	{
+		std::lock_guard<std::mutex> lock(prebuiltMutex);
+
+		for (auto it = prebuilt.begin(); it != prebuilt.end(); ++it)
+		{
+			if (it->second.binding.get() == binding)
+			{
+				if (--it->second.projects == 0)
+					prebuilt.erase(it);
+
+				return;
+			}
+		}
+	}
+
 	void CCodeGenerator::cleanAllCaches()
 	{
 		try
@@ -36,6 +36,7 @@
 	#include <string>
 	#include "CApi.h"
 	#include <map>
+	#include <mutex>
 	#include <vector>
 	#include "Settings.h"
 	#include "ProjectEx.h"
@@ -71,7 +72,11 @@
 			Status onEvent(ProjectEx & project, Event * e);
 
 
-			bool compileProject(ProjectEx & project);
+			/// <summary>
+			/// Returns STATUS_OK on success, STATUS_MISS if the project only restores compiled code that isn't available (see
+			/// APE_Project::restoreArtifact), and STATUS_ERROR otherwise.
+			/// </summary>
+			Status compileProject(ProjectEx & project);
 			bool initProject(ProjectEx & project);
 			bool createProject(ProjectEx & project); 
 			bool releaseProject(ProjectEx & project);
@@ -83,8 +88,22 @@
 			static void pluginDiagnostic(Project* project, Diagnostic diag, const char* text);
 
 			void printError(const cpl::string_ref message, APE_TextColour colour = APE_TextColour_Error);
+			/// <summary>
+			/// Unloads the native module of a released project once no other project uses it.
+			/// </summary>
+			void releasePrebuilt(const CompilerBinding* binding);
 
             std::map<std::string, std::unique_ptr<CompilerBinding>> compilers;
+			struct PrebuiltModule
+			{
+				std::unique_ptr<CompilerBinding> binding;
+				std::size_t projects = 0;
+			};
+
+			// native modules exported ahead of time, by path and modification time.
+			// projects are created and released on compiler threads, too.
+			std::map<std::string, PrebuiltModule> prebuilt;
+			std::mutex prebuiltMutex;
 			ape::Engine& engine;
 
 		};
@@ -116,6 +116,17 @@
 
 				archive["params"] << engine.getParameterManager().getParameterSet();
 
+				// lets the session be restored from the compile cache, without compiling
+				if (auto project = engine.getController().getCurrentProject())
+				{
+					archive["artifact"] << std::string(project->artifact);
+					archive["artifact-optimization"] << static_cast<std::int32_t>(project->optimizationLevel);
+				}
+
+				// the graph is compiled again on restore, it runs independently of the plugin
+				if (!engine.getController().getGraphPath().empty())
+					archive["graph"] << engine.getController().getGraphPath();
+
 				auto content = serializer.compile(true);
 
 				destination.append(content.getBlock(), content.getSize());
@@ -149,29 +160,32 @@
 					scope["state"] >> engine.getOscilloscopeData().getContent();
 				}
 
+				if (builder.findForKey("graph"))
+				{
+					std::string graphPath;
+					builder["graph"] >> graphPath;
+					controller.loadGraph(graphPath);
+				}
+
 				if (!isActivated)
 					return true;
 
-				// try to compile the project
-				auto plugin = controller.createPlugin(false).get();
+				std::string artifact;
+				std::int32_t optimizationLevel = APE_Optimization_Best;
 
-				// check if success
-				if (!plugin)
+				if (builder.findForKey("artifact") && builder.findForKey("artifact-optimization"))
 				{
-					controller.getConsole().printLine(CConsole::Error,
-						"[Serializer] : Error compiling session file (%s)!", sessionName.c_str());
-					return false;
+					builder["artifact"] >> artifact;
+					builder["artifact-optimization"] >> optimizationLevel;
 				}
 
-				controller.setPlugin(std::move(plugin), EngineCommand::AlwaysTakeEngineValue);
-
-				// project is now compiled, lets try to activate it
-				if (!controller.performCommand(UICommand::Activate))
+				// restores cached code right away, or compiles in the background while the plugin is bypassed.
+				// either way, the parameters restored below are taken by the plugin.
+				if (!controller.restorePlugin(artifact, static_cast<APE_Optimization_Level>(optimizationLevel)))
 				{
 					controller.getConsole().printLine(CConsole::Error,
-						"[Serializer] : Error activating project (%s)!", sessionName.c_str());
+						"[Serializer] : Error restoring session (%s)!", sessionName.c_str());
 					return false;
-
 				}
 
 				if (auto* list = builder.findForKey("params"))
@@ -199,9 +213,6 @@
 					}
 				}
 
-				auto& commands = controller.getUICommandState();
-				commands.changeValueExternally(commands.activationState, 1.0);
-
 				return true;
 
 			}
@@ -249,29 +260,15 @@
 				// check if the project was running:
 				if (se->isActivated)
 				{
-					// try to compile the project
-					auto plugin = controller.createPlugin(false).get();
-
-					// check if success
-					if(!plugin)
+					// old sessions have no compiled artifact, so this compiles in the background
+					if (!controller.restorePlugin({}, APE_Optimization_Best))
 					{
 						console.printLine(CConsole::Error,
-							"[Serializer] : Error compiling session file (%s)!", se->getFileNameConst());
+							"[Serializer] : Error restoring session file (%s)!", se->getFileNameConst());
 						return false;
 					}
 
-					controller.setPlugin(std::move(plugin));
-
-					// project is now compiled, lets try to activate it
-					if (!controller.performCommand(UICommand::Activate))
-					{
-						console.printLine(CConsole::Error,
-							"[Serializer] : Error activating project (%s)!", controller.getProjectName().c_str());
-						return false;
-
-					}
-					// project is up and running! now we just need to reset parameters
-					// get values
+					// now we just need to reset parameters, which the plugin takes once it's running
 					const SerializedEngine::ControlValue * values = se->getValuesConst();
 
 					auto& manager = engine.getParameterManager();
@@ -280,9 +277,6 @@
 					{
 						manager.setParameter(static_cast<cpl::Parameters::Handle>(i), values[i].value);
 					}
-
-					auto& commands = controller.getUICommandState();
-					commands.changeValueExternally(commands.activationState, 1.0);
 				}
 
 				return true;
@@ -38,6 +38,8 @@ namespace ape
         , tokeniser(settings)
         , textEditor(settings, *document, &tokeniser)
         , tracer(textEditor)
+        , remarks(textEditor)
+        , heat(textEditor)
         , scale(1.0f)
         , dirty(false)
         , source(manager)
@@ -51,10 +53,14 @@ namespace ape
         wrapper.setVisible(true);
         wrapper.addChildComponent(textEditor);
         wrapper.addChildComponent(tracer);
+        wrapper.addChildComponent(remarks);
+        wrapper.addChildComponent(heat);
         textEditor.setLineNumbersShown(true);
 
         textEditor.setVisible(true);
         tracer.setVisible(true);
+        remarks.setVisible(true);
+        heat.setVisible(true);
         tracer.setEditable(settings.lookUpValue(false, "editor", "enable_scopepoints"));
 
         textEditor.addMouseListener(this, true);
@@ -97,7 +103,9 @@ namespace ape
         wrapper.setBounds(bounds.toType<int>());
 		// local space
         tracer.setBounds(bounds.withRight(10).withTop(0).toType<int>());
-        textEditor.setBounds(bounds.withTop(0).withLeft(10).toType<int>());
+        heat.setBounds(bounds.withTop(0).withLeft(10).withWidth(heat.getPreferredWidth()).toType<int>());
+        textEditor.setBounds(bounds.withTop(0).withLeft(10 + heat.getPreferredWidth()).toType<int>());
+        remarks.setBounds(textEditor.getBounds());
     }
 
     BreakpointComponent & CodeEditorComponent::getLineTracer() noexcept 
@@ -105,6 +113,21 @@ namespace ape
         return tracer; 
     }
 
+    RemarkComponent & CodeEditorComponent::getRemarks() noexcept 
+    { 
+        return remarks; 
+    }
+
+    void CodeEditorComponent::setLineProfile(std::vector<float> profile)
+    {
+        const bool resize = profile.empty() != (heat.getPreferredWidth() == 0);
+
+        heat.setProfile(std::move(profile));
+
+        if (resize)
+            resized();
+    }
+
     inline void CodeEditorComponent::serialize(cpl::CSerializer::Archiver & ar, cpl::Version version)
     {
         ar << scale;
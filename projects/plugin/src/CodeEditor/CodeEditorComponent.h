@@ -40,6 +40,8 @@
 #include "CLangCodeTokeniser.h"
 #include "CodeTextEditor.h"
 #include "BreakpointComponent.h"
+#include "RemarkComponent.h"
+#include "HeatComponent.h"
 #include "CodeDocumentListener.h"
 #include "EditorMenuModel.h"
 
@@ -60,6 +62,11 @@ namespace ape
         void rescale(float newScale);
         void resized() override;
         BreakpointComponent& getLineTracer() noexcept;
+        RemarkComponent& getRemarks() noexcept;
+        /// <summary>
+        /// Shows the profile in the heat gutter, see SourceManager::setLineProfile().
+        /// </summary>
+        void setLineProfile(std::vector<float> profile);
         void serialize(cpl::CSerializer::Archiver& ar, cpl::Version version) override;
         void deserialize(cpl::CSerializer::Builder& builder, cpl::Version version) override;
         void documentChangedName(const cpl::string_ref newName) override;
@@ -74,6 +81,8 @@ namespace ape
 		juce::Component wrapper;
 		CodeTextEditor textEditor;
 		BreakpointComponent tracer;
+		RemarkComponent remarks;
+		HeatComponent heat;
         EditorMenuModel menuModel;
         juce::MenuBarComponent menuComponent;
 		float scale;
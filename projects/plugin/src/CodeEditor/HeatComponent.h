@@ -0,0 +1,135 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:HeatComponent.h
+		
+		A gutter next to the breakpoints showing how much of the processing time
+		is spent on every line of the source, from the line profiler
+
+*************************************************************************************/
+
+#ifndef HEATCOMPONENT_H
+#define HEATCOMPONENT_H
+
+#include <cpl/Common.h>
+#include <algorithm>
+#include <vector>
+#include "CodeTextEditor.h"
+
+namespace ape
+{
+
+	class HeatComponent
+		: public juce::Component
+		, private CodeTextEditor::Listener
+		, private juce::AsyncUpdater
+	{
+	public:
+
+		HeatComponent(CodeTextEditor& codeEditorView)
+			: codeEditor(codeEditorView)
+		{
+			codeEditor.addCompositionListener(this);
+		}
+
+		~HeatComponent()
+		{
+			codeEditor.removeCompositionListener(this);
+		}
+
+		/// <summary>
+		/// Width needed to show the current profile, zero if there's none - the gutter appears with the profile.
+		/// </summary>
+		int getPreferredWidth() const
+		{
+			return profile.empty() ? 0 : getFont().getStringWidth("100.0%") + 6;
+		}
+
+		void paint(juce::Graphics& g) override
+		{
+			g.fillAll({ 0x3E, 0x3E, 0x3E });
+
+			if (profile.empty())
+				return;
+
+			auto const lineHeight = codeEditor.getLineHeight();
+			auto const start = codeEditor.getFirstLineOnScreen();
+			auto const end = std::min<int>(start + codeEditor.getNumLinesOnScreen() + 1, static_cast<int>(profile.size()));
+
+			g.setFont(getFont());
+
+			for (int line = start; line < end; ++line)
+			{
+				auto const fraction = profile[line];
+
+				// less than a tenth of a percent is mostly noise
+				if (fraction < 0.001f)
+					continue;
+
+				juce::Rectangle<int> space{ 0, (line - start) * lineHeight, getWidth(), lineHeight };
+
+				// relative to the hottest line, so the distribution is visible whatever the load
+				g.setColour(juce::Colour(hotColour).withAlpha(0.15f + 0.85f * fraction / hottest));
+				g.fillRect(space);
+
+				g.setColour(juce::Colours::white);
+				g.drawText(juce::String(fraction * 100, 1) + "%", space.reduced(3, 0), juce::Justification::centredRight, false);
+			}
+		}
+
+		/// <summary>
+		/// Replaces the share of processing time of every zero-based line, see SourceManager::setLineProfile().
+		/// </summary>
+		void setProfile(std::vector<float> newProfile)
+		{
+			profile = std::move(newProfile);
+			hottest = profile.empty() ? 1.0f : std::max(*std::max_element(profile.begin(), profile.end()), 0.001f);
+			repaint();
+		}
+
+	private:
+
+		juce::Font getFont() const
+		{
+			return codeEditor.getFont().withHeight(codeEditor.getFont().getHeight() * 0.85f);
+		}
+
+		void compositionChanged() override
+		{
+			triggerAsyncUpdate();
+		}
+
+		void handleAsyncUpdate() override
+		{
+			repaint();
+		}
+
+		static constexpr juce::uint32 hotColour = 0xFFC0392B;
+
+		CodeTextEditor& codeEditor;
+		std::vector<float> profile;
+		float hottest = 1.0f;
+	};
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:RemarkComponent.h
+		
+		A transparent overlay that prints optimization remarks from the compiler
+		after the source lines they refer to
+
+*************************************************************************************/
+
+#ifndef REMARKCOMPONENT_H
+#define REMARKCOMPONENT_H
+
+#include <cpl/Common.h>
+#include <map>
+#include <vector>
+#include "CodeTextEditor.h"
+#include "SourceManager.h"
+
+namespace ape
+{
+
+	class RemarkComponent
+		: public juce::Component
+	{
+	public:
+
+		RemarkComponent(CodeTextEditor& codeEditorView)
+			: codeEditor(codeEditorView)
+		{
+			// purely informative, the editor below handles all input
+			setInterceptsMouseClicks(false, false);
+		}
+
+		void paint(juce::Graphics& g) override
+		{
+			if (remarks.empty())
+				return;
+
+			auto& document = codeEditor.getDocument();
+			auto const start = codeEditor.getFirstLineOnScreen();
+			auto const end = start + codeEditor.getNumLinesOnScreen() + 1;
+
+			g.setFont(codeEditor.getFont().withHeight(codeEditor.getFont().getHeight() * 0.85f));
+
+			for (auto it = remarks.lower_bound(start); it != remarks.end() && it->first < end; ++it)
+			{
+				if (it->first >= document.getNumLines())
+					break;
+
+				juce::CodeDocument::Position endOfLine(document, it->first, document.getLine(it->first).trimEnd().length());
+				auto const bounds = codeEditor.getCharacterBounds(endOfLine);
+
+				juce::String text;
+				juce::uint32 colour = passedColour;
+
+				for (auto& remark : it->second)
+				{
+					if (text.isNotEmpty())
+						text += "; ";
+
+					text += remark.message;
+
+					// the most severe remark on the line decides the colour
+					if (remark.kind == OptimizationRemark::Missed)
+						colour = missedColour;
+					else if (remark.kind == OptimizationRemark::Analysis && colour == passedColour)
+						colour = analysisColour;
+				}
+
+				auto const left = bounds.getRight() + codeEditor.getLineHeight() * 2;
+
+				if (left >= getWidth())
+					continue;
+
+				g.setColour(juce::Colour(colour));
+				g.drawText("// " + text, left, bounds.getY(), getWidth() - left, bounds.getHeight(), juce::Justification::centredLeft, true);
+			}
+		}
+
+		/// <summary>
+		/// Replaces the remarks, keyed by zero-based source line.
+		/// </summary>
+		void setRemarks(std::map<int, std::vector<OptimizationRemark>> newRemarks)
+		{
+			remarks = std::move(newRemarks);
+			repaint();
+		}
+
+	private:
+
+		static constexpr juce::uint32 passedColour = 0xFF6A9955, missedColour = 0xFFD7A35A, analysisColour = 0xFF8A8A8A;
+
+		CodeTextEditor& codeEditor;
+		std::map<int, std::vector<OptimizationRemark>> remarks;
+	};
+}
+
+#endif
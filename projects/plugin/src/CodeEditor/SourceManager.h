@@ -39,6 +39,7 @@
 
 	#include <string>
 	#include <memory>
+	#include <vector>
 	#include <cpl/Common.h>
 	#include <cpl/state/Serialization.h>
 	#include <cpl/Core.h>
@@ -74,6 +75,11 @@
 			BuildActivate,
 			BuildDeactivate,
 			BuildClean,
+			BuildExport,
+			BuildRunGraph,
+			BuildShowRemarks,
+			BuildProfileLines,
+			BuildProfileScopes,
 			BuildEnd,
 			
 			End = BuildEnd
@@ -112,6 +118,26 @@
 
 		};
 
+		/// <summary>
+		/// A note from the compiler on what the optimizer did (or didn't, and why) with a line of source.
+		/// </summary>
+		struct OptimizationRemark
+		{
+			enum Kind
+			{
+				Passed,
+				Missed,
+				Analysis
+			};
+
+			Kind kind;
+			/// <summary>
+			/// Zero-based
+			/// </summary>
+			int line;
+			std::string message;
+		};
+
 		struct ProjectEx;
 		class UIController;
 		class Settings;
@@ -140,6 +166,25 @@
 			virtual void autoSave() {};
 			// true: a project was restored, false: nothing happened
 			virtual bool checkAutoSave() { return false; }
+			/// <summary>
+			/// Whether the compiler should be asked for optimization remarks to show with the source.
+			/// </summary>
+			virtual bool showsOptimizationRemarks() { return false; }
+			virtual void clearOptimizationRemarks() {}
+			virtual void addOptimizationRemark(const OptimizationRemark& remark) {}
+			/// <summary>
+			/// Whether the compiler should be asked to instrument the source, for profiling the time spent on every line.
+			/// </summary>
+			virtual bool profilesLines() { return false; }
+			/// <summary>
+			/// Whether the compiler should record the APE_PROFILE_SCOPE()s of the source, for the timeline.
+			/// </summary>
+			virtual bool profilesScopes() { return false; }
+			/// <summary>
+			/// Replaces the share of the processing time spent on every (zero-based) line of the source, from 0 to 1.
+			/// Empty if there's no profile of the current source.
+			/// </summary>
+			virtual void setLineProfile(std::vector<float> profile) {}
 
 		protected:
 			UIController& controller;
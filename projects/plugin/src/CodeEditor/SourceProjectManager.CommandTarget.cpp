@@ -61,6 +61,11 @@ namespace ape
 		{ "Activate",			juce::KeyPress::F3Key,	0, SourceManagerCommand::BuildActivate },
 		{ "Deactivate",			juce::KeyPress::F4Key,	0, SourceManagerCommand::BuildDeactivate },
 		{ "Clean",				juce::KeyPress::F8Key,	0,	SourceManagerCommand::BuildClean },
+		{ "Export native...",	0,						0,	SourceManagerCommand::BuildExport },
+		{ "Run graph or module...", 0,					0,	SourceManagerCommand::BuildRunGraph },
+		{ "Show optimization remarks", 0,				0,	SourceManagerCommand::BuildShowRemarks },
+		{ "Profile lines",		0,						0,	SourceManagerCommand::BuildProfileLines },
+		{ "Profile scopes",		0,						0,	SourceManagerCommand::BuildProfileScopes },
 	};
 
 
@@ -77,6 +82,14 @@ namespace ape
 		aci.shortName = cDesc.name;
 		aci.flags = 0;
 		aci.setActive(true);
+
+		if (commandID == SourceManagerCommand::BuildShowRemarks)
+			aci.setTicked(showRemarks);
+		else if (commandID == SourceManagerCommand::BuildProfileLines)
+			aci.setTicked(profileLines);
+		else if (commandID == SourceManagerCommand::BuildProfileScopes)
+			aci.setTicked(profileScopes);
+
 		result = aci;
 	}
 
@@ -161,6 +174,45 @@ namespace ape
 		case SourceManagerCommand::BuildClean:
 			controller.performCommand(UICommand::Clean);
 			break;
+
+		case SourceManagerCommand::BuildExport:
+			exportNative();
+			break;
+
+		case SourceManagerCommand::BuildRunGraph:
+			openGraph();
+			break;
+
+		case SourceManagerCommand::BuildShowRemarks:
+			showRemarks = !showRemarks;
+
+			if (showRemarks)
+				controller.getConsole().printLine("[Editor] : Optimization remarks are shown after the next optimized compilation.");
+			else
+				clearOptimizationRemarks();
+
+			appCM.commandStatusChanged();
+			break;
+
+		case SourceManagerCommand::BuildProfileLines:
+			profileLines = !profileLines;
+
+			if (profileLines)
+				controller.getConsole().printLine("[Editor] : Lines are profiled while processing, from the next compilation.");
+			else
+				setLineProfile({});
+
+			appCM.commandStatusChanged();
+			break;
+
+		case SourceManagerCommand::BuildProfileScopes:
+			profileScopes = !profileScopes;
+
+			if (profileScopes)
+				controller.getConsole().printLine("[Editor] : Scopes are shown in the timeline while processing, from the next compilation.");
+
+			appCM.commandStatusChanged();
+			break;
 		}
 		return true;
 	}
@@ -197,6 +249,21 @@ namespace ape
 			if (root.lookupValue("hkey_clean", temp))
 				userHotKeys[SourceManagerCommand::BuildClean] = temp;
 
+			if (root.lookupValue("hkey_export", temp))
+				userHotKeys[SourceManagerCommand::BuildExport] = temp;
+
+			if (root.lookupValue("hkey_run_graph", temp))
+				userHotKeys[SourceManagerCommand::BuildRunGraph] = temp;
+
+			if (root.lookupValue("hkey_remarks", temp))
+				userHotKeys[SourceManagerCommand::BuildShowRemarks] = temp;
+
+			if (root.lookupValue("hkey_profile", temp))
+				userHotKeys[SourceManagerCommand::BuildProfileLines] = temp;
+
+			if (root.lookupValue("hkey_profile_scopes", temp))
+				userHotKeys[SourceManagerCommand::BuildProfileScopes] = temp;
+
 			if (root.lookupValue("hkey_externaledit", temp))
 				userHotKeys[SourceManagerCommand::EditExternally] = temp;
 		}
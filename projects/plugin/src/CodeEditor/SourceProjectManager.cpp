@@ -54,6 +54,9 @@ namespace ape
 		: SourceManager(ui, s, instanceID)
 		, shouldCheckContentsAgainstDisk(true)
 		, enableScopePoints(false)
+		, showRemarks(false)
+		, profileLines(false)
+		, profileScopes(false)
 		, lastDirtyState(false)
 		, textEditorDSO([this] { return createWindow(); })
 		, sourceFile("untitled")
@@ -200,6 +203,8 @@ namespace ape
 		auto textEditor = std::make_unique<CodeEditorComponent>(settings, doc, *this);
 		textEditor->getLineTracer().setBreakpoints(breakpoints);
 		textEditor->getLineTracer().addBreakpointListener(this);
+		textEditor->getRemarks().setRemarks(remarks);
+		textEditor->setLineProfile(lineProfile);
 
 		if (shouldCheckContentsAgainstDisk && sourceFile.isActualFile())
 		{
@@ -460,6 +465,42 @@ namespace ape
 		return false;
 	}
 
+	void SourceProjectManager::exportNative()
+	{
+	#if defined(CPL_WINDOWS)
+		const char* extension = ".dll";
+	#elif defined(CPL_MAC)
+		const char* extension = ".dylib";
+	#else
+		const char* extension = ".so";
+	#endif
+
+		auto suggestedPath = sourceFile.isActualFile() ? sourceFile.getPath() : homeDirectory / sourceFile.getPath();
+		suggestedPath.replace_extension(extension);
+
+		juce::FileChooser fileSelector(cpl::programInfo.programAbbr + " :: Select where to export your script...", juce::File(suggestedPath.string()), juce::String("*") + extension);
+
+		if (fileSelector.browseForFileToSave(true))
+		{
+			fs::path newPath = fileSelector.getResult().getFullPathName().toStdString();
+
+			if (!newPath.has_extension())
+				newPath.replace_extension(extension);
+
+			controller.exportProject(newPath.string());
+		}
+	}
+
+	void SourceProjectManager::openGraph()
+	{
+		juce::FileChooser fileSelector(cpl::programInfo.programAbbr + " - Select a graph of scripts or an exported module to run...", juce::File(homeDirectory.string()), "*.apegraph;*.so;*.dylib;*.dll");
+
+		if (fileSelector.browseForFileToOpen())
+		{
+			controller.loadGraph(fileSelector.getResult().getFullPathName().toStdString());
+		}
+	}
+
 	bool SourceProjectManager::doSaveFile(const fs::path& fileName)
 	{
 		using namespace cpl::Misc;
@@ -507,11 +548,74 @@ namespace ape
 	void SourceProjectManager::codeDocumentTextInserted(const juce::String & newText, int insertIndex)
 	{
 		checkDirtynessState();
+
+		// the remarks and the profile refer to lines that moved now
+		if (newText.containsAnyOf("\r\n"))
+		{
+			if (!remarks.empty())
+				clearOptimizationRemarks();
+
+			if (!lineProfile.empty())
+				setLineProfile({});
+		}
 	}
 
 	void SourceProjectManager::codeDocumentTextDeleted(int startIndex, int endIndex)
 	{
 		checkDirtynessState();
+
+		if (!remarks.empty() && doc->getNumLines() != remarkedLines)
+			clearOptimizationRemarks();
+
+		if (!lineProfile.empty() && doc->getNumLines() != static_cast<int>(lineProfile.size()))
+			setLineProfile({});
+	}
+
+	void SourceProjectManager::clearOptimizationRemarks()
+	{
+		remarks.clear();
+
+		if (textEditorDSO.hasCached())
+			textEditorDSO.getCached()->getRemarks().setRemarks(remarks);
+	}
+
+	void SourceProjectManager::addOptimizationRemark(const OptimizationRemark& remark)
+	{
+		if (!showRemarks)
+			return;
+
+		auto& line = remarks[remark.line];
+
+		// the same loop is often remarked on more than once, like for every inlined copy
+		for (auto& existing : line)
+		{
+			if (existing.kind == remark.kind && existing.message == remark.message)
+				return;
+		}
+
+		line.push_back(remark);
+		remarkedLines = doc->getNumLines();
+
+		if (textEditorDSO.hasCached())
+			textEditorDSO.getCached()->getRemarks().setRemarks(remarks);
+	}
+
+	void SourceProjectManager::setLineProfile(std::vector<float> profile)
+	{
+		if (!profileLines)
+			profile.clear();
+
+		// sized to the document, so deleted lines can be detected
+		if (!profile.empty())
+			profile.resize(doc->getNumLines());
+
+		if (profile == lineProfile)
+			return;
+
+		lineProfile = std::move(profile);
+
+		if (textEditorDSO.hasCached())
+			textEditorDSO.getCached()->setLineProfile(lineProfile);
 	}
 
 	void SourceProjectManager::setContents(const juce::String& newContent)
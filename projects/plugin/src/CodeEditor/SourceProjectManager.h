@@ -75,6 +75,12 @@
 			bool openFile(const fs::path& fileName) override;
 			bool isDirty() override;
 			const SourceFile& getSourceFile() override;
+			bool showsOptimizationRemarks() override { return showRemarks; }
+			void clearOptimizationRemarks() override;
+			void addOptimizationRemark(const OptimizationRemark& remark) override;
+			bool profilesLines() override { return profileLines; }
+			bool profilesScopes() override { return profileScopes; }
+			void setLineProfile(std::vector<float> profile) override;
             juce::ApplicationCommandManager& getCommandManager();
 			void serialize(cpl::CSerializer::Archiver & ar, cpl::Version version) override;
 			void deserialize(cpl::CSerializer::Builder & builder, cpl::Version version) override;
@@ -110,6 +116,8 @@
 			bool openTemplate();
 			void openHomeDirectory();
 			void editExternally();
+			void exportNative();
+			void openGraph();
 
 			//ApplicationCommandTarget overloads
 			ApplicationCommandTarget * getNextCommandTarget() override { return nullptr; }
@@ -123,11 +131,14 @@
 
 			std::shared_ptr<juce::CodeDocument> doc;
 			SourceFile sourceFile;
-			bool enableScopePoints, shouldCheckContentsAgainstDisk;
+			bool enableScopePoints, shouldCheckContentsAgainstDisk, showRemarks, profileLines, profileScopes;
 			std::optional<bool> lastDirtyState;
 
 			std::map<int, std::string> userHotKeys;
 			std::set<int> breakpoints;
+			std::map<int, std::vector<OptimizationRemark>> remarks;
+			int remarkedLines = 0;
+			std::vector<float> lineProfile;
 			std::set<CodeDocumentListener*> listeners;
 
 			std::vector<std::string> validFileTypes;
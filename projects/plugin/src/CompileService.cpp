@@ -0,0 +1,143 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:CompileService.cpp
+		
+		Implementation of CompileService.h
+
+*************************************************************************************/
+
+#include "CompileService.h"
+#include <algorithm>
+#include <iterator>
+
+namespace ape
+{
+	std::shared_ptr<CompileService> CompileService::acquire(int numWorkers)
+	{
+		static std::mutex mutex;
+		static std::weak_ptr<CompileService> shared;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (auto current = shared.lock())
+			return current;
+
+		// compiling is a background task competing with the audio threads of every instance, so it doesn't get every core by default
+		const auto workers = numWorkers < 0 ? std::clamp<std::size_t>(std::thread::hardware_concurrency() / 4, 1, 2) : static_cast<std::size_t>(std::max(1, numWorkers));
+		auto service = std::make_shared<CompileService>(workers);
+		shared = service;
+
+		return service;
+	}
+
+	CompileService::CompileService(std::size_t numWorkers)
+		: focus(nullptr)
+		, sequence(0)
+		, quit(false)
+	{
+		for (std::size_t i = 0; i < numWorkers; ++i)
+			workers.emplace_back(&CompileService::workerLoop, this);
+	}
+
+	CompileService::~CompileService()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+			// anyone still waiting gets a broken promise
+			queue.clear();
+		}
+
+		jobsAvailable.notify_all();
+
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	void CompileService::setFocus(const void* owner)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		focus = owner;
+	}
+
+	void CompileService::releaseFocus(const void* owner)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (focus == owner)
+			focus = nullptr;
+	}
+
+	void CompileService::cancel(const void* owner)
+	{
+		std::vector<Job> cancelled;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			auto it = std::stable_partition(queue.begin(), queue.end(), [owner](const Job& job) { return job.owner != owner; });
+			std::move(it, queue.end(), std::back_inserter(cancelled));
+			queue.erase(it, queue.end());
+		}
+
+		// promises are broken outside the lock, in case anyone continues on them
+	}
+
+	void CompileService::enqueue(const void* owner, Priority priority, std::function<void()> work)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back({ owner, priority, sequence++, std::move(work) });
+		}
+
+		jobsAvailable.notify_one();
+	}
+
+	void CompileService::workerLoop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true)
+		{
+			jobsAvailable.wait(lock, [this] { return quit || !queue.empty(); });
+
+			if (quit)
+				return;
+
+			// the queue is short, so it's simply searched for the most urgent job every time.
+			// this way, focus changes also reorder jobs that are already queued.
+			auto urgency = [this](const Job& job) { return std::make_tuple(job.owner == focus, job.priority, ~job.sequence); };
+
+			auto next = std::max_element(queue.begin(), queue.end(), [&](const Job& left, const Job& right) { return urgency(left) < urgency(right); });
+			auto work = std::move(next->work);
+			queue.erase(next);
+
+			lock.unlock();
+			work();
+			// the task is released before taking the lock again
+			work = nullptr;
+			lock.lock();
+		}
+	}
+}
@@ -0,0 +1,129 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:CompileService.h
+		
+		Bounded pool of threads compiling scripts, shared by every instance in the process.
+		Queued compilations of the focused instance run first, then by priority, then in
+		order of submission.
+
+*************************************************************************************/
+
+#ifndef APE_COMPILESERVICE_H
+	#define APE_COMPILESERVICE_H
+
+	#include <condition_variable>
+	#include <cstddef>
+	#include <cstdint>
+	#include <functional>
+	#include <future>
+	#include <memory>
+	#include <mutex>
+	#include <thread>
+	#include <tuple>
+	#include <type_traits>
+	#include <vector>
+
+	namespace ape
+	{
+		class CompileService
+		{
+		public:
+
+			enum class Priority
+			{
+				/// <summary>
+				/// Work nobody is waiting for, like optimized rebuilds.
+				/// </summary>
+				Background,
+				Normal
+			};
+
+			/// <summary>
+			/// Returns the process-wide service, starting it if no instance holds it.
+			/// <paramref name="numWorkers"/> is only used when starting it, and a negative count
+			/// selects a quarter of the cores, but at least one and at most two threads.
+			/// Threads are joined when the last reference is released.
+			/// </summary>
+			static std::shared_ptr<CompileService> acquire(int numWorkers = -1);
+
+			CompileService(std::size_t numWorkers);
+			~CompileService();
+
+			CompileService(const CompileService&) = delete;
+			CompileService& operator = (const CompileService&) = delete;
+
+			/// <summary>
+			/// Queues <paramref name="work"/> on behalf of <paramref name="owner"/>. Exceptions are forwarded through the future.
+			/// If the job is cancelled before it runs, the future throws std::future_error (broken promise).
+			/// Unlike std::async, the future doesn't block on destruction: the owner must cancel or wait for its jobs before dying.
+			/// </summary>
+			template<typename Function>
+			std::future<std::invoke_result_t<Function>> submit(const void* owner, Priority priority, Function&& work)
+			{
+				auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(std::forward<Function>(work));
+				auto future = task->get_future();
+				enqueue(owner, priority, [task] { (*task)(); });
+				return future;
+			}
+
+			/// <summary>
+			/// Lets every queued job of <paramref name="owner"/> jump the queue, until another owner gets the focus.
+			/// </summary>
+			void setFocus(const void* owner);
+
+			/// <summary>
+			/// Removes the focus, if <paramref name="owner"/> has it.
+			/// </summary>
+			void releaseFocus(const void* owner);
+
+			/// <summary>
+			/// Discards every job of <paramref name="owner"/> that hasn't started yet.
+			/// </summary>
+			void cancel(const void* owner);
+
+			std::size_t getNumWorkers() const noexcept { return workers.size(); }
+
+		private:
+
+			struct Job
+			{
+				const void* owner;
+				Priority priority;
+				std::uint64_t sequence;
+				std::function<void()> work;
+			};
+
+			void enqueue(const void* owner, Priority priority, std::function<void()> work);
+			void workerLoop();
+
+			std::vector<std::thread> workers;
+			std::vector<Job> queue;
+			std::mutex mutex;
+			std::condition_variable jobsAvailable;
+			const void* focus;
+			std::uint64_t sequence;
+			bool quit;
+		};
+	}
+#endif
@@ -29,6 +29,8 @@
 #include "CompilerBinding.h"
 #include <sstream>
 #include <cpl/Misc.h>
+#include <random>
+#include <system_error>
 
 namespace ape
 {
@@ -61,18 +63,18 @@ namespace ape
 		If key and value is not found, it will default to the same value in
 		g_sExports.
 	*/
-	void CompilerBinding::Bindings::loadBindings(cpl::CModule& module, const libconfig::Setting & exportSettings)
+	void CompilerBinding::Bindings::loadBindings(cpl::CModule& module, const libconfig::Setting * exportSettings)
 	{
-		bool settingsIsValid = exportSettings.isGroup() && !strcmp(exportSettings.getName(), "exports");
+		bool settingsIsValid = exportSettings && exportSettings->isGroup() && !strcmp(exportSettings->getName(), "exports");
 		
 		cpl::foreach_uenum<ExportIndex>(
 			[&](auto i)
 			{
 				const char * name = nullptr;
 				// see if we can get a valid name out of our settings
-				if (settingsIsValid && exportSettings.exists(g_sExports[i]))
+				if (settingsIsValid && exportSettings->exists(g_sExports[i]))
 				{
-					name = exportSettings[g_sExports[i]].c_str();
+					name = (*exportSettings)[g_sExports[i]].c_str();
 				}
                 
 				// shortcircuiting avoids null-dereferencing
@@ -135,7 +137,7 @@ namespace ape
                     throw std::runtime_error(std::move(fmt));
                 }
                 
-                bindings.loadBindings(module, languageSettings["exports"]);
+                bindings.loadBindings(module, &languageSettings["exports"]);
 
                 return;
             }
@@ -151,4 +153,59 @@ namespace ape
         throw std::runtime_error(std::move(fmt));
 	}
 
+	CompilerBinding::CompilerBinding(const cpl::fs::path& prebuiltModule, int instanceID)
+	{
+		language = "native";
+		compilerPath = prebuiltModule.string();
+		compilerName = prebuiltModule.stem().string();
+
+		const auto directory = cpl::fs::temp_directory_path() / "ape-native";
+		cpl::fs::create_directories(directory);
+
+		// a new name for every load: a module exported again under the same name is loaded while the old copy
+		// is still mapped, and other processes use the same directory.
+		std::random_device random;
+
+		for (int attempts = 0; privateCopy.path.empty(); ++attempts)
+		{
+			const auto copy = directory / cpl::format("%s-%d-%08x%s", compilerName.c_str(), instanceID, random(), prebuiltModule.extension().string().c_str());
+			std::error_code ec, existsError;
+
+			if (cpl::fs::copy_file(prebuiltModule, copy, cpl::fs::copy_options::none, ec))
+				privateCopy.path = copy;
+			else if (!cpl::fs::exists(copy, existsError) || attempts == 8)
+				throw std::runtime_error(cpl::format("Error copying native module \'%s\' to \'%s\': %s", compilerPath.c_str(), copy.string().c_str(), ec.message().c_str()));
+		}
+
+		std::string errorMsg;
+
+		if (auto error = module.load(privateCopy.path.string(), errorMsg))
+		{
+			throw std::runtime_error(
+				cpl::format("Error loading native module \'%s\'. OS returns %d. System message:\n%s", compilerPath.c_str(), (int)error, errorMsg.c_str())
+			);
+		}
+
+		bindings.loadBindings(module, nullptr);
+	}
+
+	bool CompilerBinding::isPrebuiltModule(const std::string& extension)
+	{
+		for (auto native : { "dll", "so", "dylib" })
+		{
+			if (extension == native)
+				return true;
+		}
+
+		return false;
+	}
+
+	CompilerBinding::TemporaryFile::~TemporaryFile()
+	{
+		std::error_code ec;
+
+		if (!path.empty())
+			cpl::fs::remove(path, ec);
+	}
+
 };
@@ -31,6 +31,7 @@
 	#define APE_COMPILERBINDING_H
 
 	#include <cpl/CModule.h>
+	#include <cpl/filesystem.h>
 	#include <cpl/MacroConstants.h>
 	#include <cpl/Core.h>
 	#include <string>
@@ -75,6 +76,18 @@
 			bool compileProject(ProjectEx * project);
 			CompilerBinding(const libconfig::Setting& languageSettings);
 
+			/// <summary>
+			/// Loads a project exported ahead of time as a native module, which acts as its own compiler.
+			/// Scripts keep their state in globals, so a private copy of the module is loaded for every
+			/// <paramref name="instanceID"/>, like the JIT gives every instance its own.
+			/// </summary>
+			CompilerBinding(const cpl::fs::path& prebuiltModule, int instanceID);
+
+			/// <summary>
+			/// Whether a file with this extension is a native module, see the constructor above.
+			/// </summary>
+			static bool isPrebuiltModule(const std::string& extension);
+
 		private:
 
 			struct Bindings
@@ -95,9 +108,17 @@
 					void * _table[MaxExports()];
 				};
 
-				void loadBindings(cpl::CModule & module, const libconfig::Setting & exportSettings);
+				void loadBindings(cpl::CModule & module, const libconfig::Setting * exportSettings);
+			};
+
+			struct TemporaryFile
+			{
+				cpl::fs::path path;
+				~TemporaryFile();
 			};
 
+			// declared before the module, so it's unloaded before the file is deleted
+			TemporaryFile privateCopy;
 			cpl::CModule module;
 			Bindings bindings;
 			std::vector<std::string> extensions;
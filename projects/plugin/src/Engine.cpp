@@ -41,6 +41,8 @@
 #include "UI/UICommands.h"
 #include <cpl/system/SysStats.h>
 #include "version.h"
+#include <algorithm>
+#include <chrono>
 
 namespace cpl
 {
@@ -70,6 +72,9 @@ namespace ape
 		, outgoing(0xF, 0xF)
 		, currentPlugin(nullptr)
 		, currentTracer(nullptr)
+		, currentGraph(nullptr)
+		, publishedPool(nullptr)
+		, poolRequested(false)
 	{
 		instanceID = cpl::Misc::AcquireUniqueInstanceID();
 
@@ -97,6 +102,7 @@ namespace ape
 		cpl::Misc::ReleaseUniqueInstanceID(instanceID);
 		// these need to be deleted before other members in the engine
 		controller = nullptr;
+		graphs.clear();
 		pluginStates.clear();
 	}
 
@@ -125,6 +131,10 @@ namespace ape
 	{
 		useFPE = settings.lookUpValue(false, "application", "use_fpe");
 		preserveParameters = settings.lookUpValue(true, "application", "preserve_parameters");
+		zeroCopyBuffers = settings.lookUpValue(true, "application", "zero_copy_buffers");
+		workerThreads = settings.lookUpValue(-1, "application", "worker_threads");
+		scratchCapacity = static_cast<std::size_t>(std::max(1, settings.lookUpValue(64, "application", "scratch_size"))) * 1024;
+		latency.setThreshold(settings.lookUpValue(80, "application", "deadline_threshold") / 100.0);
 	}
 
 	std::int32_t Engine::uniqueInstanceID() const noexcept
@@ -177,6 +187,109 @@ namespace ape
 		incoming.pushElement<true, true>(EngineCommand::TransferPlugin::Create(plugin, options));
 	}
 
+	namespace
+	{
+		class ScriptNode : public ProcessingGraph::Processor
+		{
+		public:
+
+			ScriptNode(Engine& engine, std::shared_ptr<PluginState> plugin, bool useFPE)
+				: engine(engine), plugin(std::move(plugin)), useFPE(useFPE)
+			{
+
+			}
+
+			void prepare(std::size_t, std::size_t, std::size_t) override
+			{
+				if (!engine.getPlayState())
+					return;
+
+				// same as for a single plugin, see Engine::exchangePlugin()
+				if (plugin->getConfig() != engine.getConfig())
+				{
+					if (plugin->getPlayState())
+						plugin->setPlayState(false);
+
+					plugin->setConfig(engine.getConfig());
+				}
+
+				if (!plugin->getPlayState())
+					plugin->setPlayState(true);
+			}
+
+			void release() override
+			{
+				plugin->setPlayState(false);
+			}
+
+			bool process(const float* const* inputs, std::size_t numSamples) override
+			{
+				// floating point exception state is per thread
+				if (useFPE)
+					PluginState::useFPUExceptions(true);
+
+				auto ret = plugin->processReplacing(inputs, nullptr, numSamples);
+
+				if (useFPE)
+					PluginState::useFPUExceptions(false);
+
+				return ret;
+			}
+
+			const float* const* outputs() const noexcept override
+			{
+				return plugin->getOutputBuffers();
+			}
+
+		private:
+			Engine& engine;
+			std::shared_ptr<PluginState> plugin;
+			bool useFPE;
+		};
+	}
+
+	std::shared_ptr<ProcessingGraph::Processor> Engine::createGraphNode(std::shared_ptr<PluginState> plugin)
+	{
+		return std::make_shared<ScriptNode>(*this, std::move(plugin), useFPE);
+	}
+
+	void Engine::exchangeGraph(std::shared_ptr<ProcessingGraph> newGraph)
+	{
+		auto graph = newGraph.get();
+
+		if (graph)
+		{
+			graph->prepare(ioConfig.inputs, ioConfig.outputs, ioConfig.blockSize);
+			// create the workers before the audio thread can see the graph
+			getWorkerPool();
+			graphs.emplace_back(std::move(newGraph));
+		}
+
+		incoming.pushElement<true, true>(EngineCommand::TransferGraph::Create(graph));
+	}
+
+	RealtimePool& Engine::getWorkerPool()
+	{
+		if (!workerPool)
+		{
+			workerPool = RealtimePool::acquire(workerThreads);
+			publishedPool.store(workerPool.get(), std::memory_order_release);
+			controller->getConsole().printLine("[Engine] : Using %d shared real-time worker threads.", static_cast<int>(workerPool->getNumWorkers()));
+		}
+
+		return *workerPool;
+	}
+
+	RealtimePool* Engine::getRealtimePool() noexcept
+	{
+		auto pool = publishedPool.load(std::memory_order_acquire);
+
+		if (!pool)
+			poolRequested.store(true, std::memory_order_relaxed);
+
+		return pool;
+	}
+
 	void Engine::changeInitialDelay(long samples) noexcept
 	{
 		delay.newDelay = samples;
@@ -202,11 +315,36 @@ namespace ape
 					}
 				}
 
+				break;
+
+			case EngineCommand::Type::Graph:
+
+				if ((command.graph.reason & PluginExchangeReason::Crash) == PluginExchangeReason::Crash)
+				{
+					controller->getConsole().printLine(CConsole::Error, "[Engine] : A script in the processing graph failed, graph removed.");
+
+					// so it isn't restored with the session, unless it was replaced meanwhile
+					if (!graphs.empty() && graphs.back().get() == command.graph.graph)
+						controller->clearGraph();
+				}
+
+				for (std::size_t i = 0; i < graphs.size(); ++i)
+				{
+					if (graphs[i].get() == command.graph.graph)
+					{
+						graphs[i]->release();
+						graphs.erase(graphs.begin() + i);
+						break;
+					}
+				}
+
+				break;
+
 			}
 		}
 	}
 
-	bool Engine::processPlugin(PluginState& plugin, TracerState& tracer, const std::size_t numSamples, const float * const * inputs, std::size_t* numTraces)
+	bool Engine::processPlugin(PluginState& plugin, TracerState& tracer, const std::size_t numSamples, const float * const * inputs, std::size_t* numTraces, float * const ** outputs)
 	{
 		const auto pole = 1 - std::exp(-1.0 / (2 * getSampleRate() / numSamples));
 		std::size_t profiledClocks = 0;
@@ -216,7 +354,19 @@ namespace ape
 
 		tracer.beginPhase(&auxMatrix, ioConfig.inputs + ioConfig.outputs);
 
-		auto ret = plugin.processReplacing(inputs, tempBuffer.data(), numSamples, &profiledClocks);
+		bool ret;
+
+		if (zeroCopyBuffers)
+		{
+			// results stay in the plugin's own aligned buffers, and are read from there directly
+			ret = plugin.processReplacing(inputs, nullptr, numSamples, &profiledClocks);
+			*outputs = plugin.getOutputBuffers();
+		}
+		else
+		{
+			ret = plugin.processReplacing(inputs, tempBuffer.data(), numSamples, &profiledClocks);
+			*outputs = tempBuffer.data();
+		}
 
 		if (tracer.changesPending())
 			onInitialTracerChanges(tracer);
@@ -239,18 +389,38 @@ namespace ape
 
 	void Engine::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuffer& midiMessages)
 	{
+		const auto blockStart = std::chrono::steady_clock::now();
 		const std::size_t numSamples = buffer.getNumSamples();
 		std::size_t numTraces = 0;
 		auxMatrix.softBufferResize(numSamples);
 		tempBuffer.softBufferResize(numSamples);
 
-		auxMatrix.copy(buffer.getArrayOfReadPointers(), 0, ioConfig.inputs);
+		auto phaseStart = blockStart;
+		auto endPhase = [this, &phaseStart](std::uint64_t BlockPhaseTimings::* phase)
+		{
+			if (!phaseTimings)
+				return;
+
+			const auto now = std::chrono::steady_clock::now();
+			phaseTimings->*phase += std::chrono::duration_cast<std::chrono::nanoseconds>(now - phaseStart).count();
+			phaseStart = now;
+		};
+
+		// in zero copy mode, the scope reads inputs straight from the host buffer,
+		// which isn't overwritten until the very end.
+		if (!zeroCopyBuffers)
+			auxMatrix.copy(buffer.getArrayOfReadPointers(), 0, ioConfig.inputs);
+
 		auxMatrix.clear(ioConfig.inputs, ioConfig.outputs);
+		endPhase(&BlockPhaseTimings::copies);
 
 		bool newPluginArrived = false;
 		bool hadOldPlugin = currentPlugin != nullptr;
         bool forceTakeEngineValues = false;
 
+		float * const * pluginOutputs = nullptr;
+		float * const * results = auxMatrix.data() + ioConfig.inputs;
+
 		EngineCommand command;
 
 		while (incoming.popElement(command))
@@ -263,10 +433,10 @@ namespace ape
 
 				if (currentPlugin)
 				{
-					if (!processPlugin(*currentPlugin, *currentTracer, numSamples, buffer.getArrayOfReadPointers(), &numTraces))
+					if (!processPlugin(*currentPlugin, *currentTracer, numSamples, buffer.getArrayOfReadPointers(), &numTraces, &pluginOutputs))
 						reason = reason | PluginExchangeReason::Crash;
 
-					auxMatrix.accumulate(tempBuffer.data(), ioConfig.inputs, ioConfig.outputs, 1.0f, 0.0f);
+					auxMatrix.accumulate(pluginOutputs, ioConfig.inputs, ioConfig.outputs, 1.0f, 0.0f);
 				}
 
 				outgoing.pushElement(EngineCommand::TransferPlugin::Return(currentPlugin, currentTracer, reason));
@@ -275,20 +445,48 @@ namespace ape
 				newPluginArrived = true;
 				currentTracer = command.transfer.tracer;
                 forceTakeEngineValues = command.transfer.options & EngineCommand::AlwaysTakeEngineValue;
+				break;
+			}
+
+			case EngineCommand::Type::Graph:
+			{
+				if (currentGraph)
+					outgoing.pushElement(EngineCommand::TransferGraph::Create(currentGraph));
+
+				currentGraph = command.graph.graph;
+				break;
 			}
 			}
 		}
 
-		if (currentPlugin)
+		if (currentPlugin && newPluginArrived)
+		{
+			// hot reloading, copy over parameters
+			// TODO: Only do this if hash of old and new parameters match up
+			currentPlugin->syncParametersToEngine(forceTakeEngineValues || (hadOldPlugin && preserveParameters));
+		}
+
+		endPhase(&BlockPhaseTimings::commands);
+
+		if (currentGraph)
 		{
-			if (newPluginArrived)
+			// the graph takes the place of the current plugin
+			const bool processed = currentGraph->process(*workerPool, buffer.getArrayOfReadPointers(), auxMatrix.data() + ioConfig.inputs, numSamples);
+			endPhase(&BlockPhaseTimings::plugin);
+
+			if (!processed)
 			{
-				// hot reloading, copy over parameters
-				// TODO: Only do this if hash of old and new parameters match up
-                currentPlugin->syncParametersToEngine(forceTakeEngineValues || (hadOldPlugin && preserveParameters));
+				outgoing.pushElement(EngineCommand::TransferGraph::Create(currentGraph, PluginExchangeReason::Crash));
+				currentGraph = nullptr;
+				auxMatrix.clear(ioConfig.inputs, ioConfig.outputs);
 			}
+		}
+		else if (currentPlugin)
+		{
+			const bool processed = processPlugin(*currentPlugin, *currentTracer, numSamples, buffer.getArrayOfReadPointers(), &numTraces, &pluginOutputs);
+			endPhase(&BlockPhaseTimings::plugin);
 
-			if (!processPlugin(*currentPlugin, *currentTracer, numSamples, buffer.getArrayOfReadPointers(), &numTraces))
+			if (!processed)
 			{
 				outgoing.pushElement(EngineCommand::TransferPlugin::Return(currentPlugin, currentTracer, PluginExchangeReason::Crash));
 				currentPlugin = nullptr;
@@ -297,11 +495,15 @@ namespace ape
 			}
 			else if (newPluginArrived && fadePlugins)
 			{
-				auxMatrix.accumulate(tempBuffer.data(), ioConfig.inputs, ioConfig.outputs, 0.0f, 1.0f);
+				auxMatrix.accumulate(pluginOutputs, ioConfig.inputs, ioConfig.outputs, 0.0f, 1.0f);
+			}
+			else if (zeroCopyBuffers)
+			{
+				results = pluginOutputs;
 			}
 			else
 			{
-				auxMatrix.copy(tempBuffer.data(), ioConfig.inputs, ioConfig.outputs);
+				auxMatrix.copy(pluginOutputs, ioConfig.inputs, ioConfig.outputs);
 			}
 		}
 		else
@@ -310,11 +512,39 @@ namespace ape
 			auxMatrix.copy(buffer.getArrayOfReadPointers(), ioConfig.inputs, ioConfig.outputs);
 		}
 
-		scopeData.getStream().processIncomingRTAudio(auxMatrix.data(), ioConfig.inputs + ioConfig.outputs + numTraces, numSamples, *getPlayHead());
+		// nothing uses the workers for the rest of the block, so let them park instead of spinning
+		if (auto pool = publishedPool.load(std::memory_order_acquire))
+			pool->endBlock();
+
+		endPhase(&BlockPhaseTimings::copies);
+
+		// traces that didn't fit in the matrix weren't recorded
+		const auto numScopeChannels = std::min(ioConfig.inputs + ioConfig.outputs + numTraces, auxMatrix.size());
+
+		if (zeroCopyBuffers)
+		{
+			// alias the scope channels to wherever the data currently lives
+			for (std::size_t i = 0; i < numScopeChannels; ++i)
+				scopeChannels[i] = auxMatrix[i];
+
+			for (std::size_t i = 0; i < ioConfig.inputs; ++i)
+				scopeChannels[i] = buffer.getWritePointer(static_cast<int>(i));
+
+			for (std::size_t i = 0; i < ioConfig.outputs; ++i)
+				scopeChannels[ioConfig.inputs + i] = results[i];
+
+			scopeData.getStream().processIncomingRTAudio(scopeChannels.data(), numScopeChannels, numSamples, *getPlayHead());
+		}
+		else
+		{
+			scopeData.getStream().processIncomingRTAudio(auxMatrix.data(), numScopeChannels, numSamples, *getPlayHead());
+		}
+
+		endPhase(&BlockPhaseTimings::scope);
 
 		for (int i = 0; i < getNumOutputChannels(); ++i)
 		{
-			buffer.copyFrom(i, 0, auxMatrix[ioConfig.inputs + i], static_cast<int>(numSamples));
+			buffer.copyFrom(i, 0, results[i], static_cast<int>(numSamples));
 		}
 
 
@@ -326,11 +556,32 @@ namespace ape
 			buffer.clear(i, 0, buffer.getNumSamples());
 		}
 
+		endPhase(&BlockPhaseTimings::copies);
+
+		const std::chrono::duration<double> blockTime = std::chrono::steady_clock::now() - blockStart;
+
+		if (phaseTimings)
+		{
+			phaseTimings->blocks++;
+			phaseTimings->total += std::chrono::duration_cast<std::chrono::nanoseconds>(blockTime).count();
+		}
+
+		if (numSamples > 0 && getSampleRate() > 0)
+			latency.record(blockTime.count(), numSamples / getSampleRate());
 	}
 
 	void Engine::pulse()
 	{
 		processReturnQueue();
+
+		// scratch arenas that overflowed on the audio thread are regrown here
+		for (auto& state : pluginStates)
+			state->getScratchArena().grow();
+
+		// spawning threads isn't possible on the audio thread, so it's deferred to here
+		if (poolRequested.load(std::memory_order_relaxed) && !workerPool)
+			getWorkerPool();
+
 		params->pulse();
 		scopeData.getContent().parameterSet.pulseUI();
 	}
@@ -352,10 +603,11 @@ namespace ape
 		scopeData.initializeColours(ioConfig.inputs + ioConfig.outputs + state.getTraceCount());
 	}
 
-	void Engine::handleTraceCallback(const char** names, std::size_t nameCount, const float * values, std::size_t valueCount)
+	void Engine::handleTraceCallback(const PluginState& origin, const char** names, std::size_t nameCount, const float * values, std::size_t valueCount)
 	{
 		// TODO: Callback shouldn't be able to happen without an associated tracer
-		if (currentTracer)
+		// scripts in a graph may run concurrently on other threads, and aren't traced.
+		if (currentTracer && &origin == currentPlugin)
 			currentTracer->handleTrace(names, nameCount, values, valueCount);
 	}
 
@@ -530,6 +782,9 @@ namespace ape
 			pluginStates[i]->setPlayState(true);
 		}
 
+		for (auto& graph : graphs)
+			graph->prepare(ioConfig.inputs, ioConfig.outputs, ioConfig.blockSize);
+
 		auto info = scopeData.getStream().getInfo();
 		info.anticipatedChannels = ioConfig.inputs + ioConfig.outputs;
 		info.anticipatedSize = ioConfig.blockSize;
@@ -552,8 +807,10 @@ namespace ape
 			scopeData.getStream().enqueueChannelName(counter, "output " + std::to_string(i));
 		}
 
-		auxMatrix.resizeChannels(Signalizer::OscilloscopeContent::NumColourChannels);
+		// hosts may have more channels than the scope shows, which still pass through here
+		auxMatrix.resizeChannels(std::max<std::size_t>(Signalizer::OscilloscopeContent::NumColourChannels, ioConfig.inputs + ioConfig.outputs));
 		tempBuffer.resizeChannels(ioConfig.outputs);
+		scopeChannels.resize(auxMatrix.size());
 		
 		getOscilloscopeData().setTriggeringChannel(static_cast<int>(ioConfig.inputs + 1));
 
@@ -567,6 +824,9 @@ namespace ape
 		{
 			pluginStates[i]->setPlayState(isPlaying);
 		}
+
+		for (auto& graph : graphs)
+			graph->release();
 	}
 
 	}
@@ -41,6 +41,9 @@
 	#include <cpl/ConcurrentServices.h>
 	#include "CCodeGenerator.h"
 	#include "Engine/EngineStructures.h"
+	#include "Engine/ProcessingGraph.h"
+	#include "Engine/RealtimePool.h"
+	#include "Engine/LatencyHistogram.h"
 	#include <vector>
 	// TODO: remove
 	#include "SignalizerWindow.h"
@@ -75,6 +78,16 @@
 				double sampleRate;
 			};
 
+			/// <summary>
+			/// Nanoseconds spent in the phases of processBlock(), summed over <see cref="blocks"/> blocks.
+			/// Copies are the buffers moved in and out of the engine, commands the polling of the incoming queue
+			/// (including parameter synchronization of new plugins), and scope the feed of the oscilloscope.
+			/// </summary>
+			struct BlockPhaseTimings
+			{
+				std::uint64_t blocks, copies, commands, plugin, scope, total;
+			};
+
 			Engine();
 			virtual ~Engine();
 
@@ -85,6 +98,16 @@
 			const Settings& getSettings() const noexcept { return settings; }
 			ParameterManager& getParameterManager() noexcept { return *params; }
 			ProfilerData getProfilingData() const noexcept;
+			/// <summary>
+			/// Statistics of the time spent processing blocks against their deadlines, since the last reset.
+			/// </summary>
+			LatencyHistogram::Snapshot getLatencySnapshot() const noexcept { return latency.snapshot(); }
+			void resetLatencyStatistics() noexcept { latency.reset(); }
+			/// <summary>
+			/// Accumulates the time of every processed block into <paramref name="timings"/>, until detached with null.
+			/// Costs a clock read per phase while attached. Must not be called concurrently with processing.
+			/// </summary>
+			void setBlockPhaseTimings(BlockPhaseTimings* timings) noexcept { phaseTimings = timings; }
 			const IOConfig& getConfig() const noexcept { return ioConfig; }
 			bool getPlayState() const noexcept { return isPlaying; }
 			bool isProcessingAPlugin() const noexcept { return pluginStates.size() > 0; }
@@ -92,9 +115,29 @@
 			std::int32_t uniqueInstanceID() const noexcept;
 			std::int32_t instanceCounter() const noexcept;
 			void changeInitialDelay(long samples) noexcept;
-			void handleTraceCallback(const char** names, std::size_t nameCount, const float * values, std::size_t valueCount);
+			void handleTraceCallback(const PluginState& origin, const char** names, std::size_t nameCount, const float * values, std::size_t valueCount);
 			void pulse();
 
+			/// <summary>
+			/// Wraps an activated plugin, so it can be used as a node in a processing graph.
+			/// </summary>
+			std::shared_ptr<ProcessingGraph::Processor> createGraphNode(std::shared_ptr<PluginState> plugin);
+			/// <summary>
+			/// Installs a graph of scripts, processed instead of the current plugin until it's replaced,
+			/// or cleared with null. Independent branches run in parallel on the engine's worker pool.
+			/// Throws if the graph isn't valid.
+			/// </summary>
+			void exchangeGraph(std::shared_ptr<ProcessingGraph> graph);
+			/// <summary>
+			/// Returns the real-time worker pool, or null if it hasn't been started yet - in which case
+			/// it is started on the next pulse(). Safe to call from the audio thread.
+			/// </summary>
+			RealtimePool* getRealtimePool() noexcept;
+			/// <summary>
+			/// Bytes of scratch memory every script starts with, see ScratchArena.
+			/// </summary>
+			std::size_t getScratchCapacity() const noexcept { return scratchCapacity; }
+
 		protected:
 
 			void prepareToPlay(double sampleRate, int samplesPerBlock) override;
@@ -132,8 +175,9 @@
 
 		private:
 
-			bool processPlugin(PluginState& plugin, TracerState& state, std::size_t numSamples, const float* const* inputs, std::size_t* numTraces);
+			bool processPlugin(PluginState& plugin, TracerState& state, std::size_t numSamples, const float* const* inputs, std::size_t* numTraces, float* const** outputs);
 			void processReturnQueue();
+			RealtimePool& getWorkerPool();
 			void exchangePlugin(std::shared_ptr<PluginState> plugin, EngineCommand::TransientPluginOptions options = EngineCommand::None);
 
 			void onInitialTracerChanges(TracerState& state);
@@ -153,13 +197,15 @@
 				isPlaying = false, 
 				fadePlugins = true, 
 				useFPE = false, 
-				preserveParameters = true;
+				preserveParameters = true,
+				zeroCopyBuffers = true;
 
 
 			std::int32_t instanceID;
 			CCodeGenerator codeGenerator;
 			std::unique_ptr<UIController> controller;
 			std::vector<std::shared_ptr<PluginState>> pluginStates;
+			std::vector<std::shared_ptr<ProcessingGraph>> graphs;
 			std::unique_ptr<ParameterManager> params;
 
 			Settings settings;
@@ -168,12 +214,22 @@
 			AuxMatrix auxMatrix;
 
 			std::atomic<double> averageClocks, clocksPerSample;
+			LatencyHistogram latency;
+			BlockPhaseTimings* phaseTimings = nullptr;
 
 			// ----
 			PluginState* currentPlugin;
 			TracerState* currentTracer;
 			cpl::CLockFreeQueue<EngineCommand> incoming, outgoing;
 			AuxMatrix tempBuffer;
+			std::vector<float*> scopeChannels;
+			ProcessingGraph* currentGraph;
+			// shared by every instance, see RealtimePool::acquire()
+			std::shared_ptr<RealtimePool> workerPool;
+			std::atomic<RealtimePool*> publishedPool;
+			std::atomic<bool> poolRequested;
+			int workerThreads = -1;
+			std::size_t scratchCapacity = 1 << 16;
 		};
 	}
 #endif
@@ -0,0 +1,390 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:EngineStructures.cpp
+		
+		Scalar and SIMD kernels for AuxMatrix, and their runtime selection.
+
+*************************************************************************************/
+
+#include "EngineStructures.h"
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define APE_AUX_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#define APE_AUX_NEON
+	#include <arm_neon.h>
+#endif
+
+// the kernels must round every product and sum on their own (see below). compilers contract them into
+// fused multiply-adds by default when the target has them, even across statements.
+#if defined(__clang__)
+	#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+	#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+	#pragma fp_contract(off)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define APE_AUX_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define APE_AUX_TARGET(isa)
+#endif
+
+namespace ape
+{
+	namespace AuxKernels
+	{
+		// Every kernel must compute exactly the same operations per sample as the scalar one:
+		// products and sums are rounded separately (contraction into fused multiply-adds is
+		// disabled for this file), and tails fall back to the scalar formula.
+
+		namespace Scalar
+		{
+			// the C library's versions are already vectorised and dispatched, and measured faster
+			// than any straight load/store loop, so they're shared by every kernel set.
+			void copy(float* dst, const float* src, std::size_t length)
+			{
+				std::memcpy(dst, src, length * sizeof(float));
+			}
+
+			void clear(float* dst, std::size_t length)
+			{
+				std::memset(dst, 0, length * sizeof(float));
+			}
+
+			inline void accumulateSample(float* dst, const float* src, std::size_t n, float start, float step)
+			{
+				const float offset = static_cast<float>(n) * step;
+				const float gain = start + offset;
+				const float product = src[n] * gain;
+				dst[n] += product;
+			}
+
+			// indices are 32-bit, as that converts much faster from doubles
+			inline void resampleSample(float* dst, const float* src, std::int32_t last, std::size_t n, double ratio)
+			{
+				const double x = static_cast<double>(n) * ratio;
+				const auto i = std::min(static_cast<std::int32_t>(x), last);
+				const float fraction = static_cast<float>(x - static_cast<double>(i));
+				const float a = src[i], b = src[std::min(i + 1, last)];
+				const float slope = b - a;
+				const float offset = fraction * slope;
+				dst[n] = a + offset;
+			}
+
+			void accumulateRamp(float* dst, const float* src, std::size_t length, float start, float step)
+			{
+				for (std::size_t n = 0; n < length; ++n)
+					accumulateSample(dst, src, n, start, step);
+			}
+
+			void resample(float* dst, std::size_t length, const float* src, std::size_t sourceLength, double ratio)
+			{
+				const auto last = static_cast<std::int32_t>(sourceLength - 1);
+
+				for (std::size_t n = 0; n < length; ++n)
+					resampleSample(dst, src, last, n, ratio);
+			}
+		}
+
+#ifdef APE_AUX_X86
+		namespace SSE2
+		{
+			APE_AUX_TARGET("sse2") void accumulateRamp(float* dst, const float* src, std::size_t length, float start, float step)
+			{
+				const auto vstart = _mm_set1_ps(start), vstep = _mm_set1_ps(step), four = _mm_set1_ps(4);
+				auto index = _mm_setr_ps(0, 1, 2, 3);
+				std::size_t n = 0;
+
+				for (; n + 4 <= length; n += 4)
+				{
+					const auto gain = _mm_add_ps(vstart, _mm_mul_ps(index, vstep));
+					_mm_storeu_ps(dst + n, _mm_add_ps(_mm_loadu_ps(dst + n), _mm_mul_ps(_mm_loadu_ps(src + n), gain)));
+					index = _mm_add_ps(index, four);
+				}
+
+				for (; n < length; ++n)
+					Scalar::accumulateSample(dst, src, n, start, step);
+			}
+
+			APE_AUX_TARGET("sse2") inline __m128i min32(__m128i a, __m128i b)
+			{
+				const auto greater = _mm_cmpgt_epi32(a, b);
+				return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+			}
+
+			APE_AUX_TARGET("sse2") void resample(float* dst, std::size_t length, const float* src, std::size_t sourceLength, double ratio)
+			{
+				const auto last = static_cast<std::int32_t>(sourceLength - 1);
+				const auto vratio = _mm_set1_pd(ratio), four = _mm_set1_pd(4);
+				const auto vlast = _mm_set1_epi32(last), one = _mm_set1_epi32(1);
+				auto low = _mm_setr_pd(0, 1), high = _mm_setr_pd(2, 3);
+				std::size_t n = 0;
+
+				for (; n + 4 <= length; n += 4)
+				{
+					const auto xlow = _mm_mul_pd(low, vratio), xhigh = _mm_mul_pd(high, vratio);
+					const auto ilow = _mm_cvttpd_epi32(xlow), ihigh = _mm_cvttpd_epi32(xhigh);
+					const auto i = min32(_mm_unpacklo_epi64(ilow, ihigh), vlast);
+
+					const auto flow = _mm_cvtpd_ps(_mm_sub_pd(xlow, _mm_cvtepi32_pd(i)));
+					const auto fhigh = _mm_cvtpd_ps(_mm_sub_pd(xhigh, _mm_cvtepi32_pd(_mm_unpackhi_epi64(i, i))));
+					const auto fraction = _mm_movelh_ps(flow, fhigh);
+
+					// SSE2 has no gathers, so the lookups are done one by one
+					alignas(16) std::int32_t ia[4], ib[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(ia), i);
+					_mm_store_si128(reinterpret_cast<__m128i*>(ib), min32(_mm_add_epi32(i, one), vlast));
+
+					const auto a = _mm_setr_ps(src[ia[0]], src[ia[1]], src[ia[2]], src[ia[3]]);
+					const auto b = _mm_setr_ps(src[ib[0]], src[ib[1]], src[ib[2]], src[ib[3]]);
+
+					_mm_storeu_ps(dst + n, _mm_add_ps(a, _mm_mul_ps(fraction, _mm_sub_ps(b, a))));
+
+					low = _mm_add_pd(low, four);
+					high = _mm_add_pd(high, four);
+				}
+
+				for (; n < length; ++n)
+					Scalar::resampleSample(dst, src, last, n, ratio);
+			}
+		}
+
+		namespace AVX2
+		{
+			APE_AUX_TARGET("avx2") void accumulateRamp(float* dst, const float* src, std::size_t length, float start, float step)
+			{
+				const auto vstart = _mm256_set1_ps(start), vstep = _mm256_set1_ps(step), eight = _mm256_set1_ps(8);
+				auto index = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+				std::size_t n = 0;
+
+				for (; n + 8 <= length; n += 8)
+				{
+					const auto gain = _mm256_add_ps(vstart, _mm256_mul_ps(index, vstep));
+					_mm256_storeu_ps(dst + n, _mm256_add_ps(_mm256_loadu_ps(dst + n), _mm256_mul_ps(_mm256_loadu_ps(src + n), gain)));
+					index = _mm256_add_ps(index, eight);
+				}
+
+				for (; n < length; ++n)
+					Scalar::accumulateSample(dst, src, n, start, step);
+			}
+
+			APE_AUX_TARGET("avx2") void resample(float* dst, std::size_t length, const float* src, std::size_t sourceLength, double ratio)
+			{
+				const auto last = static_cast<std::int32_t>(sourceLength - 1);
+				const auto vratio = _mm256_set1_pd(ratio), four = _mm256_set1_pd(4);
+				const auto vlast = _mm_set1_epi32(last), one = _mm_set1_epi32(1);
+				auto index = _mm256_setr_pd(0, 1, 2, 3);
+				std::size_t n = 0;
+
+				for (; n + 4 <= length; n += 4)
+				{
+					const auto x = _mm256_mul_pd(index, vratio);
+					const auto i = _mm_min_epi32(_mm256_cvttpd_epi32(x), vlast);
+					const auto fraction = _mm256_cvtpd_ps(_mm256_sub_pd(x, _mm256_cvtepi32_pd(i)));
+
+					const auto a = _mm_i32gather_ps(src, i, sizeof(float));
+					const auto b = _mm_i32gather_ps(src, _mm_min_epi32(_mm_add_epi32(i, one), vlast), sizeof(float));
+
+					_mm_storeu_ps(dst + n, _mm_add_ps(a, _mm_mul_ps(fraction, _mm_sub_ps(b, a))));
+
+					index = _mm256_add_pd(index, four);
+				}
+
+				for (; n < length; ++n)
+					Scalar::resampleSample(dst, src, last, n, ratio);
+			}
+		}
+
+		namespace
+		{
+			bool supportsSSE2() noexcept
+			{
+			#ifdef _MSC_VER
+				int info[4];
+				__cpuid(info, 1);
+				return (info[3] & (1 << 26)) != 0;
+			#else
+				return __builtin_cpu_supports("sse2");
+			#endif
+			}
+
+			bool supportsAVX2() noexcept
+			{
+			#ifdef _MSC_VER
+				int info[4];
+				__cpuid(info, 0);
+
+				if (info[0] < 7)
+					return false;
+
+				__cpuid(info, 1);
+
+				const bool osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+
+				// the OS must also preserve the ymm registers
+				if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+					return false;
+
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+			#else
+				return __builtin_cpu_supports("avx2");
+			#endif
+			}
+		}
+#endif
+
+#ifdef APE_AUX_NEON
+		namespace NEON
+		{
+			void accumulateRamp(float* dst, const float* src, std::size_t length, float start, float step)
+			{
+				static const float ramp[4] = { 0, 1, 2, 3 };
+				const auto vstart = vdupq_n_f32(start), vstep = vdupq_n_f32(step), four = vdupq_n_f32(4);
+				auto index = vld1q_f32(ramp);
+				std::size_t n = 0;
+
+				// vmlaq_f32 may be fused on some targets, so the product and sum are kept separate.
+				for (; n + 4 <= length; n += 4)
+				{
+					const auto gain = vaddq_f32(vstart, vmulq_f32(index, vstep));
+					vst1q_f32(dst + n, vaddq_f32(vld1q_f32(dst + n), vmulq_f32(vld1q_f32(src + n), gain)));
+					index = vaddq_f32(index, four);
+				}
+
+				for (; n < length; ++n)
+					Scalar::accumulateSample(dst, src, n, start, step);
+			}
+
+			void resample(float* dst, std::size_t length, const float* src, std::size_t sourceLength, double ratio)
+			{
+				static const double ramp[4] = { 0, 1, 2, 3 };
+				const auto last = static_cast<std::int32_t>(sourceLength - 1);
+				const auto vratio = vdupq_n_f64(ratio), four = vdupq_n_f64(4);
+				const auto vlast = vdupq_n_s64(static_cast<std::int64_t>(last)), one = vdupq_n_s64(1);
+				auto low = vld1q_f64(ramp), high = vld1q_f64(ramp + 2);
+				std::size_t n = 0;
+
+				for (; n + 4 <= length; n += 4)
+				{
+					const auto xlow = vmulq_f64(low, vratio), xhigh = vmulq_f64(high, vratio);
+
+					// no 64-bit integer min in NEON, so clamp through a compare-select
+					auto ilow = vcvtq_s64_f64(xlow), ihigh = vcvtq_s64_f64(xhigh);
+					ilow = vbslq_s64(vcgtq_s64(ilow, vlast), vlast, ilow);
+					ihigh = vbslq_s64(vcgtq_s64(ihigh, vlast), vlast, ihigh);
+
+					const auto fraction = vcombine_f32(
+						vcvt_f32_f64(vsubq_f64(xlow, vcvtq_f64_s64(ilow))),
+						vcvt_f32_f64(vsubq_f64(xhigh, vcvtq_f64_s64(ihigh)))
+					);
+
+					std::int64_t indices[4];
+					vst1q_s64(indices, ilow);
+					vst1q_s64(indices + 2, ihigh);
+
+					float a[4], b[4];
+
+					for (int k = 0; k < 4; ++k)
+					{
+						const auto i = static_cast<std::int32_t>(indices[k]);
+						a[k] = src[i];
+						b[k] = src[std::min(i + 1, last)];
+					}
+
+					const auto va = vld1q_f32(a);
+					vst1q_f32(dst + n, vaddq_f32(va, vmulq_f32(fraction, vsubq_f32(vld1q_f32(b), va))));
+
+					low = vaddq_f64(low, four);
+					high = vaddq_f64(high, four);
+				}
+
+				for (; n < length; ++n)
+					Scalar::resampleSample(dst, src, last, n, ratio);
+			}
+		}
+#endif
+
+		const Table& scalar() noexcept
+		{
+			static const Table table { "scalar", Scalar::copy, Scalar::clear, Scalar::accumulateRamp, Scalar::resample };
+			return table;
+		}
+
+		const Table* sse2() noexcept
+		{
+		#ifdef APE_AUX_X86
+			static const Table table { "sse2", Scalar::copy, Scalar::clear, SSE2::accumulateRamp, SSE2::resample };
+			static const bool supported = supportsSSE2();
+			return supported ? &table : nullptr;
+		#else
+			return nullptr;
+		#endif
+		}
+
+		const Table* avx2() noexcept
+		{
+		#ifdef APE_AUX_X86
+			static const Table table { "avx2", Scalar::copy, Scalar::clear, AVX2::accumulateRamp, AVX2::resample };
+			static const bool supported = supportsAVX2();
+			return supported ? &table : nullptr;
+		#else
+			return nullptr;
+		#endif
+		}
+
+		const Table* neon() noexcept
+		{
+		#ifdef APE_AUX_NEON
+			static const Table table { "neon", Scalar::copy, Scalar::clear, NEON::accumulateRamp, NEON::resample };
+			return &table;
+		#else
+			return nullptr;
+		#endif
+		}
+
+		const Table& active() noexcept
+		{
+			static const Table& best = []() -> const Table&
+			{
+				for (auto candidate : { avx2(), sse2(), neon() })
+				{
+					if (candidate)
+						return *candidate;
+				}
+
+				return scalar();
+			}();
+
+			return best;
+		}
+	}
+}
@@ -33,11 +33,13 @@
 	#include <vector>
 	#include <string>
 	#include <algorithm>
-    #include <cpl/dsp.h>
+	#include <cstddef>
+	#include <cstring>
 
 	namespace ape 
 	{
 		class PluginState;
+		class ProcessingGraph;
 
 		enum class PluginExchangeReason
 		{
@@ -56,10 +58,51 @@
 		}
 
 
+		namespace AuxKernels
+		{
+			/// <summary>
+			/// A set of channel kernels for one instruction set. All sets produce bit-exact
+			/// identical results (no fused multiply-adds, same operation order per sample),
+			/// so the one in use can be changed freely.
+			/// </summary>
+			struct Table
+			{
+				const char* name;
+				void (*copy)(float* dst, const float* src, std::size_t length);
+				void (*clear)(float* dst, std::size_t length);
+				/// <summary>
+				/// dst[n] += src[n] * (start + n * step)
+				/// </summary>
+				void (*accumulateRamp)(float* dst, const float* src, std::size_t length, float start, float step);
+				/// <summary>
+				/// Linear interpolation of src at n * ratio, for n in [0, length)
+				/// </summary>
+				void (*resample)(float* dst, std::size_t length, const float* src, std::size_t sourceLength, double ratio);
+			};
+
+			const Table& scalar() noexcept;
+			/// <summary>
+			/// Returns null if the instruction set isn't compiled in, or supported by this CPU.
+			/// </summary>
+			const Table* sse2() noexcept;
+			const Table* avx2() noexcept;
+			const Table* neon() noexcept;
+			/// <summary>
+			/// The best supported kernels, selected once at runtime.
+			/// </summary>
+			const Table& active() noexcept;
+		}
+
 		class AuxMatrix
 		{
 		public:
 
+			AuxMatrix()
+				: kernels(&AuxKernels::active())
+			{
+
+			}
+
 			void resizeChannels(std::size_t length)
 			{
 				auxBuffers.resize(length);
@@ -80,21 +123,18 @@
 			{
 				for (std::size_t i = 0; i < numBuffers; ++i)
 				{
-					std::memcpy(auxBuffers[i + index], buffers[i], bufferLength * sizeof(float));
+					kernels->copy(auxBuffers[i + index], buffers[i], bufferLength);
 				}
 			}
 
 			void accumulate(const float* const* buffers, std::size_t index, std::size_t numBuffers, float start, float end)
 			{
-				const auto delta = end - start;
+				// reciprocal once, instead of a division per sample
+				const float step = bufferLength > 1 ? (end - start) / float(bufferLength - 1) : 0.0f;
 
 				for (std::size_t i = 0; i < numBuffers; ++i)
 				{
-					for (std::size_t n = 0; n < bufferLength; ++n)
-					{
-						const float progress = n / float(bufferLength - 1);
-						auxBuffers[i + index][n] += buffers[i][n] * (start + progress * delta);
-					}
+					kernels->accumulateRamp(auxBuffers[i + index], buffers[i], bufferLength, start, step);
 				}
 			}
 
@@ -102,7 +142,7 @@
 			{
 				for (std::size_t i = 0; i < numBuffers; ++i)
 				{
-					std::memset(auxBuffers[i + index], 0, bufferLength * sizeof(float));
+					kernels->clear(auxBuffers[i + index], bufferLength);
 				}
 			}
 
@@ -110,24 +150,24 @@
 			{
 				if (numSamples == bufferLength)
 					return copy(&buffer, index, 1);
-				
-                auto ratio = (double)numSamples / bufferLength;
-                double x = 0;
 
-                cpl::Types::fsint_t samples = static_cast<cpl::Types::fsint_t>(numSamples);
+				if (numSamples == 0)
+					return clear(index, 1);
 
-                for (std::size_t i = 0; i < bufferLength; ++i)
-                {
-                    auxBuffers[index][i] = cpl::dsp::linearFilter<float>(buffer, samples, x);
-                    x += ratio;
-                }				
+				kernels->resample(auxBuffers[index], bufferLength, buffer, numSamples, (double)numSamples / bufferLength);
 			}
 
+			/// <summary>
+			/// Overrides the kernels selected at runtime, mostly for testing.
+			/// </summary>
+			void setKernels(const AuxKernels::Table& table) noexcept { kernels = &table; }
+
 			float* operator [] (std::size_t index) const { return auxBuffers[index]; }
 			float** data() noexcept { return auxBuffers.data(); }
 			std::size_t size() const noexcept { return auxBuffers.size(); }
 
 		private:
+			const AuxKernels::Table* kernels;
 			std::size_t bufferLength = 0;
 			std::vector<float> auxData;
 			std::vector<float*> auxBuffers;
@@ -268,7 +308,8 @@
             
 			enum class Type
 			{
-				Transfer = 7
+				Transfer = 7,
+				Graph
 			};
 
 			struct TransferPlugin
@@ -303,9 +344,26 @@
                 TransientPluginOptions options;
 			};
 
+			struct TransferGraph
+			{
+				static EngineCommand Create(ProcessingGraph* graph, PluginExchangeReason reason = PluginExchangeReason::Exchanged)
+				{
+					EngineCommand ret;
+					ret.type = Type::Graph;
+					ret.graph.graph = graph;
+					ret.graph.reason = reason;
+
+					return ret;
+				}
+
+				ProcessingGraph* graph;
+				PluginExchangeReason reason;
+			};
+
 			Type type;
 
 			TransferPlugin transfer;
+			TransferGraph graph;
 		};
 	}
 #endif
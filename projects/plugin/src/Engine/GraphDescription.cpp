@@ -0,0 +1,140 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:GraphDescription.cpp
+		
+		Implementation of GraphDescription.h
+
+*************************************************************************************/
+
+
+#include "GraphDescription.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace ape
+{
+	GraphDescription GraphDescription::FromFile(const std::string& path)
+	{
+		std::ifstream stream(path);
+
+		if (!stream.good())
+			throw std::runtime_error("Unable to open graph file " + path);
+
+		return Parse(stream, path);
+	}
+
+	GraphDescription GraphDescription::Single(const std::string& name, const std::string& script)
+	{
+		GraphDescription ret;
+		ret.nodes.push_back({ name, script });
+		ret.connections.push_back({ ProcessingGraph::Host, 0 });
+		ret.connections.push_back({ 0, ProcessingGraph::Host });
+		return ret;
+	}
+
+	GraphDescription GraphDescription::Parse(std::istream& stream, const std::string& source)
+	{
+		GraphDescription ret;
+		std::string line;
+
+		for (std::size_t lineNumber = 1; std::getline(stream, line); ++lineNumber)
+		{
+			auto error = [&](const std::string& message)
+			{
+				return std::runtime_error(source + "(" + std::to_string(lineNumber) + "): " + message);
+			};
+
+			auto find = [&](const std::string& name)
+			{
+				if (name == "host")
+					return ProcessingGraph::Host;
+
+				auto it = std::find_if(ret.nodes.begin(), ret.nodes.end(), [&](const Node& n) { return n.name == name; });
+
+				if (it == ret.nodes.end())
+					throw error("unknown node " + name);
+
+				return static_cast<ProcessingGraph::Node>(it - ret.nodes.begin());
+			};
+
+			if (auto comment = line.find('#'); comment != std::string::npos)
+				line.erase(comment);
+
+			std::istringstream fields(line);
+			std::string first;
+
+			if (!(fields >> first))
+				continue;
+
+			if (first == "node")
+			{
+				Node node;
+
+				if (!(fields >> node.name))
+					throw error("expected node <name> <script path>");
+
+				// the rest of the line, so paths may contain spaces
+				std::getline(fields >> std::ws, node.script);
+
+				while (!node.script.empty() && std::isspace(static_cast<unsigned char>(node.script.back())))
+					node.script.pop_back();
+
+				if (node.script.empty())
+					throw error("missing script of node " + node.name);
+
+				if (node.name == "host")
+					throw error("\"host\" is reserved for the host inputs and outputs");
+
+				if (std::any_of(ret.nodes.begin(), ret.nodes.end(), [&](const Node& n) { return n.name == node.name; }))
+					throw error("node " + node.name + " is declared twice");
+
+				ret.nodes.push_back(std::move(node));
+				continue;
+			}
+
+			std::string arrow, to, rest;
+
+			if (!(fields >> arrow >> to) || arrow != "->" || (fields >> rest))
+				throw error("expected node <name> <script path>, or <from> -> <to>");
+
+			const auto connection = Connection { find(first), find(to) };
+
+			if (connection.from == ProcessingGraph::Host && connection.to == ProcessingGraph::Host)
+				throw error("the host can't be connected to itself");
+
+			ret.connections.push_back(connection);
+		}
+
+		if (stream.bad())
+			throw std::runtime_error("Error reading graph file " + source);
+
+		if (ret.nodes.empty())
+			throw std::runtime_error(source + ": the graph has no nodes");
+
+		return ret;
+	}
+};
@@ -0,0 +1,94 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:GraphDescription.h
+		
+		Text format describing a processing graph of scripts, loaded from
+		.apegraph files:
+		
+			# comment
+			node <name> <script path>
+			<from> -> <to>
+		
+		Script paths are relative to the graph file. "host" names the host
+		inputs as a source, and the host outputs as a destination. See ProcessingGraph.
+
+*************************************************************************************/
+
+
+#ifndef APE_GRAPHDESCRIPTION_H
+	#define APE_GRAPHDESCRIPTION_H
+
+	#include <istream>
+	#include <string>
+	#include <vector>
+	#include "ProcessingGraph.h"
+
+	namespace ape
+	{
+		class GraphDescription
+		{
+		public:
+
+			struct Node
+			{
+				std::string name;
+				/// <summary>
+				/// Absolute, or relative to the directory of the graph file.
+				/// </summary>
+				std::string script;
+			};
+
+			/// <summary>
+			/// Indices into the nodes, or ProcessingGraph::Host.
+			/// </summary>
+			struct Connection
+			{
+				ProcessingGraph::Node from, to;
+			};
+
+			/// <summary>
+			/// Throws std::runtime_error on read errors, or errors in the format (with the line number).
+			/// </summary>
+			static GraphDescription FromFile(const std::string& path);
+			/// <summary>
+			/// See <see cref="FromFile()"/>. <paramref name="source"/> names the stream in errors.
+			/// </summary>
+			static GraphDescription Parse(std::istream& stream, const std::string& source);
+			/// <summary>
+			/// A graph of the single node <paramref name="name"/> running <paramref name="script"/>,
+			/// between the host inputs and outputs.
+			/// </summary>
+			static GraphDescription Single(const std::string& name, const std::string& script);
+
+			const std::vector<Node>& getNodes() const noexcept { return nodes; }
+			const std::vector<Connection>& getConnections() const noexcept { return connections; }
+
+		private:
+
+			std::vector<Node> nodes;
+			std::vector<Connection> connections;
+		};
+	};
+
+#endif
@@ -0,0 +1,161 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:LatencyHistogram.cpp
+		
+		Implementation of LatencyHistogram.h
+
+*************************************************************************************/
+
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ape
+{
+	LatencyHistogram::LatencyHistogram(double thresholdFraction)
+		: threshold(thresholdFraction)
+		, resetsRequested(0)
+		, resetsDone(0)
+	{
+		clear();
+	}
+
+	void LatencyHistogram::record(double seconds, double deadline) noexcept
+	{
+		const auto resets = resetsRequested.load(std::memory_order_acquire);
+
+		if (resets != resetsDone.load(std::memory_order_relaxed))
+		{
+			clear();
+			resetsDone.store(resets, std::memory_order_release);
+		}
+
+		if (deadline <= 0)
+			return;
+
+		const auto load = seconds / deadline;
+		auto& bucket = buckets[bucketOf(load)];
+
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		if (load > threshold.load(std::memory_order_relaxed))
+			overThreshold.store(overThreshold.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		if (load > 1)
+			overDeadline.store(overDeadline.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		if (load > max.load(std::memory_order_relaxed))
+		{
+			max.store(load, std::memory_order_relaxed);
+			maxSeconds.store(seconds, std::memory_order_relaxed);
+			maxTime.store(std::chrono::system_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+		}
+
+		// published last, so readers never see more blocks than counted in the buckets
+		blocks.store(blocks.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	LatencyHistogram::Snapshot LatencyHistogram::snapshot() const noexcept
+	{
+		Snapshot ret {};
+
+		ret.blocks = blocks.load(std::memory_order_acquire);
+		ret.max = max.load(std::memory_order_relaxed);
+		ret.maxSeconds = maxSeconds.load(std::memory_order_relaxed);
+		ret.maxTime = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(maxTime.load(std::memory_order_relaxed)));
+		ret.overThreshold = overThreshold.load(std::memory_order_relaxed);
+		ret.overDeadline = overDeadline.load(std::memory_order_relaxed);
+		ret.threshold = threshold.load(std::memory_order_relaxed);
+
+		std::array<std::uint64_t, numBuckets> counts;
+		std::uint64_t total = 0;
+
+		for (std::size_t i = 0; i < numBuckets; ++i)
+			total += counts[i] = buckets[i].load(std::memory_order_relaxed);
+
+		auto percentile = [&](double fraction)
+		{
+			if (total == 0)
+				return 0.0;
+
+			// the smallest bucket covering the fraction of the blocks
+			const auto rank = static_cast<std::uint64_t>(std::ceil(fraction * total));
+			std::uint64_t sum = 0;
+
+			for (std::size_t i = 0; i < numBuckets; ++i)
+			{
+				sum += counts[i];
+
+				if (sum >= rank)
+					return std::min(bucketLimit(i), ret.max);
+			}
+
+			return ret.max;
+		};
+
+		ret.p50 = percentile(0.5);
+		ret.p99 = percentile(0.99);
+		ret.p999 = percentile(0.999);
+
+		return ret;
+	}
+
+	void LatencyHistogram::reset() noexcept
+	{
+		resetsRequested.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	void LatencyHistogram::setThreshold(double fraction) noexcept
+	{
+		threshold.store(fraction, std::memory_order_relaxed);
+	}
+
+	double LatencyHistogram::bucketLimit(std::size_t bucket) noexcept
+	{
+		return std::exp2(minOctave + static_cast<double>(bucket + 1) / bucketsPerOctave);
+	}
+
+	std::size_t LatencyHistogram::bucketOf(double load) noexcept
+	{
+		if (!(load > 0))
+			return 0;
+
+		const auto position = std::ceil((std::log2(load) - minOctave) * bucketsPerOctave) - 1;
+
+		return static_cast<std::size_t>(std::clamp(position, 0.0, static_cast<double>(numBuckets - 1)));
+	}
+
+	void LatencyHistogram::clear() noexcept
+	{
+		for (auto& bucket : buckets)
+			bucket.store(0, std::memory_order_relaxed);
+
+		overThreshold.store(0, std::memory_order_relaxed);
+		overDeadline.store(0, std::memory_order_relaxed);
+		max.store(0, std::memory_order_relaxed);
+		maxSeconds.store(0, std::memory_order_relaxed);
+		maxTime.store(0, std::memory_order_relaxed);
+		blocks.store(0, std::memory_order_release);
+	}
+}
@@ -0,0 +1,121 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:LatencyHistogram.h
+		
+		Histogram of the time the audio thread spends on every block, relative to
+		the deadline of the block (its length in time). Percentiles of averages hide
+		the single slow block causing a dropout, this doesn't.
+		Recording is lock-free and wait-free, for the audio thread.
+
+*************************************************************************************/
+
+#ifndef APE_LATENCYHISTOGRAM_H
+	#define APE_LATENCYHISTOGRAM_H
+
+	#include <array>
+	#include <atomic>
+	#include <chrono>
+	#include <cstddef>
+	#include <cstdint>
+
+	namespace ape
+	{
+		class LatencyHistogram
+		{
+		public:
+
+			struct Snapshot
+			{
+				std::uint64_t blocks;
+				/// <summary>
+				/// Percentiles of the load (time spent over the deadline), to the resolution of the histogram.
+				/// </summary>
+				double p50, p99, p999;
+				/// <summary>
+				/// Exact load and time of the slowest block.
+				/// </summary>
+				double max, maxSeconds;
+				/// <summary>
+				/// When the slowest block was recorded. Undefined if there are no blocks.
+				/// </summary>
+				std::chrono::system_clock::time_point maxTime;
+				/// <summary>
+				/// Blocks with a load above the threshold, and blocks that missed the deadline altogether.
+				/// </summary>
+				std::uint64_t overThreshold, overDeadline;
+				double threshold;
+			};
+
+			/// <summary>
+			/// Blocks taking more than <paramref name="threshold"/> of their deadline are counted.
+			/// </summary>
+			LatencyHistogram(double threshold = 0.8);
+
+			/// <summary>
+			/// Records a block that took <paramref name="seconds"/> to process, and had to be done in <paramref name="deadline"/> seconds.
+			/// Only one thread may record at a time.
+			/// </summary>
+			void record(double seconds, double deadline) noexcept;
+
+			/// <summary>
+			/// The statistics so far, from any thread. The fields may be off by the blocks recorded while reading.
+			/// </summary>
+			Snapshot snapshot() const noexcept;
+
+			/// <summary>
+			/// Clears the statistics, from any thread. Takes effect when the next block is recorded.
+			/// </summary>
+			void reset() noexcept;
+
+			/// <summary>
+			/// From any thread, counts from the next block.
+			/// </summary>
+			void setThreshold(double fraction) noexcept;
+
+			/// <summary>
+			/// Loads from 1/1024 to 64 times the deadline are resolved in steps of 2^(1/8) (about 9%), outside of that they're clamped.
+			/// </summary>
+			static constexpr int bucketsPerOctave = 8;
+			static constexpr int minOctave = -10, maxOctave = 6;
+			static constexpr std::size_t numBuckets = (maxOctave - minOctave) * bucketsPerOctave;
+
+			/// <summary>
+			/// The upper bound of the loads counted in <paramref name="bucket"/>.
+			/// </summary>
+			static double bucketLimit(std::size_t bucket) noexcept;
+
+		private:
+
+			static std::size_t bucketOf(double load) noexcept;
+			void clear() noexcept;
+
+			// only written by the recording thread, so relaxed stores suffice
+			std::array<std::atomic<std::uint64_t>, numBuckets> buckets;
+			std::atomic<std::uint64_t> blocks, overThreshold, overDeadline;
+			std::atomic<double> max, maxSeconds, threshold;
+			std::atomic<std::int64_t> maxTime;
+			std::atomic<std::uint32_t> resetsRequested, resetsDone;
+		};
+	}
+#endif
@@ -0,0 +1,102 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:LineProfiler.cpp
+		
+		Implementation of LineProfiler.h
+
+*************************************************************************************/
+
+#include "LineProfiler.h"
+#include <chrono>
+#include <random>
+
+namespace ape
+{
+	namespace
+	{
+		// the interval is randomised, so samples don't fall in step with the blocks
+		const std::chrono::microseconds minimumInterval(100), maximumInterval(400);
+		// nothing in a script has that many lines, the register is probably corrupt
+		const int maximumLine = 1 << 20;
+	}
+
+	LineProfiler::LineProfiler(const std::atomic<bool>& processing, volatile const int& currentLine)
+		: processing(processing)
+		, currentLine(currentLine)
+		, counts(1)
+	{
+		thread = std::thread([this] { run(); });
+	}
+
+	LineProfiler::~LineProfiler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+
+		wakeup.notify_one();
+		thread.join();
+	}
+
+	std::vector<float> LineProfiler::getProfile() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<float> profile(counts.size() - 1);
+
+		if (samples == 0)
+			return profile;
+
+		for (std::size_t i = 1; i < counts.size(); ++i)
+			profile[i - 1] = static_cast<float>(static_cast<double>(counts[i]) / samples);
+
+		return profile;
+	}
+
+	void LineProfiler::run()
+	{
+		std::minstd_rand random(std::random_device{}());
+		std::uniform_int_distribution<long long> interval(minimumInterval.count(), maximumInterval.count());
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (!wakeup.wait_for(lock, std::chrono::microseconds(interval(random)), [this] { return quit; }))
+		{
+			if (!processing.load(std::memory_order_acquire))
+				continue;
+
+			const int line = currentLine;
+
+			if (line < 0 || line > maximumLine)
+				continue;
+
+			if (static_cast<std::size_t>(line) >= counts.size())
+				counts.resize(line + 1);
+
+			counts[line]++;
+			samples++;
+		}
+	}
+}
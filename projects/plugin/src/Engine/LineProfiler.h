@@ -0,0 +1,82 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:LineProfiler.h
+		
+		Statistical profiler of the source lines of a script, sampling the line it's
+		executing from a thread of its own while it processes. Lines are tracked by
+		the compiled code itself (see APE_Project::profileLines), the audio thread
+		only ever writes the line and is never interrupted or blocked.
+
+*************************************************************************************/
+
+#ifndef APE_LINEPROFILER_H
+	#define APE_LINEPROFILER_H
+
+	#include <atomic>
+	#include <condition_variable>
+	#include <cstdint>
+	#include <mutex>
+	#include <thread>
+	#include <vector>
+
+	namespace ape
+	{
+		class LineProfiler
+		{
+		public:
+
+			/// <summary>
+			/// Starts sampling <paramref name="currentLine"/> whenever <paramref name="processing"/> is set,
+			/// until destroyed. Both must outlive the profiler.
+			/// </summary>
+			LineProfiler(const std::atomic<bool>& processing, volatile const int& currentLine);
+			~LineProfiler();
+
+			LineProfiler(const LineProfiler&) = delete;
+			LineProfiler& operator = (const LineProfiler&) = delete;
+
+			/// <summary>
+			/// The share of the processing time spent on every (zero-based) line so far, from 0 to 1.
+			/// Time not spent on any line of the source, like in the host, counts towards the total only.
+			/// Thread safe.
+			/// </summary>
+			std::vector<float> getProfile() const;
+
+		private:
+
+			void run();
+
+			const std::atomic<bool>& processing;
+			volatile const int& currentLine;
+
+			mutable std::mutex mutex;
+			std::condition_variable wakeup;
+			// indexed by 1-based line, the first entry counts samples outside the source
+			std::vector<std::uint64_t> counts;
+			std::uint64_t samples = 0;
+			bool quit = false;
+			std::thread thread;
+		};
+	}
+#endif
@@ -0,0 +1,264 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:ProcessingGraph.cpp
+		
+		Implementation of ProcessingGraph.h
+
+*************************************************************************************/
+
+#include "ProcessingGraph.h"
+#include "EngineStructures.h"
+#include <stdexcept>
+#include <string>
+
+namespace ape
+{
+	struct ProcessingGraph::NodeState : public RealtimePool::Job
+	{
+		ProcessingGraph* graph;
+		std::shared_ptr<Processor> processor;
+		std::vector<Node> sources, successors;
+		std::size_t numPredecessors = 0;
+
+		std::atomic<std::size_t> pending;
+		std::atomic<bool> failed;
+
+		// only used for summing multiple sources
+		std::vector<float> sum;
+		std::vector<float*> sumChannels;
+		std::vector<const float*> inputChannels;
+	};
+
+	ProcessingGraph::ProcessingGraph()
+		: remaining(0)
+	{
+
+	}
+
+	ProcessingGraph::~ProcessingGraph()
+	{
+
+	}
+
+	ProcessingGraph::Node ProcessingGraph::add(std::shared_ptr<Processor> processor)
+	{
+		auto node = std::make_unique<NodeState>();
+		node->execute = &ProcessingGraph::execute;
+		node->graph = this;
+		node->processor = std::move(processor);
+		node->pending.store(0);
+		node->failed.store(false);
+
+		nodes.emplace_back(std::move(node));
+		return nodes.size() - 1;
+	}
+
+	void ProcessingGraph::connect(Node from, Node to)
+	{
+		if ((from != Host && from >= nodes.size()) || (to != Host && to >= nodes.size()))
+			throw std::out_of_range("Connection to non-existing node");
+
+		if (to == Host)
+			outputSources.push_back(from);
+		else
+			nodes[to]->sources.push_back(from);
+	}
+
+	void ProcessingGraph::prepare(std::size_t inputs, std::size_t outputs, std::size_t maxBlock)
+	{
+		numInputs = inputs;
+		numOutputs = outputs;
+		maxBlockSize = maxBlock;
+
+		for (auto& node : nodes)
+		{
+			node->successors.clear();
+			node->numPredecessors = 0;
+		}
+
+		for (std::size_t i = 0; i < nodes.size(); ++i)
+		{
+			for (auto source : nodes[i]->sources)
+			{
+				if (source != Host)
+				{
+					nodes[source]->successors.push_back(i);
+					nodes[i]->numPredecessors++;
+				}
+			}
+		}
+
+		// Kahn's algorithm, just to reject cycles. Execution order is decided at runtime.
+		std::vector<std::size_t> unresolved(nodes.size());
+		std::vector<Node> ready;
+		roots.clear();
+
+		for (std::size_t i = 0; i < nodes.size(); ++i)
+		{
+			unresolved[i] = nodes[i]->numPredecessors;
+
+			if (unresolved[i] == 0)
+			{
+				ready.push_back(i);
+				roots.push_back(nodes[i].get());
+			}
+		}
+
+		std::size_t visited = 0;
+
+		while (!ready.empty())
+		{
+			auto node = ready.back();
+			ready.pop_back();
+			visited++;
+
+			for (auto successor : nodes[node]->successors)
+			{
+				if (--unresolved[successor] == 0)
+					ready.push_back(successor);
+			}
+		}
+
+		if (visited != nodes.size())
+			throw std::runtime_error("Processing graph contains a cycle (" + std::to_string(nodes.size() - visited) + " nodes involved)");
+
+		silence.assign(maxBlockSize, 0.0f);
+
+		for (auto& node : nodes)
+		{
+			node->inputChannels.resize(numInputs);
+
+			if (node->sources.size() > 1)
+			{
+				node->sum.resize(numInputs * maxBlockSize);
+				node->sumChannels.resize(numInputs);
+
+				for (std::size_t c = 0; c < numInputs; ++c)
+					node->sumChannels[c] = node->sum.data() + c * maxBlockSize;
+			}
+
+			node->processor->prepare(numInputs, numOutputs, maxBlockSize);
+		}
+	}
+
+	void ProcessingGraph::release()
+	{
+		for (auto& node : nodes)
+			node->processor->release();
+	}
+
+	const float* ProcessingGraph::channelOf(Node source, std::size_t channel) const noexcept
+	{
+		if (source == Host)
+			return channel < numInputs ? hostInputs[channel] : silence.data();
+
+		auto& node = *nodes[source];
+
+		if (channel >= numOutputs || node.failed.load(std::memory_order_relaxed))
+			return silence.data();
+
+		return node.processor->outputs()[channel];
+	}
+
+	void ProcessingGraph::gather(const std::vector<Node>& sources, float* const* destinations, std::size_t numChannels) const noexcept
+	{
+		auto& kernels = AuxKernels::active();
+
+		for (std::size_t c = 0; c < numChannels; ++c)
+		{
+			if (sources.empty())
+			{
+				kernels.clear(destinations[c], blockSize);
+				continue;
+			}
+
+			kernels.copy(destinations[c], channelOf(sources[0], c), blockSize);
+
+			for (std::size_t s = 1; s < sources.size(); ++s)
+				kernels.accumulateRamp(destinations[c], channelOf(sources[s], c), blockSize, 1.0f, 0.0f);
+		}
+	}
+
+	void ProcessingGraph::execute(RealtimePool::Job& job, RealtimePool& pool)
+	{
+		auto& node = static_cast<NodeState&>(job);
+		auto& graph = *node.graph;
+
+		const float* const* inputs = node.inputChannels.data();
+
+		if (node.sources.size() > 1)
+		{
+			graph.gather(node.sources, node.sumChannels.data(), graph.numInputs);
+			inputs = node.sumChannels.data();
+		}
+		else
+		{
+			// single (or no) source, pass its buffers directly
+			for (std::size_t c = 0; c < graph.numInputs; ++c)
+				node.inputChannels[c] = node.sources.empty() ? graph.silence.data() : graph.channelOf(node.sources[0], c);
+		}
+
+		if (!node.processor->process(inputs, graph.blockSize))
+			node.failed.store(true, std::memory_order_relaxed);
+
+		for (auto successor : node.successors)
+		{
+			auto& next = *graph.nodes[successor];
+
+			if (next.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				pool.push(next);
+		}
+
+		graph.remaining.fetch_sub(1, std::memory_order_release);
+	}
+
+	bool ProcessingGraph::process(RealtimePool& pool, const float* const* inputs, float* const* outputs, std::size_t numSamples)
+	{
+		if (numSamples > maxBlockSize)
+			return false;
+
+		hostInputs = inputs;
+		blockSize = numSamples;
+
+		for (auto& node : nodes)
+		{
+			node->pending.store(node->numPredecessors, std::memory_order_relaxed);
+			node->failed.store(false, std::memory_order_relaxed);
+		}
+
+		remaining.store(nodes.size(), std::memory_order_relaxed);
+
+		// publishes the above through the deques
+		pool.run(roots.data(), roots.size(), remaining);
+
+		gather(outputSources, outputs, numOutputs);
+
+		bool ok = true;
+
+		for (auto& node : nodes)
+			ok = ok && !node->failed.load(std::memory_order_relaxed);
+
+		return ok;
+	}
+}
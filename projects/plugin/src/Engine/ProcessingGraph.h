@@ -0,0 +1,118 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:ProcessingGraph.h
+		
+		A directed acyclic graph of processors (usually scripts), supporting serial
+		chains, parallel splits and sums. Nodes whose inputs are ready run in
+		parallel on a RealtimePool.
+
+*************************************************************************************/
+
+#ifndef APE_PROCESSINGGRAPH_H
+	#define APE_PROCESSINGGRAPH_H
+
+	#include <atomic>
+	#include <cstddef>
+	#include <memory>
+	#include <vector>
+	#include "RealtimePool.h"
+
+	namespace ape
+	{
+		class ProcessingGraph
+		{
+		public:
+
+			class Processor
+			{
+			public:
+				virtual ~Processor() {}
+
+				virtual void prepare(std::size_t inputs, std::size_t outputs, std::size_t maxBlockSize) {}
+				virtual void release() {}
+				/// <summary>
+				/// Processes a block of inputs. May be called from any thread of the pool.
+				/// Returns false if the processor failed, in which case its output is considered silent.
+				/// </summary>
+				virtual bool process(const float* const* inputs, std::size_t numSamples) = 0;
+				/// <summary>
+				/// The result of the last process() call.
+				/// </summary>
+				virtual const float* const* outputs() const noexcept = 0;
+			};
+
+			typedef std::size_t Node;
+
+			/// <summary>
+			/// Refers to the host inputs when used as a source, and the host outputs when used as a destination.
+			/// </summary>
+			static constexpr Node Host = static_cast<Node>(-1);
+
+			ProcessingGraph();
+			~ProcessingGraph();
+
+			Node add(std::shared_ptr<Processor> processor);
+			/// <summary>
+			/// Routes the output of <paramref name="from"/> into <paramref name="to"/>.
+			/// A node with several inputs receives their sum.
+			/// </summary>
+			void connect(Node from, Node to);
+
+			/// <summary>
+			/// Sorts the graph and allocates everything needed to process it. Throws if the graph
+			/// contains cycles. Not thread safe with process().
+			/// </summary>
+			void prepare(std::size_t inputs, std::size_t outputs, std::size_t maxBlockSize);
+			void release();
+
+			/// <summary>
+			/// Processes a block through the graph, running independent nodes in parallel on the pool.
+			/// Real-time safe. Returns false if any node failed.
+			/// </summary>
+			bool process(RealtimePool& pool, const float* const* inputs, float* const* outputs, std::size_t numSamples);
+
+			std::size_t size() const noexcept { return nodes.size(); }
+
+		private:
+
+			struct NodeState;
+
+			static void execute(RealtimePool::Job& job, RealtimePool& pool);
+			const float* channelOf(Node source, std::size_t channel) const noexcept;
+			void gather(const std::vector<Node>& sources, float* const* destinations, std::size_t numChannels) const noexcept;
+
+			std::vector<std::unique_ptr<NodeState>> nodes;
+			std::vector<Node> outputSources;
+			std::vector<RealtimePool::Job*> roots;
+			std::vector<float> silence;
+
+			std::size_t numInputs = 0, numOutputs = 0, maxBlockSize = 0;
+
+			// per block state
+			std::atomic<std::size_t> remaining;
+			const float* const* hostInputs = nullptr;
+			std::size_t blockSize = 0;
+		};
+	}
+#endif
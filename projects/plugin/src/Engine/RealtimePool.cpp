@@ -0,0 +1,529 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:RealtimePool.cpp
+		
+		Implementation of RealtimePool.h
+
+*************************************************************************************/
+
+#include "RealtimePool.h"
+#include <cpl/PlatformSpecific.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <mutex>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+#endif
+
+#if defined(CPL_MAC)
+	#include <dispatch/dispatch.h>
+#elif !defined(CPL_WINDOWS)
+	#include <semaphore.h>
+	#include <cerrno>
+#endif
+
+#ifndef CPL_WINDOWS
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+namespace ape
+{
+	namespace
+	{
+		// how long workers keep spinning for new work after a run, if the block is never ended.
+		const auto spinTime = std::chrono::microseconds(250);
+
+		thread_local RealtimePool* currentPool = nullptr;
+		// serial of the last pool this thread published its scheduling to, see RealtimePool::publishScheduling()
+		thread_local std::uint64_t scheduledPool = 0;
+		std::atomic<std::uint64_t> poolsCreated { 0 };
+		thread_local std::size_t currentSlot = 0;
+		thread_local bool isWorker = false;
+
+		inline void relax() noexcept
+		{
+		#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+			_mm_pause();
+		#elif defined(__aarch64__) || defined(__arm__)
+			asm volatile("yield");
+		#else
+			std::this_thread::yield();
+		#endif
+		}
+
+		// policy and priority of a thread, packed so workers can read them atomically. zero means unknown.
+		struct Scheduling
+		{
+			int policy, priority;
+
+			static Scheduling unpack(std::uint64_t packed) noexcept
+			{
+				return { static_cast<int>(static_cast<std::uint32_t>(packed >> 32) & 0x7FFFFFFF), static_cast<int>(static_cast<std::uint32_t>(packed)) };
+			}
+
+			std::uint64_t pack() const noexcept
+			{
+				return (1ull << 63) | (static_cast<std::uint64_t>(static_cast<std::uint32_t>(policy)) << 32) | static_cast<std::uint32_t>(priority);
+			}
+
+			// real-time policies always rank above time sharing ones
+			int rank() const noexcept
+			{
+			#ifdef CPL_WINDOWS
+				return priority;
+			#else
+				return policy == SCHED_FIFO || policy == SCHED_RR ? 1000 + priority : 0;
+			#endif
+			}
+		};
+
+		std::uint64_t currentScheduling() noexcept
+		{
+		#ifdef CPL_WINDOWS
+			const auto priority = GetThreadPriority(GetCurrentThread());
+
+			if (priority == THREAD_PRIORITY_ERROR_RETURN)
+				return 0;
+
+			return Scheduling { 0, priority }.pack();
+		#else
+			int policy = 0;
+			sched_param param {};
+
+			if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
+				return 0;
+
+			return Scheduling { policy, param.sched_priority }.pack();
+		#endif
+		}
+
+		void applyScheduling(std::uint64_t packed) noexcept
+		{
+			const auto scheduling = Scheduling::unpack(packed);
+
+		#ifdef CPL_WINDOWS
+			SetThreadPriority(GetCurrentThread(), scheduling.priority);
+		#else
+			// will fail without real-time privileges, in which case the workers just run at normal priority.
+			sched_param param {};
+			param.sched_priority = scheduling.priority;
+			pthread_setschedparam(pthread_self(), scheduling.policy, &param);
+		#endif
+		}
+	}
+
+	// unlike a condition variable, signalling never takes a lock the waiters might hold
+	struct RealtimePool::Semaphore
+	{
+	#if defined(CPL_WINDOWS)
+		Semaphore() : handle(CreateSemaphore(nullptr, 0, LONG_MAX, nullptr)) {}
+		~Semaphore() { CloseHandle(handle); }
+		void post(std::size_t count) noexcept { ReleaseSemaphore(handle, static_cast<LONG>(count), nullptr); }
+		void wait() noexcept { WaitForSingleObject(handle, INFINITE); }
+
+		HANDLE handle;
+	#elif defined(CPL_MAC)
+		Semaphore() : handle(dispatch_semaphore_create(0)) {}
+		~Semaphore() { dispatch_release(handle); }
+		void post(std::size_t count) noexcept { while (count--) dispatch_semaphore_signal(handle); }
+		void wait() noexcept { dispatch_semaphore_wait(handle, DISPATCH_TIME_FOREVER); }
+
+		dispatch_semaphore_t handle;
+	#else
+		Semaphore() { sem_init(&handle, 0, 0); }
+		~Semaphore() { sem_destroy(&handle); }
+		void post(std::size_t count) noexcept { while (count--) sem_post(&handle); }
+		void wait() noexcept { while (sem_wait(&handle) != 0 && errno == EINTR); }
+
+		sem_t handle;
+	#endif
+	};
+
+	RealtimePool::Deque::Deque()
+		: top(0)
+		, bottom(0)
+	{
+		for (auto& slot : buffer)
+			slot.store(nullptr, std::memory_order_relaxed);
+	}
+
+	bool RealtimePool::Deque::push(Job* job) noexcept
+	{
+		const auto b = bottom.load(std::memory_order_relaxed);
+		const auto t = top.load(std::memory_order_acquire);
+
+		if (b - t >= static_cast<std::int64_t>(capacity))
+			return false;
+
+		buffer[b & (capacity - 1)].store(job, std::memory_order_relaxed);
+		// publishes the job (and everything written before pushing it) to thieves
+		bottom.store(b + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	RealtimePool::Job* RealtimePool::Deque::pop() noexcept
+	{
+		const auto b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		auto job = buffer[b & (capacity - 1)].load(std::memory_order_relaxed);
+
+		if (t == b)
+		{
+			// last element, race against thieves for it
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = nullptr;
+
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	RealtimePool::Job* RealtimePool::Deque::steal() noexcept
+	{
+		auto t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const auto b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+			return nullptr;
+
+		auto job = buffer[t & (capacity - 1)].load(std::memory_order_relaxed);
+
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+
+		return job;
+	}
+
+	RealtimePool::RealtimePool(std::size_t numWorkers)
+		: deques(new Deque[numWorkers + 1])
+		, numDeques(numWorkers + 1)
+		, running(false)
+		, quit(false)
+		, inBlock(false)
+		, scheduling(0)
+		, parked(0)
+		, parkingSpot(std::make_unique<Semaphore>())
+		, serial(++poolsCreated)
+		, helpers(new Job[numWorkers])
+	{
+		for (std::size_t i = 0; i < numWorkers; ++i)
+			helpers[i].execute = &RealtimePool::executeHelper;
+
+		loop.next.store(0);
+		loop.activeHelpers.store(0);
+
+		workers.reserve(numWorkers);
+
+		for (std::size_t i = 0; i < numWorkers; ++i)
+			workers.emplace_back(&RealtimePool::workerLoop, this, i);
+	}
+
+	RealtimePool::~RealtimePool()
+	{
+		quit.store(true);
+		wakeWorkers();
+
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	std::shared_ptr<RealtimePool> RealtimePool::acquire(int numWorkers)
+	{
+		static std::mutex mutex;
+		static std::weak_ptr<RealtimePool> shared;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (auto current = shared.lock())
+			return current;
+
+		auto pool = std::make_shared<RealtimePool>(numWorkers < 0 ? defaultWorkerCount() : static_cast<std::size_t>(numWorkers));
+		shared = pool;
+
+		return pool;
+	}
+
+	std::size_t RealtimePool::defaultWorkerCount() noexcept
+	{
+		// leave a core for the host and the rest of the system
+		const std::size_t cores = std::thread::hardware_concurrency();
+		return std::min<std::size_t>(cores > 2 ? cores - 2 : 0, 8);
+	}
+
+	void RealtimePool::run(Job* const* roots, std::size_t numRoots, const std::atomic<std::size_t>& remaining)
+	{
+		// pairs with the parking protocol in workerLoop(): either the worker sees we're running,
+		// or we see it parked.
+		bool expected = false;
+		if (!running.compare_exchange_strong(expected, true))
+		{
+			// another instance is using the pool. push() executes jobs right away on threads not running it
+			for (std::size_t i = 0; i < numRoots; ++i)
+				roots[i]->execute(*roots[i], *this);
+
+			return;
+		}
+
+		const auto self = numDeques - 1;
+		auto oldPool = currentPool;
+		auto oldSlot = currentSlot;
+
+		currentPool = this;
+		currentSlot = self;
+
+		publishScheduling();
+		inBlock.store(true, std::memory_order_relaxed);
+
+		if (parked.load() > 0)
+			wakeWorkers();
+
+		for (std::size_t i = 0; i < numRoots; ++i)
+		{
+			if (!deques[self].push(roots[i]))
+				roots[i]->execute(*roots[i], *this);
+		}
+
+		while (remaining.load(std::memory_order_acquire) != 0)
+		{
+			if (!executeOne(self))
+				relax();
+		}
+
+		running.store(false, std::memory_order_release);
+
+		currentPool = oldPool;
+		currentSlot = oldSlot;
+	}
+
+	void RealtimePool::push(Job& job)
+	{
+		if (currentPool != this || !deques[currentSlot].push(&job))
+			job.execute(job, *this);
+	}
+
+	void RealtimePool::parallelFor(std::size_t count, std::size_t grain, LoopBody body, void* context)
+	{
+		grain = std::max<std::size_t>(grain, 1);
+		const auto chunks = (count + grain - 1) / grain;
+
+		// anything running already (including a graph this loop is called from) owns the workers
+		bool expected = false;
+		if (chunks < 2 || workers.empty() || !running.compare_exchange_strong(expected, true))
+		{
+			if (count > 0)
+				body(context, 0, count);
+
+			return;
+		}
+
+		const auto self = numDeques - 1;
+		const auto numHelpers = std::min(workers.size(), std::min(chunks - 1, Deque::capacity));
+
+		loop.body = body;
+		loop.context = context;
+		loop.count = count;
+		loop.grain = grain;
+		loop.chunks = chunks;
+		loop.next.store(0, std::memory_order_relaxed);
+		loop.activeHelpers.store(numHelpers, std::memory_order_relaxed);
+
+		publishScheduling();
+		inBlock.store(true, std::memory_order_relaxed);
+
+		if (parked.load() > 0)
+			wakeWorkers();
+
+		// pushing publishes the loop state above to the workers stealing the helpers
+		for (std::size_t i = 0; i < numHelpers; ++i)
+			deques[self].push(&helpers[i]);
+
+		runChunks();
+
+		// reclaim helpers no worker got around to; they would find no chunks left anyway
+		while (auto job = deques[self].pop())
+		{
+			(void)job;
+			loop.activeHelpers.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		while (loop.activeHelpers.load(std::memory_order_acquire) != 0)
+			relax();
+
+		running.store(false, std::memory_order_release);
+	}
+
+	void RealtimePool::endBlock() noexcept
+	{
+		inBlock.store(false, std::memory_order_relaxed);
+	}
+
+	void RealtimePool::publishScheduling() noexcept
+	{
+		// only queried the first time a thread uses the pool, as it's a system call
+		if (scheduledPool == serial)
+			return;
+
+		scheduledPool = serial;
+
+		const auto mine = currentScheduling();
+
+		if (!mine)
+			return;
+
+		// workers match the most urgent thread they serve, so they're never preempted by the thread waiting for them
+		auto published = scheduling.load(std::memory_order_relaxed);
+
+		while ((!published || Scheduling::unpack(mine).rank() > Scheduling::unpack(published).rank())
+			&& !scheduling.compare_exchange_weak(published, mine, std::memory_order_relaxed));
+	}
+
+	bool RealtimePool::isWorkerThread() noexcept
+	{
+		return isWorker;
+	}
+
+	void RealtimePool::executeHelper(Job&, RealtimePool& pool)
+	{
+		pool.runChunks();
+		// publishes the work done by the chunks to the thread waiting in parallelFor()
+		pool.loop.activeHelpers.fetch_sub(1, std::memory_order_release);
+	}
+
+	void RealtimePool::runChunks() noexcept
+	{
+		for (;;)
+		{
+			const auto chunk = loop.next.fetch_add(1, std::memory_order_relaxed);
+
+			if (chunk >= loop.chunks)
+				break;
+
+			const auto begin = chunk * loop.grain;
+			loop.body(loop.context, begin, std::min(begin + loop.grain, loop.count));
+		}
+	}
+
+	bool RealtimePool::executeOne(std::size_t self)
+	{
+		auto job = deques[self].pop();
+
+		for (std::size_t i = 1; !job && i < numDeques; ++i)
+			job = deques[(self + i) % numDeques].steal();
+
+		if (!job)
+			return false;
+
+		job->execute(*job, *this);
+		return true;
+	}
+
+	void RealtimePool::wakeWorkers() noexcept
+	{
+		// takes over the announcements of every parking worker, and lets exactly that many through
+		if (const auto sleepers = parked.exchange(0))
+			parkingSpot->post(sleepers);
+	}
+
+	void RealtimePool::workerLoop(std::size_t self)
+	{
+		currentPool = this;
+		currentSlot = self;
+		isWorker = true;
+
+		auto lastWork = std::chrono::steady_clock::now();
+		unsigned idleCounter = 0;
+		std::uint64_t applied = 0;
+
+		while (!quit.load(std::memory_order_acquire))
+		{
+			const auto wanted = scheduling.load(std::memory_order_relaxed);
+
+			if (wanted != applied)
+			{
+				applied = wanted;
+				applyScheduling(wanted);
+			}
+
+			if (executeOne(self))
+			{
+				idleCounter = 0;
+				continue;
+			}
+
+			relax();
+
+			if (running.load(std::memory_order_acquire))
+			{
+				idleCounter = 0;
+				continue;
+			}
+
+			// checking the clock is comparatively expensive, so only do it now and then
+			if ((++idleCounter & 0xFF) != 0)
+				continue;
+
+			// more runs may follow in this block, until it's ended
+			if (inBlock.load(std::memory_order_relaxed))
+			{
+				const auto now = std::chrono::steady_clock::now();
+
+				if (idleCounter == 0x100)
+					lastWork = now;
+
+				if (now - lastWork < spinTime)
+					continue;
+			}
+
+			idleCounter = 0;
+			parked.fetch_add(1);
+
+			if (running.load() || quit.load())
+			{
+				// take the announcement back, unless a waker already took it and posted for it
+				auto announced = parked.load();
+				while (announced > 0 && !parked.compare_exchange_weak(announced, announced - 1));
+
+				if (announced > 0)
+					continue;
+			}
+
+			parkingSpot->wait();
+		}
+	}
+}
@@ -0,0 +1,176 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:RealtimePool.h
+		
+		A fixed pool of worker threads, cooperating with the audio thread on jobs
+		through lock-free work-stealing deques. Workers take the scheduling priority of
+		the threads using the pool, spin while they're running jobs or parallel loops
+		in a block, and park on a semaphore once the block ends.
+		One pool is shared by every instance in the process.
+
+*************************************************************************************/
+
+#ifndef APE_REALTIMEPOOL_H
+	#define APE_REALTIMEPOOL_H
+
+	#include <atomic>
+	#include <cstddef>
+	#include <cstdint>
+	#include <memory>
+	#include <thread>
+	#include <vector>
+
+	namespace ape
+	{
+		class RealtimePool
+		{
+		public:
+
+			/// <summary>
+			/// Intrusive unit of work. The pool never owns or allocates jobs, so they must
+			/// outlive the run they're pushed in.
+			/// </summary>
+			struct Job
+			{
+				void (*execute)(Job& self, RealtimePool& pool);
+			};
+
+			typedef void (*LoopBody)(void* context, std::size_t begin, std::size_t end);
+
+			/// <summary>
+			/// Returns the process-wide pool, starting it if no instance holds it.
+			/// <paramref name="numWorkers"/> is only used when starting it, and a negative count
+			/// selects defaultWorkerCount(). Threads are joined when the last reference is released.
+			/// </summary>
+			static std::shared_ptr<RealtimePool> acquire(int numWorkers = -1);
+
+			/// <summary>
+			/// Spawns <paramref name="numWorkers"/> threads. Zero is valid, in which case everything
+			/// runs on the calling thread.
+			/// </summary>
+			RealtimePool(std::size_t numWorkers);
+			~RealtimePool();
+
+			RealtimePool(const RealtimePool&) = delete;
+			RealtimePool& operator = (const RealtimePool&) = delete;
+
+			/// <summary>
+			/// Pushes the roots, and helps executing jobs until <paramref name="remaining"/> reaches zero.
+			/// Jobs must not block on each other. If another thread is running jobs or a loop on the pool,
+			/// the jobs are all executed on the calling thread instead. Never allocates or locks.
+			/// </summary>
+			void run(Job* const* roots, std::size_t numRoots, const std::atomic<std::size_t>& remaining);
+
+			/// <summary>
+			/// Schedules a job from inside another job. If the job can't be queued, it's executed immediately.
+			/// </summary>
+			void push(Job& job);
+
+			/// <summary>
+			/// Calls <paramref name="body"/> on consecutive chunks of <paramref name="grain"/> indices, until
+			/// [0, <paramref name="count"/>) is covered, sharing the chunks between the calling thread and the workers.
+			/// Returns once every chunk has completed. The body must not throw.
+			/// If the pool is busy (for instance, when called from inside a job), the loop is run serially
+			/// on the calling thread instead. Never allocates or locks.
+			/// </summary>
+			void parallelFor(std::size_t count, std::size_t grain, LoopBody body, void* context);
+
+			/// <summary>
+			/// Tells the workers the calling thread is done with the pool for this audio block, so they park
+			/// instead of spinning for more work. Running jobs or a loop starts the next block. Never blocks.
+			/// </summary>
+			void endBlock() noexcept;
+
+			/// <summary>
+			/// Returns true if the calling thread is a worker of any pool.
+			/// </summary>
+			static bool isWorkerThread() noexcept;
+
+			std::size_t getNumWorkers() const noexcept { return workers.size(); }
+
+			/// <summary>
+			/// Suggested worker count for this system.
+			/// </summary>
+			static std::size_t defaultWorkerCount() noexcept;
+
+		private:
+
+			/// <summary>
+			/// Bounded Chase-Lev deque: the owner pushes and pops at the bottom, anyone steals from the top.
+			/// </summary>
+			class alignas(64) Deque
+			{
+			public:
+				static constexpr std::size_t capacity = 256;
+
+				Deque();
+
+				bool push(Job* job) noexcept;
+				Job* pop() noexcept;
+				Job* steal() noexcept;
+
+			private:
+				std::atomic<std::int64_t> top, bottom;
+				std::atomic<Job*> buffer[capacity];
+			};
+
+			struct Loop
+			{
+				LoopBody body;
+				void* context;
+				std::size_t count, grain, chunks;
+				std::atomic<std::size_t> next, activeHelpers;
+			};
+
+			static void executeHelper(Job& self, RealtimePool& pool);
+			void runChunks() noexcept;
+			bool executeOne(std::size_t self);
+			void workerLoop(std::size_t self);
+			void wakeWorkers() noexcept;
+			void publishScheduling() noexcept;
+
+			struct Semaphore;
+
+			// the last deque belongs to the thread calling run()
+			std::unique_ptr<Deque[]> deques;
+			std::size_t numDeques;
+			std::vector<std::thread> workers;
+
+			std::atomic<bool> running, quit;
+			// set by run() and parallelFor(), cleared by endBlock()
+			std::atomic<bool> inBlock;
+			// the highest scheduling priority of the threads using the pool, see publishScheduling()
+			std::atomic<std::uint64_t> scheduling;
+			// workers about to wait on the semaphore, see workerLoop()
+			std::atomic<std::size_t> parked;
+			std::unique_ptr<Semaphore> parkingSpot;
+			// unique for the process, unlike addresses of destroyed pools
+			const std::uint64_t serial;
+
+			// one preallocated helper per worker, for parallelFor()
+			std::unique_ptr<Job[]> helpers;
+			Loop loop;
+		};
+	}
+#endif
@@ -0,0 +1,133 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:ScopeTimeline.cpp
+		
+		Implementation of ScopeTimeline.h
+
+*************************************************************************************/
+
+#include "ScopeTimeline.h"
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+namespace ape
+{
+	namespace
+	{
+		// the counters of the ring are plain integers, as it's shared with C code using atomic builtins
+		static_assert(sizeof(std::atomic<std::size_t>) == sizeof(std::size_t), "Atomic counters must be layout compatible");
+		static_assert(std::atomic<std::size_t>::is_always_lock_free, "Atomic counters must be lock free");
+
+		std::atomic<std::size_t>& atomically(std::size_t& counter) noexcept
+		{
+			return reinterpret_cast<std::atomic<std::size_t>&>(counter);
+		}
+
+		std::atomic<std::size_t>& atomically(const std::size_t& counter) noexcept
+		{
+			return atomically(const_cast<std::size_t&>(counter));
+		}
+	}
+
+	ScopeTimeline::ScopeTimeline(std::size_t capacity)
+		: ring {}
+	{
+		std::size_t size = 2;
+
+		while (size < capacity)
+			size <<= 1;
+
+		events.resize(size);
+		ring.events = events.data();
+		ring.mask = size - 1;
+
+		open.reserve(64);
+	}
+
+	std::size_t ScopeTimeline::getDropped() const noexcept
+	{
+		return atomically(ring.dropped).load(std::memory_order_relaxed);
+	}
+
+	bool ScopeTimeline::drain()
+	{
+		const auto written = atomically(ring.written).load(std::memory_order_acquire);
+		bool completed = false;
+
+		// time stamps of different cores may be slightly out of sync
+		auto sinceOrigin = [this](unsigned long long stamp) -> std::uint64_t { return stamp > origin ? stamp - origin : 0; };
+
+		for (auto i = ring.read; i != written; ++i)
+		{
+			const auto& event = events[i & ring.mask];
+
+			if (event.name)
+			{
+				if (open.empty())
+				{
+					current.spans.clear();
+					origin = event.stamp;
+				}
+
+				const auto begin = sinceOrigin(event.stamp);
+
+				if (current.spans.size() < maxSpans)
+				{
+					open.push_back(current.spans.size());
+					current.spans.push_back({ event.name, open.size() - 1, begin, begin });
+				}
+				else
+				{
+					open.push_back(notRecorded);
+				}
+			}
+			else if (!open.empty())
+			{
+				const auto index = open.back();
+				open.pop_back();
+
+				if (index != notRecorded)
+				{
+					auto& span = current.spans[index];
+					span.end = std::max(span.begin, sinceOrigin(event.stamp));
+				}
+
+				if (open.empty())
+				{
+					std::swap(latest, current);
+					completed = true;
+
+					if (latest.length() > slowest.length())
+						slowest = latest;
+				}
+			}
+		}
+
+		// hands the events back to the script
+		atomically(ring.read).store(written, std::memory_order_release);
+
+		return completed;
+	}
+}
@@ -0,0 +1,120 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:ScopeTimeline.h
+		
+		Host side of the scopes a script profiles with APE_PROFILE_SCOPE() (see
+		APE_Project::profileScopes). Owns the ring the script writes timestamped
+		events into while processing, and assembles them into nested spans on
+		the thread reading them. The audio thread never allocates, locks or waits.
+
+*************************************************************************************/
+
+#ifndef APE_SCOPETIMELINE_H
+	#define APE_SCOPETIMELINE_H
+
+	#include <ape/SharedInterface.h>
+	#include <cstddef>
+	#include <cstdint>
+	#include <string>
+	#include <vector>
+
+	namespace ape
+	{
+		class ScopeTimeline
+		{
+		public:
+
+			struct Span
+			{
+				std::string name;
+				/// <summary>
+				/// Number of scopes this one is nested in, 0 for the top level scope.
+				/// </summary>
+				std::size_t depth;
+				/// <summary>
+				/// Processor ticks since the top level scope began.
+				/// </summary>
+				std::uint64_t begin, end;
+			};
+
+			struct Frame
+			{
+				/// <summary>
+				/// Spans in the order they began, so the first is the top level scope, normally the processed block.
+				/// </summary>
+				std::vector<Span> spans;
+
+				std::uint64_t length() const noexcept { return spans.empty() ? 0 : spans.front().end; }
+			};
+
+			/// <summary>
+			/// Spans beyond this in a single frame are left out, though their nesting is still kept track of.
+			/// </summary>
+			static constexpr std::size_t maxSpans = 4096;
+
+			/// <summary>
+			/// <paramref name="capacity"/> is the amount of events the ring can hold, rounded up to a power of two.
+			/// </summary>
+			explicit ScopeTimeline(std::size_t capacity = 1 << 14);
+
+			ScopeTimeline(const ScopeTimeline&) = delete;
+			ScopeTimeline& operator = (const ScopeTimeline&) = delete;
+
+			/// <summary>
+			/// The ring written by the script, see APE_SharedInterface::getProfileRing.
+			/// </summary>
+			APE_ProfileRing& getRing() noexcept { return ring; }
+
+			/// <summary>
+			/// Consumes the events written so far, completing frames as their top level scopes end.
+			/// Returns whether any frame was completed. Only to be called from a single thread.
+			/// </summary>
+			bool drain();
+
+			/// <summary>
+			/// The most recently completed frame, and the longest one since the last <see cref="resetSlowest()"/>.
+			/// </summary>
+			const Frame& getLatest() const noexcept { return latest; }
+			const Frame& getSlowest() const noexcept { return slowest; }
+			void resetSlowest() { slowest = {}; }
+
+			/// <summary>
+			/// Scopes left out because the ring was full. Thread safe.
+			/// </summary>
+			std::size_t getDropped() const noexcept;
+
+		private:
+
+			static constexpr std::size_t notRecorded = static_cast<std::size_t>(-1);
+
+			std::vector<APE_ProfileEvent> events;
+			APE_ProfileRing ring;
+
+			Frame latest, slowest, current;
+			std::uint64_t origin = 0;
+			// index of the span of every open scope in current, or notRecorded
+			std::vector<std::size_t> open;
+		};
+	}
+#endif
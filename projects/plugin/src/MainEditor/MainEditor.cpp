@@ -31,6 +31,8 @@
 #include "../UIController.h"
 #include "../UI/LabelQueue.h"
 #include <string>
+#include <chrono>
+#include <ctime>
 #include "../Engine.h"
 #include "../CConsole.h"
 #include "../PluginState.h"
@@ -83,6 +85,7 @@ namespace ape
 		tabs.addComponentToDock(scopeWindow.get());
 		tabs.addComponentToDock(scopeSettingsWindow.get());
 		tabs.addComponentToDock(codeWindow.get());
+		tabs.addComponentToDock(&timelineWindow);
 
 		addAndMakeVisible(activation);
 		addAndMakeVisible(compilation);
@@ -312,14 +315,44 @@ namespace ape
 			(int)profiler.smoothedClocksPerSample,
 			(int)profiler.clocksPerSample);
 
-		infoLabel->setText(buf);
+		std::string info = buf;
+
+		if (const auto latency = parent.engine.getLatencySnapshot(); latency.blocks > 0)
+		{
+			const auto worst = std::chrono::system_clock::to_time_t(latency.maxTime);
+			char time[16] = "";
+			std::strftime(time, sizeof(time), "%H:%M:%S", std::localtime(&worst));
+
+			sprintf_s(buf, " - deadline p50/p99/p99.9/max: %.0f/%.0f/%.0f/%.0f%% (worst at %s) - over %.0f%%: %llu, xruns: %llu",
+				latency.p50 * 100,
+				latency.p99 * 100,
+				latency.p999 * 100,
+				latency.max * 100,
+				time,
+				latency.threshold * 100,
+				(unsigned long long)latency.overThreshold,
+				(unsigned long long)latency.overDeadline);
+
+			info += buf;
+		}
+
+		infoLabel->setText(info);
 
 		if (pluginSurface)
 			pluginSurface->repaintActiveAreas();
 
+		timelineWindow.update(parent.currentPlugin ? parent.currentPlugin->getScopeTimeline() : nullptr);
+
 		parent.pulseUI();
 	}
 
+	void MainEditor::focusOfChildComponentChanged(FocusChangeType cause)
+	{
+		// lets compilations of this instance go first
+		if (hasKeyboardFocus(true))
+			parent.editorFocused();
+	}
+
 	void MainEditor::about()
 	{
 		static std::string sDialogMessage =
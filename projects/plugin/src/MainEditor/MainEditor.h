@@ -42,6 +42,7 @@
 	#include "../UI/PlayStateButton.h"
 	#include "../UI/StopButton.h"
 	#include "../UI/CleanButton.h"
+	#include "../UI/TimelineView.h"
 
 	namespace ape 
 	{
@@ -81,6 +82,8 @@
 
 		private:
 
+			void focusOfChildComponentChanged(FocusChangeType cause) override;
+
 			void serialize(cpl::CSerializer::Archiver & ar, cpl::Version version) override;
 			void deserialize(cpl::CSerializer::Builder & ar, cpl::Version version) override;
 
@@ -108,6 +111,8 @@
 				scopeWindow,
 				codeWindow;
 
+			TimelineView timelineWindow;
+
 			jcredland::DockableWindowManager dockManager;
 			jcredland::TabDock tabs;
 
@@ -73,6 +73,7 @@ namespace ape
 		, activating(false)
 		, triggerSetThroughAPI(false)
 		, pluginAllocator(64)
+		, scratchArena(pluginAllocator, engine.getScratchCapacity())
 	{
 		sharedObject = std::make_unique<SharedInterfaceEx>(engine, *this);
 		project->iface = sharedObject.get();
@@ -82,19 +83,39 @@ namespace ape
 
 		ProjectReleaser scopedRelease { project.get(), &generator };
 
-		if (!generator.compileProject(*project))
+		const auto status = generator.compileProject(*project);
+
+		if (status == Status::STATUS_MISS)
+			throw RestoreMissException("Compiled code to restore isn't available...");
+		else if (status != Status::STATUS_OK)
 			throw CompileException("Error compiling project...");
 
+		// exporting only produces a native module, there's nothing to run
+		if (project->exportPath)
+		{
+			scopedRelease.reset();
+			return;
+		}
+
 		if (!generator.initProject(*project))
 			throw InitException("Error initializing project...");
 
 		outputFiles.emplace_back(std::unique_ptr<PluginStreamProducer>());
 
+		if (project->currentLine)
+			lineProfiler = std::make_unique<LineProfiler>(processing, *project->currentLine);
+
+		if (project->profileScopes)
+			scopeTimeline = std::make_unique<ScopeTimeline>();
+
 		scopedRelease.reset();
 	}
 
 	PluginState::~PluginState() 
 	{
+		// the line register is freed with the project
+		lineProfiler = nullptr;
+
 		ProjectReleaser scopedRelease { project.get(), &generator };
 		if(enabled)
 			disableProject();
@@ -203,15 +224,10 @@ namespace ape
 		auto ret = WrapPluginCall("processReplacing()",
 			[&]
 			{
-				for (std::size_t i = 0; i < config.inputs; ++i)
+				if (in != nullptr)
 				{
-					pluginInputs[i] = protectedMemory[0].get<float>() + sampleFrames * i;
-					std::memcpy(pluginInputs[i], in[i], sampleFrames * sizeof(float));
-				}
-
-				for (std::size_t i = 0; i < config.outputs; ++i)
-				{
-					pluginOutputs[i] = protectedMemory[1].get<float>() + sampleFrames * i;
+					for (std::size_t i = 0; i < config.inputs; ++i)
+						std::memcpy(pluginInputs[i], in[i], sampleFrames * sizeof(float));
 				}
 
 				for (std::size_t i = 0; i < parameters.size(); ++i)
@@ -225,15 +241,19 @@ namespace ape
 				if (profiledCycles != nullptr)
 					*profiledCycles = cpl::Misc::ClockCounter() - start;
 
-				for (std::size_t i = 0; i < config.outputs; ++i)
+				if (out != nullptr)
 				{
-					std::memcpy(out[i], pluginOutputs[i], sampleFrames * sizeof(float));
+					for (std::size_t i = 0; i < config.outputs; ++i)
+						std::memcpy(out[i], pluginOutputs[i], sampleFrames * sizeof(float));
 				}
 
 				return result;
 			}
 		);
 
+		// scratch allocations only live for the duration of one block
+		scratchArena.reset();
+
 		// TODO: Needs to be here?
 		abnormalBehaviour = ret.first != STATUS_OK || ret.second;
 		processing.store(false, std::memory_order_release);
@@ -333,12 +353,22 @@ namespace ape
 		while (protectedMemory.size() < 2)
 			protectedMemory.emplace_back().setProtect(CMemoryGuard::protection::readwrite);
 
-		if (!protectedMemory[0].resize<float>(newSettings.inputs * newSettings.blockSize) || !protectedMemory[1].resize<float>(newSettings.outputs * newSettings.blockSize))
+		// channels are padded to whole cache lines, so every channel is aligned and at a fixed stride.
+		constexpr std::size_t alignmentInFloats = 64 / sizeof(float);
+		const std::size_t stride = ((newSettings.blockSize + alignmentInFloats - 1) / alignmentInFloats) * alignmentInFloats;
+
+		if (!protectedMemory[0].resize<float>(newSettings.inputs * stride) || !protectedMemory[1].resize<float>(newSettings.outputs * stride))
 			CPL_SYSTEM_EXCEPTION("Error allocating virtual protected memory for buffers");
 
 		pluginInputs.resize(newSettings.inputs);
 		pluginOutputs.resize(newSettings.outputs);
 
+		for (std::size_t i = 0; i < newSettings.inputs; ++i)
+			pluginInputs[i] = protectedMemory[0].get<float>() + stride * i;
+
+		for (std::size_t i = 0; i < newSettings.outputs; ++i)
+			pluginOutputs[i] = protectedMemory[1].get<float>() + stride * i;
+
 		config = newSettings;
 		
 		Event e;
@@ -417,6 +447,8 @@ namespace ape
 		parameters.clear();
 		widgets.clear();
 
+		// overflowing scratch blocks live in the plugin allocator
+		scratchArena.reset();
 		pluginAllocator.clear();
 	}
 
@@ -39,6 +39,7 @@
 	#include <vector>
 	#include <exception>
 	#include "CAllocator.h"
+	#include "ScratchArena.h"
 	#include <ape/Project.h>
 	#include <ape/Events.h>
 	#include <thread>
@@ -47,6 +48,8 @@
 	#include <cpl/gui/Tools.h>
 	#include "Settings.h"
 	#include "Engine/ParameterManager.h"
+	#include "Engine/LineProfiler.h"
+	#include "Engine/ScopeTimeline.h"
 	#include <memory>
 	#include <string>
 	#include <map>
@@ -79,6 +82,8 @@
 
 			DEFINE_EXCEPTION(AbortException);
 			DEFINE_EXCEPTION(CompileException);
+			// the compiled code to restore isn't available, see APE_Project::restoreArtifact
+			DEFINE_EXCEPTION(RestoreMissException);
 			DEFINE_EXCEPTION(InitException);
 			DEFINE_EXCEPTION(CreateException);
 			DEFINE_EXCEPTION(DisabledException);
@@ -91,6 +96,7 @@
 
 			SharedInterfaceEx& getSharedInterface();
 			CAllocator& getPluginAllocator() noexcept { return pluginAllocator; }
+			ScratchArena& getScratchArena() noexcept { return scratchArena; }
 			auto& getPluginAudioFiles() { return audioFiles; }
 			auto& getPluginFFTs() { return ffts; }
 			auto& getOriginalFiles() noexcept { return originalSampleRateFiles; }
@@ -106,7 +112,18 @@
 			bool initializeActivation();
 			bool finalizeActivation();
 			bool disableProject();
+			/// <summary>
+			/// Processes a block through the plugin's own guarded buffers. If <paramref name="in"/> is null,
+			/// the input is expected to be written into getInputBuffers() already; if <paramref name="out"/>
+			/// is null, the result is left in getOutputBuffers() instead of being copied out.
+			/// </summary>
 			bool processReplacing(const float * const * in, float * const * out, std::size_t sampleFrames, std::size_t * profiledCycles = nullptr) noexcept;
+			/// <summary>
+			/// 64-byte aligned channels, padded to the block size given in setConfig().
+			/// Stable until the next setConfig() call.
+			/// </summary>
+			float * const * getInputBuffers() const noexcept { return pluginInputs.data(); }
+			float * const * getOutputBuffers() const noexcept { return pluginOutputs.data(); }
 			bool isProcessing() const noexcept { return processing.load(std::memory_order_acquire); }
 			bool isDisabling() const noexcept { return currentlyDisabling.load(std::memory_order_acquire); }
 			bool isAborting() const noexcept { return currentlyAborting.load(std::memory_order_acquire); }
@@ -119,6 +136,15 @@
 			void syncParametersToEngine(bool takeEngineValues);
 
 			PluginCommandQueue* getCommandQueue() noexcept { return commandQueue.get(); }
+			/// <summary>
+			/// Samples the lines of the plugin while processing, if it was compiled to profile lines. Null otherwise.
+			/// </summary>
+			const LineProfiler* getLineProfiler() const noexcept { return lineProfiler.get(); }
+			/// <summary>
+			/// The scopes recorded by the plugin while processing, if it was compiled to profile scopes. Null otherwise.
+			/// Only one thread may drain it.
+			/// </summary>
+			ScopeTimeline* getScopeTimeline() noexcept { return scopeTimeline.get(); }
 			std::shared_ptr<PluginSurface> getOrCreateSurface();
 
 		private:
@@ -149,10 +175,13 @@
 			CCodeGenerator& generator;
 			Engine& engine;
 			CAllocator pluginAllocator;
+			ScratchArena scratchArena;
 			std::vector<CMemoryGuard> protectedMemory;
 			std::vector<float*> pluginInputs, pluginOutputs;
 			std::unique_ptr<ProjectEx> project;
 			std::weak_ptr<PluginSurface> surface;
+			std::unique_ptr<LineProfiler> lineProfiler;
+			std::unique_ptr<ScopeTimeline> scopeTimeline;
 
 			bool
 				playing,
@@ -53,6 +53,14 @@ namespace ape
 			delete[] arguments;
 		if (traceLines)
 			delete[] traceLines;
+		if (restoreArtifact)
+			delete[] restoreArtifact;
+		if (exportPath)
+			delete[] exportPath;
+		if (profileDirectory)
+			delete[] profileDirectory;
+		if (staticConfig)
+			delete staticConfig;
 
 
 		if (nFiles && files)
@@ -0,0 +1,201 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:ScratchArena.cpp
+		
+		Implementation of ScratchArena.h
+
+*************************************************************************************/
+
+#include "ScratchArena.h"
+#include "CAllocator.h"
+#include <cpl/Misc.h>
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace ape
+{
+	ScratchArena::ScratchArena(CAllocator& overflowAllocator, std::size_t initialCapacity)
+		: overflow(overflowAllocator)
+		, current(createRegion(initialCapacity))
+		, used(0)
+		, pending(nullptr)
+		, retired(nullptr)
+		, wanted(0)
+		, numOverflows(0)
+	{
+		if (!current.load())
+			throw std::bad_alloc();
+
+		for (auto& slot : overflows)
+			slot.store(nullptr, std::memory_order_relaxed);
+	}
+
+	ScratchArena::~ScratchArena()
+	{
+		// overflow blocks are released along with their allocator
+		destroyRegion(current.load());
+		destroyRegion(pending.load());
+		destroyRegion(retired.load());
+	}
+
+	ScratchArena::region * ScratchArena::createRegion(std::size_t capacity)
+	{
+		capacity = (capacity + granularity - 1) / granularity * granularity;
+
+		auto memory = cpl::Misc::alignedMalloc<std::byte, granularity>(sizeof(region) + capacity);
+
+		if (!memory)
+			return nullptr;
+
+		auto r = new (memory) region();
+		r->capacity = capacity;
+
+		return r;
+	}
+
+	void ScratchArena::destroyRegion(region * r) noexcept
+	{
+		if (!r)
+			return;
+
+		r->~region();
+		cpl::Misc::alignedFree(r);
+	}
+
+	void * ScratchArena::alloc(std::size_t size, std::size_t align)
+	{
+		// offsets are kept at multiples of the granularity, so only larger alignments need slack.
+		auto const needed = std::max<std::size_t>(1, (size + granularity - 1) / granularity) * granularity
+			+ (align > granularity ? align - granularity : 0);
+
+		auto r = current.load(std::memory_order_acquire);
+		auto const offset = used.fetch_add(needed, std::memory_order_relaxed);
+
+		if (offset + needed <= r->capacity)
+		{
+			auto address = reinterpret_cast<std::uintptr_t>(r->data() + offset);
+
+			if (align > granularity)
+				address = (address + align - 1) & ~std::uintptr_t(align - 1);
+
+			return reinterpret_cast<void *>(address);
+		}
+
+		// the region is used up for this block. reset() sees the shortfall in the used count.
+		auto const slot = numOverflows.fetch_add(1, std::memory_order_relaxed);
+
+		if (slot >= max_overflows)
+			return nullptr;
+
+		auto block = overflow.alloc(APE_Alloc_Temp, size, align);
+		overflows[slot].store(block, std::memory_order_release);
+
+		return block;
+	}
+
+	bool ScratchArena::owns(const void * p) const noexcept
+	{
+		auto address = static_cast<const std::byte *>(p);
+		auto r = current.load(std::memory_order_acquire);
+
+		if (address >= r->data() && address < r->data() + r->capacity)
+			return true;
+
+		auto const count = std::min(numOverflows.load(std::memory_order_acquire), max_overflows);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (overflows[i].load(std::memory_order_acquire) == p)
+				return true;
+		}
+
+		return false;
+	}
+
+	void ScratchArena::reset() noexcept
+	{
+		auto const count = std::min(numOverflows.load(std::memory_order_relaxed), max_overflows);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (auto block = overflows[i].exchange(nullptr, std::memory_order_relaxed))
+			{
+				// a corrupted scratch block was never the script's to free, so it's left to the allocator's clear()
+				try
+				{
+					overflow.free(block);
+				}
+				catch (...)
+				{
+				}
+			}
+		}
+
+		numOverflows.store(0, std::memory_order_relaxed);
+
+		auto r = current.load(std::memory_order_relaxed);
+		auto const demand = used.exchange(0, std::memory_order_relaxed);
+
+		if (demand > r->capacity)
+		{
+			auto previous = wanted.load(std::memory_order_relaxed);
+			while (previous < demand && !wanted.compare_exchange_weak(previous, demand, std::memory_order_relaxed));
+		}
+
+		// only grow() empties the retired slot, so a region is only swapped in once it has released the last one
+		if (retired.load(std::memory_order_acquire))
+			return;
+
+		if (auto next = pending.exchange(nullptr, std::memory_order_acquire))
+		{
+			current.store(next, std::memory_order_release);
+			retired.store(r, std::memory_order_release);
+		}
+	}
+
+	void ScratchArena::grow()
+	{
+		destroyRegion(retired.exchange(nullptr, std::memory_order_acquire));
+
+		if (pending.load(std::memory_order_acquire))
+			return;
+
+		// the current region is only ever released by this function, so it stays valid here
+		auto const capacity = current.load(std::memory_order_acquire)->capacity;
+		auto const target = wanted.load(std::memory_order_relaxed);
+
+		if (target <= capacity)
+			return;
+
+		// with some headroom, so a slowly rising demand doesn't regrow it every time
+		if (auto r = createRegion(std::max(target + target / 2, capacity * 2)))
+			pending.store(r, std::memory_order_release);
+	}
+
+	std::size_t ScratchArena::getCapacity() const noexcept
+	{
+		return current.load(std::memory_order_acquire)->capacity;
+	}
+};
@@ -0,0 +1,108 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:ScratchArena.h
+		
+		A bump-pointer arena for short-lived allocations (APE_Alloc_Temp), that is reset
+		in one go after every processed block.
+
+*************************************************************************************/
+
+#ifndef APE_SCRATCHARENA_H
+	#define APE_SCRATCHARENA_H
+
+	#include <cstddef>
+	#include <atomic>
+
+	namespace ape
+	{
+		class CAllocator;
+
+		/// <summary>
+		/// Allocations are lock-free pointer bumps in one contiguous region, and individual frees are no-ops.
+		/// Blocks needing more than the region holds take the rest from an overflow allocator, while a larger
+		/// region is prepared off the audio thread by grow() and swapped in by a later reset().
+		/// Once sized to the high-water mark of a block, no locks or system calls happen.
+		/// </summary>
+		class ScratchArena
+		{
+		public:
+
+			ScratchArena(CAllocator& overflow, std::size_t initialCapacity = 1 << 16);
+			ScratchArena(const ScratchArena&) = delete;
+			ScratchArena& operator = (const ScratchArena&) = delete;
+			~ScratchArena();
+
+			/// <summary>
+			/// Returns uninitialized memory, valid until the next reset(), or null if the block has used up
+			/// both the region and the overflow allocations. Safe to call concurrently with itself and owns().
+			/// </summary>
+			void * alloc(std::size_t size, std::size_t align);
+			/// <summary>
+			/// Whether <paramref name="block"/> was handed out by this arena since the last reset().
+			/// A range check, unless the block overflowed the region.
+			/// </summary>
+			bool owns(const void * block) const noexcept;
+			/// <summary>
+			/// Invalidates every allocation, and swaps in a region prepared by grow(). Must not race with alloc().
+			/// </summary>
+			void reset() noexcept;
+			/// <summary>
+			/// Prepares a larger region if a block has overflowed the current one, and releases the region it replaced.
+			/// Meant for a thread other than the one using the arena, and may run concurrently with everything but itself.
+			/// </summary>
+			void grow();
+
+			std::size_t getCapacity() const noexcept;
+
+		private:
+
+			static constexpr std::size_t granularity = 64;
+			static constexpr std::size_t max_overflows = 64;
+
+			struct alignas(granularity) region
+			{
+				std::size_t capacity;
+
+				std::byte * data() noexcept { return reinterpret_cast<std::byte *>(this + 1); }
+				const std::byte * data() const noexcept { return reinterpret_cast<const std::byte *>(this + 1); }
+			};
+
+			static region * createRegion(std::size_t capacity);
+			static void destroyRegion(region * r) noexcept;
+
+			CAllocator& overflow;
+			std::atomic<region *> current;
+			// keeps counting past the capacity, so after a block it holds everything the block asked for
+			std::atomic<std::size_t> used;
+			// prepared by grow(), swapped in by reset()
+			std::atomic<region *> pending;
+			// replaced by reset(), released by grow()
+			std::atomic<region *> retired;
+			// the most any block has asked for
+			std::atomic<std::size_t> wanted;
+			std::atomic<std::size_t> numOverflows;
+			std::atomic<void *> overflows[max_overflows];
+		};
+	};
+#endif
@@ -75,6 +75,8 @@
 				APE_BIND(writeAudioFile);
 				APE_BIND(closeAudioFile);
                 APE_BIND(getPlayHeadPosition);
+				APE_BIND(parallelFor);
+				APE_BIND(getProfileRing);
 #undef APE_BIND
 			}
 		};
@@ -0,0 +1,167 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:TimelineView.cpp
+		
+		Implementation of TimelineView.h
+
+*************************************************************************************/
+
+#include "TimelineView.h"
+#include <cpl/system/SysStats.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+
+namespace ape
+{
+	namespace
+	{
+		constexpr int titleHeight = 20;
+		constexpr int rowHeight = 18;
+	}
+
+	TimelineView::TimelineView()
+		: dropped(0)
+		, profiling(false)
+		, resetSlowest(false)
+	{
+		setName("Timeline");
+		setOpaque(true);
+	}
+
+	void TimelineView::update(ScopeTimeline* timeline)
+	{
+		if (!timeline)
+		{
+			if (profiling)
+			{
+				profiling = false;
+				latest = {};
+				slowest = {};
+				repaint();
+			}
+
+			return;
+		}
+
+		if (!profiling)
+		{
+			profiling = true;
+			repaint();
+		}
+
+		if (resetSlowest)
+		{
+			timeline->resetSlowest();
+			resetSlowest = false;
+		}
+
+		const bool changed = timeline->drain() || timeline->getDropped() != dropped;
+
+		if (!changed || !isShowing())
+			return;
+
+		latest = timeline->getLatest();
+		slowest = timeline->getSlowest();
+		dropped = timeline->getDropped();
+
+		repaint();
+	}
+
+	void TimelineView::mouseDoubleClick(const juce::MouseEvent& e)
+	{
+		resetSlowest = true;
+		slowest = {};
+		repaint();
+	}
+
+	void TimelineView::paint(juce::Graphics& g)
+	{
+		g.fillAll(juce::Colours::black);
+		g.setFont(13.0f);
+
+		if (!profiling)
+		{
+			g.setColour(CColours::lightgoldenrodyellow);
+			g.drawText("Enable Build > Profile scopes and recompile to time the APE_PROFILE_SCOPE()s of the script.", getLocalBounds(), juce::Justification::centred, true);
+			return;
+		}
+
+		auto bounds = getLocalBounds().reduced(5);
+		auto top = bounds.removeFromTop(bounds.getHeight() / 2);
+
+		paintFrame(g, top, "Latest block", latest);
+		paintFrame(g, bounds, "Slowest block" + (dropped ? juce::String(" - scopes dropped: ") + juce::String((juce::int64)dropped) : juce::String()), slowest);
+	}
+
+	void TimelineView::paintFrame(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& title, const ScopeTimeline::Frame& frame)
+	{
+		const auto ticksPerMicrosecond = cpl::system::CProcessor::getMHz();
+		const auto length = frame.length();
+
+		auto toMicroseconds = [&](std::uint64_t ticks) { return ticksPerMicrosecond > 0 ? ticks / ticksPerMicrosecond : 0.0; };
+
+		g.setColour(CColours::lightgoldenrodyellow);
+		g.drawText(
+			length ? title + juce::String::formatted(": %.1f us", toMicroseconds(length)) : title + ": nothing recorded yet",
+			area.removeFromTop(titleHeight),
+			juce::Justification::centredLeft,
+			true
+		);
+
+		if (!length)
+			return;
+
+		const double scale = area.getWidth() / static_cast<double>(length);
+
+		for (auto& span : frame.spans)
+		{
+			const auto y = area.getY() + static_cast<int>(span.depth) * rowHeight;
+
+			if (y + rowHeight > area.getBottom())
+				continue;
+
+			const auto x = area.getX() + static_cast<int>(span.begin * scale);
+			const auto width = std::max(1, static_cast<int>((span.end - span.begin) * scale));
+			const juce::Rectangle<int> bar(x, y, width, rowHeight - 1);
+
+			// the same scope keeps its colour between frames
+			const auto hue = (std::hash<std::string>()(span.name) % 360) / 360.0f;
+
+			g.setColour(juce::Colour::fromHSV(hue, 0.55f, 0.75f, 1.0f));
+			g.fillRect(bar);
+
+			if (width > 30)
+			{
+				g.setColour(juce::Colours::black);
+				g.drawText(
+					juce::String(span.name) + juce::String::formatted(" (%.1f us)", toMicroseconds(span.end - span.begin)),
+					bar.reduced(3, 0),
+					juce::Justification::centredLeft,
+					true
+				);
+			}
+		}
+	}
+}
@@ -0,0 +1,65 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:TimelineView.h
+		
+		Dockable view of the scopes recorded by the running plugin (see
+		ScopeTimeline.h), drawn as nested bars for the latest and the slowest block.
+		Double click to forget the slowest block.
+
+*************************************************************************************/
+
+#ifndef APE_TIMELINEVIEW_H
+	#define APE_TIMELINEVIEW_H
+
+	#include "../GraphicComponents.h"
+	#include "../Engine/ScopeTimeline.h"
+	#include <cstddef>
+
+	namespace ape
+	{
+		class TimelineView : public juce::Component
+		{
+		public:
+
+			TimelineView();
+
+			/// <summary>
+			/// Drains <paramref name="timeline"/> (null if the plugin doesn't profile scopes) and repaints if
+			/// anything changed. Call periodically from the message thread.
+			/// </summary>
+			void update(ScopeTimeline* timeline);
+
+			void paint(juce::Graphics& g) override;
+			void mouseDoubleClick(const juce::MouseEvent& e) override;
+
+		private:
+
+			void paintFrame(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& title, const ScopeTimeline::Frame& frame);
+
+			ScopeTimeline::Frame latest, slowest;
+			std::size_t dropped;
+			bool profiling, resetSlowest;
+		};
+	};
+#endif
@@ -38,20 +38,131 @@
 #include <chrono>
 #include "CodeEditor/SourceManager.h"
 #include <typeinfo>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include "MainEditor/MainEditor.h"
 #include "CodeEditor/AutosaveManager.h"
 #include "UI/UICommands.h"
 #include <cpl/simd.h>
+#include "CompileService.h"
+#include <cpl/filesystem.h>
+#include <system_error>
+#include <fstream>
+#include <iterator>
+#include "Engine/GraphDescription.h"
+#include "CompilerBinding.h"
 
 namespace ape 
 {
 	using namespace std::string_literals;
 
+	namespace
+	{
+		// copies what the source manager fills in, so the same source can be compiled again
+		std::unique_ptr<ProjectEx> copyProject(const ProjectEx& original)
+		{
+			auto copyCStr = [](const char* string) -> const char*
+			{
+				if (!string)
+					return nullptr;
+
+				const auto length = std::strlen(string);
+				auto pointer = new char[length + 1];
+				std::copy(string, string + length + 1, pointer);
+				return pointer;
+			};
+
+			auto project = std::make_unique<ProjectEx>();
+
+			project->isSingleString = original.isSingleString;
+			project->uniqueID = original.uniqueID;
+			project->sourceString = copyCStr(original.sourceString);
+			project->projectName = copyCStr(original.projectName);
+			project->workingDirectory = copyCStr(original.workingDirectory);
+			project->rootPath = copyCStr(original.rootPath);
+			project->languageID = copyCStr(original.languageID);
+
+			if (original.files)
+			{
+				auto files = new char *[original.nFiles];
+
+				for (unsigned i = 0; i < original.nFiles; ++i)
+					files[i] = const_cast<char*>(copyCStr(original.files[i]));
+
+				project->files = files;
+				project->nFiles = original.nFiles;
+			}
+
+			if (original.traceLines)
+			{
+				auto lines = new int[original.numTraceLines];
+				std::copy(original.traceLines, original.traceLines + original.numTraceLines, lines);
+				project->traceLines = lines;
+				project->numTraceLines = original.numTraceLines;
+			}
+
+			project->state = CodeState::None;
+
+			return project;
+		}
+
+		// like SourceManager::createProject(), for scripts that aren't open in the editor
+		std::unique_ptr<ProjectEx> projectFromFile(const cpl::fs::path& script)
+		{
+			std::ifstream stream(script.string(), std::ios::binary);
+			const std::string source{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+
+			if (!stream || source.empty())
+				return nullptr;
+
+			auto copyCStr = [](const std::string& string)
+			{
+				auto pointer = new char[string.size() + 1];
+				std::copy(string.c_str(), string.c_str() + string.size() + 1, pointer);
+				return pointer;
+			};
+
+			auto extension = script.extension().string();
+
+			if (!extension.empty())
+				extension.erase(0, 1);
+
+			auto project = std::make_unique<ProjectEx>();
+
+			project->isSingleString = true;
+			project->uniqueID = (unsigned)-1;
+			project->files = new char *[1]{ copyCStr(script.string()) };
+			project->nFiles = 1;
+			project->sourceString = copyCStr(source);
+			project->projectName = copyCStr(script.stem().string());
+			project->workingDirectory = copyCStr(script.parent_path().string());
+			project->rootPath = copyCStr(cpl::Misc::DirectoryPath());
+			project->languageID = copyCStr(extension);
+			project->state = CodeState::None;
+
+			return project;
+		}
+
+		bool isSpecialisedFor(const PluginState& plugin, const IOConfig& config)
+		{
+			auto staticConfig = plugin.getProject().staticConfig;
+
+			return staticConfig && 
+				staticConfig->inputs == config.inputs && 
+				staticConfig->outputs == config.outputs && 
+				staticConfig->blockSize == config.blockSize && 
+				staticConfig->sampleRate == config.sampleRate;
+		}
+	}
+
 	UIController::UIController(ape::Engine& effect)
 		: projectName(cpl::programInfo.programAbbr)
 		, engine(effect)
 		, console(std::make_unique<CConsole>())
         , currentOptions(EngineCommand::None)
+		, compiledOptions(EngineCommand::None)
 	{
 
 		editorSSO = std::make_unique<cpl::SerializableStateObject<MainEditor>>(
@@ -74,6 +185,7 @@ namespace ape
 
 		sourceManager = MakeSourceManager(*this, effect.getSettings(), effect.uniqueInstanceID());
 		autosaveManager = std::make_unique<AutosaveManager>(effect.uniqueInstanceID(), effect.getSettings(), *sourceManager, *this);
+		compileService = CompileService::acquire(effect.getSettings().lookUpValue(-1, "application", "compile_threads"));
 		
 		labelQueue.setDefaultMessage("Ready", juce::Colours::lightgoldenrodyellow);
 	}
@@ -111,6 +223,49 @@ namespace ape
 
 	}
 
+	bool UIController::optimizationRemark(const APE_Project& project, const cpl::string_ref text)
+	{
+		// clang layout: "<file>:<line>:<column>: remark: <message> [-Rpass<-kind>=<pass>]"
+		const std::string message = text.c_str();
+		const auto separator = message.find(": remark: ");
+
+		if (separator == std::string::npos)
+			return false;
+
+		const std::string location = message.substr(0, separator);
+		const auto column = location.rfind(':');
+		const auto line = column != std::string::npos ? location.rfind(':', column - 1) : std::string::npos;
+
+		// remarks about headers and the runtime are of no use in the editor
+		if (line == std::string::npos || !project.projectName || location.substr(0, line) != project.projectName)
+			return true;
+
+		OptimizationRemark remark;
+		remark.line = std::atoi(location.c_str() + line + 1) - 1;
+		remark.message = message.substr(separator + std::strlen(": remark: "));
+		remark.kind = OptimizationRemark::Passed;
+
+		if (auto option = remark.message.rfind(" [-Rpass"); option != std::string::npos)
+		{
+			if (remark.message.compare(option, 15, " [-Rpass-missed") == 0)
+				remark.kind = OptimizationRemark::Missed;
+			else if (remark.message.compare(option, 17, " [-Rpass-analysis") == 0)
+				remark.kind = OptimizationRemark::Analysis;
+
+			remark.message.erase(option);
+		}
+
+		while (!remark.message.empty() && std::isspace(static_cast<unsigned char>(remark.message.back())))
+			remark.message.pop_back();
+
+		if (remark.line < 0)
+			return true;
+
+		cpl::GUIUtils::MainEvent(*this, [this, remark] { sourceManager->addOptimizationRemark(remark); });
+
+		return true;
+	}
+
 	void UIController::setPlugin(std::shared_ptr<PluginState> newPlugin, EngineCommand::TransientPluginOptions options)
 	{
 		if (currentPlugin)
@@ -127,10 +282,39 @@ namespace ape
 	{
 		engine.pulse();
 		labelQueue.pulseQueue();
+		pulseOptimizer();
+		pulseSpecialiser();
+		pulseLineProfile();
+		pulseProfileGuided();
 	}
 
 	UIController::~UIController()
 	{
+		// pooled compilations refer to this instance, and their futures don't wait on destruction
+		compileService->releaseFocus(this);
+		compileService->cancel(this);
+
+		if (compilerState.valid())
+			compilerState.wait();
+
+		if (optimizerState.valid())
+			optimizerState.wait();
+
+		if (specialiserState.valid())
+			specialiserState.wait();
+
+		if (exportState.valid())
+			exportState.wait();
+
+		if (profileState.valid())
+			profileState.wait();
+
+		if (!profileDirectory.empty())
+		{
+			std::error_code ec;
+			cpl::fs::remove_all(profileDirectory, ec);
+		}
+
 		notifyDestruction();
 		autosaveManager = nullptr;
 		sourceManager = nullptr;
@@ -144,11 +328,18 @@ namespace ape
 		}
 
 		autosaveManager->checkAutosave();
+		editorFocused();
 	}
 
 
 	void UIController::editorClosed()
 	{
+		compileService->releaseFocus(this);
+	}
+
+	void UIController::editorFocused()
+	{
+		compileService->setFocus(this);
 	}
 
 	MainEditor * UIController::create()
@@ -192,7 +383,8 @@ namespace ape
 				switch (compilerState.wait_for(std::chrono::seconds(0)))
 				{
 				case std::future_status::ready:
-					setPlugin(compilerState.get());
+					setPlugin(compilerState.get(), compiledOptions);
+					compiledOptions = EngineCommand::None;
 					break;
 				case std::future_status::deferred:
 				case std::future_status::timeout:
@@ -209,6 +401,8 @@ namespace ape
 
 		case UICommand::Deactivate:
 		{
+			clearGraph();
+
 			if (currentPlugin && currentPlugin->isEnabled())
 			{
 				labelQueue.pushMessage("Plugin disabled", CColours::lightgoldenrodyellow, 1000);
@@ -225,6 +419,8 @@ namespace ape
 		case UICommand::Clean:
 		{
 			engine.getCodeGenerator().cleanAllCaches();
+			// a clean slate for measuring, too
+			engine.resetLatencyStatistics();
 		}
 
 		default:
@@ -401,9 +597,24 @@ namespace ape
 
 	void UIController::recompile(bool hotReload)
 	{
+		// the code editor may live in its own window, but whoever compiles is looking at this instance
+		editorFocused();
+
+		auto createTiered = [this](bool hotReload)
+		{
+			auto project = sourceManager->createProject();
+			std::unique_ptr<ProjectEx> optimizedProject;
+
+			// both projects are created now, so they're guaranteed to have the same source
+			if (project && engine.getSettings().lookUpValue(false, "application", "tiered_compilation"))
+				optimizedProject = sourceManager->createProject();
+
+			return createPlugin(std::move(project), hotReload, std::move(optimizedProject));
+		};
+
 		if (!compilerState.valid())
 		{
-			compilerState = createPlugin(sourceManager->createProject(), hotReload);
+			compilerState = createTiered(hotReload);
 			//engine.disablePlugin(false);
 		}
 		else
@@ -411,7 +622,7 @@ namespace ape
 			switch (compilerState.wait_for(std::chrono::seconds(0)))
 			{
 			case std::future_status::ready:
-				compilerState = createPlugin(sourceManager->createProject(), hotReload);
+				compilerState = createTiered(hotReload);
 				//engine.disablePlugin(false);
 				break;
 			case std::future_status::deferred:
@@ -434,8 +645,270 @@ namespace ape
 		return projectName;
 	}
 
+	const ProjectEx* UIController::getCurrentProject() const noexcept
+	{
+		return currentPlugin ? &currentPlugin->getProject() : nullptr;
+	}
 
-	std::future<std::unique_ptr<PluginState>> UIController::createPlugin(std::unique_ptr<ProjectEx> project, bool enableHotReload)
+	void UIController::exportProject(const std::string& destination)
+	{
+		if (exportState.valid() && exportState.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			getConsole().printLine(CConsole::Error, "[GUI] : Already exporting, wait for it to finish.");
+			return;
+		}
+
+		auto project = sourceManager->createProject();
+
+		if (!project)
+		{
+			getConsole().printLine(CConsole::Error, "[GUI] : Export error - invalid project or no text recieved from editor.");
+			return;
+		}
+
+		setupProject(*project, APE_Optimization_Best);
+
+		// breakpoints are for debugging in the editor, not for exported code
+		if (project->traceLines)
+			delete[] project->traceLines;
+
+		project->traceLines = nullptr;
+		project->numTraceLines = 0;
+		project->profileLines = 0;
+		project->profileScopes = 0;
+
+		auto path = new char[destination.size() + 1];
+		std::copy(destination.begin(), destination.end(), path);
+		path[destination.size()] = '\0';
+		project->exportPath = path;
+
+		getConsole().printLine("[GUI] : Exporting to %s...", destination.c_str());
+
+		exportState = compileService->submit(
+			this,
+			CompileService::Priority::Normal,
+			[this, destination, projectToExport = std::move(project)] () mutable
+			{
+				try
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+					PluginState exported(engine, engine.getCodeGenerator(), std::move(projectToExport));
+					auto delta = std::chrono::high_resolution_clock::now() - start;
+					auto time = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(delta);
+
+					getConsole().printLine("[GUI] : Exported %s successfully (%f ms).", destination.c_str(), time.count());
+					labelQueue.pushMessage("Exported OK!", CColours::green, 2000);
+				}
+				catch (const std::exception& e)
+				{
+					getConsole().printLine(CConsole::Error, "[GUI] : Error exporting project (%s: %s).", cpl::Misc::DemangledTypeName(e).c_str(), e.what());
+					labelQueue.pushMessage("Error while exporting (see console)!", CColours::red, 5000);
+				}
+			}
+		);
+	}
+
+	void UIController::loadGraph(const std::string& path)
+	{
+		std::unique_ptr<GraphDescription> description;
+
+		try
+		{
+			auto extension = cpl::fs::path(path).extension().string();
+
+			if (!extension.empty())
+				extension.erase(0, 1);
+
+			// an exported module runs on its own, as a graph of one node
+			if (CompilerBinding::isPrebuiltModule(extension))
+			{
+				description = std::make_unique<GraphDescription>(GraphDescription::Single("module", path));
+			}
+			else
+			{
+				description = std::make_unique<GraphDescription>(GraphDescription::FromFile(path));
+			}
+		}
+		catch (const std::exception& e)
+		{
+			getConsole().printLine(CConsole::Error, "[GUI] : Error reading graph (%s).", e.what());
+			labelQueue.pushMessage("Error loading graph (see console)!", CColours::red, 5000);
+			return;
+		}
+
+		const auto directory = cpl::fs::path(path).parent_path();
+		std::vector<std::unique_ptr<ProjectEx>> projects;
+
+		for (auto& node : description->getNodes())
+		{
+			auto script = cpl::fs::path(node.script);
+
+			if (script.is_relative())
+				script = directory / script;
+
+			auto project = projectFromFile(script);
+
+			if (!project)
+			{
+				getConsole().printLine(CConsole::Error, "[GUI] : Unable to read script %s of graph node \"%s\".", script.string().c_str(), node.name.c_str());
+				labelQueue.pushMessage("Error loading graph (see console)!", CColours::red, 5000);
+				return;
+			}
+
+			setupTarget(*project, APE_Optimization_Best);
+			projects.emplace_back(std::move(project));
+		}
+
+		graphPath = path;
+		const auto generation = ++graphGeneration;
+
+		getConsole().printLine("[GUI] : Compiling %zu scripts of graph %s...", projects.size(), path.c_str());
+
+		graphState = compileService->submit(
+			this,
+			CompileService::Priority::Normal,
+			[this, generation, graph = std::shared_ptr<GraphDescription>(std::move(description)), projectsToCompile = std::move(projects)] () mutable
+			{
+				std::vector<std::shared_ptr<PluginState>> plugins;
+
+				try
+				{
+					for (auto& project : projectsToCompile)
+						plugins.emplace_back(std::make_shared<PluginState>(engine, engine.getCodeGenerator(), std::move(project)));
+				}
+				catch (const std::exception& e)
+				{
+					getConsole().printLine(CConsole::Error, "[GUI] : Error compiling graph (%s: %s).", cpl::Misc::DemangledTypeName(e).c_str(), e.what());
+					labelQueue.pushMessage("Error compiling graph (see console)!", CColours::red, 5000);
+					return;
+				}
+
+				cpl::GUIUtils::MainEvent(*this,
+					[this, generation, graph, plugins]
+					{
+						// removed or loaded again meanwhile
+						if (generation == graphGeneration)
+							installGraph(*graph, plugins);
+					}
+				);
+			}
+		);
+	}
+
+	void UIController::installGraph(const GraphDescription& description, const std::vector<std::shared_ptr<PluginState>>& plugins)
+	{
+		auto graph = std::make_shared<ProcessingGraph>();
+
+		for (auto& plugin : plugins)
+		{
+			if (!plugin->initializeActivation())
+			{
+				getConsole().printLine(CConsole::Error, "[GUI] : Error activating script %s of graph.", plugin->getProject().projectName);
+				labelQueue.pushMessage("Error activating graph (see console)!", CColours::red, 5000);
+				return;
+			}
+
+			if (engine.getPlayState())
+			{
+				plugin->setConfig(engine.getConfig());
+				plugin->setPlayState(true);
+			}
+
+			if (!plugin->finalizeActivation())
+			{
+				getConsole().printLine(CConsole::Error, "[GUI] : Error activating script %s of graph.", plugin->getProject().projectName);
+				labelQueue.pushMessage("Error activating graph (see console)!", CColours::red, 5000);
+				return;
+			}
+
+			graph->add(engine.createGraphNode(plugin));
+		}
+
+		for (auto& connection : description.getConnections())
+			graph->connect(connection.from, connection.to);
+
+		try
+		{
+			engine.exchangeGraph(std::move(graph));
+		}
+		catch (const std::exception& e)
+		{
+			getConsole().printLine(CConsole::Error, "[GUI] : Error running graph (%s).", e.what());
+			labelQueue.pushMessage("Error running graph (see console)!", CColours::red, 5000);
+			return;
+		}
+
+		getConsole().printLine("[GUI] : Processing graph of %zu scripts.", plugins.size());
+		labelQueue.pushMessage("Graph running", CColours::green, 2000);
+	}
+
+	void UIController::clearGraph()
+	{
+		if (graphPath.empty())
+			return;
+
+		graphPath.clear();
+		// discards any load in progress
+		++graphGeneration;
+		engine.exchangeGraph(nullptr);
+
+		getConsole().printLine("[GUI] : Graph removed.");
+	}
+
+	bool UIController::restorePlugin(const std::string& artifact, APE_Optimization_Level optimizationLevel)
+	{
+		if (!artifact.empty())
+		{
+			if (auto project = sourceManager->createProject())
+			{
+				setupProject(*project, optimizationLevel);
+
+				auto restoreArtifact = new char[artifact.size() + 1];
+				std::copy(artifact.c_str(), artifact.c_str() + artifact.size() + 1, restoreArtifact);
+				project->restoreArtifact = restoreArtifact;
+
+				std::unique_ptr<PluginState> plugin;
+
+				try
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+					plugin = std::make_unique<PluginState>(engine, engine.getCodeGenerator(), std::move(project));
+					auto delta = std::chrono::high_resolution_clock::now() - start;
+					auto time = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(delta);
+
+					getConsole().printLine("[GUI] : Restored compiled session (%f ms).", time.count());
+				}
+				catch (const PluginState::RestoreMissException&)
+				{
+					// out of date or evicted, so it has to be compiled
+				}
+				catch (const std::exception& e)
+				{
+					getConsole().printLine(CConsole::Error, "[GUI] : Error restoring compiled session, compiling instead (%s: %s).", cpl::Misc::DemangledTypeName(e).c_str(), e.what());
+				}
+
+				if (plugin)
+				{
+					setPlugin(std::move(plugin), EngineCommand::AlwaysTakeEngineValue);
+
+					if (!performCommand(UICommand::Activate))
+						return false;
+
+					getUICommandState().changeValueExternally(getUICommandState().activationState, 1.0);
+					return true;
+				}
+			}
+		}
+
+		// don't block the host on a full compilation, the engine bypasses until the plugin is activated
+		compiledOptions = EngineCommand::AlwaysTakeEngineValue;
+		compilerState = createPlugin(sourceManager->createProject(), true);
+
+		return compilerState.valid();
+	}
+
+
+	std::future<std::unique_ptr<PluginState>> UIController::createPlugin(std::unique_ptr<ProjectEx> project, bool enableHotReload, std::unique_ptr<ProjectEx> optimizedProject)
 	{
 		if (!project)
 		{
@@ -445,15 +918,32 @@ namespace ape
 			return {};
 		}
 
-		setupProject(*project);
+		const bool tiered = optimizedProject != nullptr;
+		const auto generation = ++compileGeneration;
+
+		setupProject(*project, tiered ? APE_Optimization_Fast : APE_Optimization_Best);
+
+		// anything older waiting to be optimized is obsolete now
+		pendingOptimizedProject = std::move(optimizedProject);
+		pendingGeneration = 0;
+
+		specialisationSource = engine.getSettings().lookUpValue(false, "application", "static_config") ? copyProject(*project) : nullptr;
+		sourceGeneration = 0;
+		failedSpecialisation = {};
+
+		profileSource = engine.getSettings().lookUpValue(0, "application", "pgo_seconds") > 0 ? copyProject(*project) : nullptr;
+		profileStage = ProfileStage::Idle;
+		profiledPlugin = nullptr;
 
 		labelQueue.pushMessage("Compiling...", CColours::red, 500);
 		getConsole().printLine("[GUI] : Compiling...");
 
 		getUICommandState().changeValueExternally(getUICommandState().compile, 1);
 
-		return std::async(
-			[=] (auto projectToCompile)
+		return compileService->submit(
+			this,
+			CompileService::Priority::Normal,
+			[=, projectToCompile = std::move(project)] () mutable
 			{
 				std::unique_ptr<PluginState> ret;
 				try
@@ -463,7 +953,11 @@ namespace ape
 					auto delta = std::chrono::high_resolution_clock::now() - start;
 					auto time = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(delta);
 
-					getConsole().printLine("[GUI] : Compiled successfully (%f ms).", time.count());
+					if (tiered)
+						getConsole().printLine("[GUI] : Compiled successfully (%f ms), optimizing in the background...", time.count());
+					else
+						getConsole().printLine("[GUI] : Compiled successfully (%f ms).", time.count());
+
 					labelQueue.pushMessage("Compiled OK!", CColours::green, 2000);
 
 				}
@@ -473,9 +967,22 @@ namespace ape
 					labelQueue.pushMessage("Error while compiling (see console)!", CColours::red, 5000);
 				}
 				
+				const bool compiled = ret != nullptr;
+				const PluginState* plugin = ret.get();
+
 				cpl::GUIUtils::MainEvent(*this, 
 					[=] 
 					{ 
+						// only optimize the quick build if it's still the latest one
+						if (tiered && compiled && generation == compileGeneration)
+						{
+							quickPlugin = plugin;
+							pendingGeneration = generation;
+						}
+
+						if (compiled && generation == compileGeneration)
+							sourceGeneration = generation;
+
 						if(enableHotReload)
 							performCommand(UICommand::AsyncActivate); 
 
@@ -484,15 +991,28 @@ namespace ape
 				);
 
 				return ret;
-			},
-			std::move(project)
+			}
 		);
 	}
 
-	void UIController::setupProject(ProjectEx& project)
+	void UIController::setupProject(ProjectEx& project, APE_Optimization_Level optimizationLevel)
 	{
 		setProjectName(project.projectName);
+		setupTarget(project, optimizationLevel);
 
+		// quick builds aren't worth remarking on. the remarks of the latest optimized build are shown
+		if (optimizationLevel == APE_Optimization_Best && sourceManager->showsOptimizationRemarks())
+		{
+			project.optimizationRemarks = 1;
+			sourceManager->clearOptimizationRemarks();
+		}
+
+		project.profileLines = sourceManager->profilesLines() ? 1 : 0;
+		project.profileScopes = sourceManager->profilesScopes() ? 1 : 0;
+	}
+
+	void UIController::setupTarget(ProjectEx& project, APE_Optimization_Level optimizationLevel)
+	{
 		switch (commandStates->precision.getAsTEnum<FPrecision>())
 		{
 		case FPrecision::FP32: project.floatPrecision = 32; break;
@@ -501,7 +1021,435 @@ namespace ape
 		}
 
 		project.nativeVectorBitWidth = cpl::simd::max_vector_capacity<float>() * sizeof(float) * CHAR_BIT;
-		project.optimizationLevel = APE_Optimization_Debug;
+		project.optimizationLevel = optimizationLevel;
+	}
+
+	void UIController::pulseLineProfile()
+	{
+		if (!sourceManager->profilesLines())
+			return;
+
+		const auto now = std::chrono::steady_clock::now();
+
+		if (now - lastLineProfile < std::chrono::milliseconds(500))
+			return;
+
+		lastLineProfile = now;
+
+		std::vector<float> profile;
+
+		if (auto profiler = currentPlugin ? currentPlugin->getLineProfiler() : nullptr)
+		{
+			const auto& project = currentPlugin->getProject();
+			std::string text;
+
+			// the lines only mean something as long as the source is the one that's running
+			if (project.sourceString && sourceManager->getDocumentText(text) && text == project.sourceString)
+				profile = profiler->getProfile();
+		}
+
+		sourceManager->setLineProfile(std::move(profile));
+	}
+
+	void UIController::pulseOptimizer()
+	{
+		auto isBusy = [](auto& future) { return future.valid() && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready; };
+
+		if (isBusy(optimizerState))
+			return;
+
+		if (optimizerState.valid())
+		{
+			optimizedPlugin = optimizerState.get();
+
+			if (optimizerGeneration != compileGeneration)
+				optimizedPlugin = nullptr;
+		}
+
+		if (pendingOptimizedProject && pendingGeneration == compileGeneration)
+		{
+			optimizerGeneration = pendingGeneration;
+			setupProject(*pendingOptimizedProject, APE_Optimization_Best);
+
+			optimizerState = compileService->submit(
+				this,
+				CompileService::Priority::Background,
+				[this, project = std::move(pendingOptimizedProject)] () mutable
+				{
+					std::unique_ptr<PluginState> ret;
+
+					try
+					{
+						auto start = std::chrono::high_resolution_clock::now();
+						ret = std::make_unique<PluginState>(engine, engine.getCodeGenerator(), std::move(project));
+						auto delta = std::chrono::high_resolution_clock::now() - start;
+						auto time = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(delta);
+
+						getConsole().printLine("[GUI] : Optimized build compiled (%f ms).", time.count());
+					}
+					catch (const std::exception& e)
+					{
+						getConsole().printLine(CConsole::Warning, "[GUI] : Error compiling optimized build, keeping the quick build (%s: %s).", cpl::Misc::DemangledTypeName(e).c_str(), e.what());
+					}
+
+					return ret;
+				}
+			);
+
+			return;
+		}
+
+		// wait for any activation to settle, as it refers to the current plugin
+		if (!optimizedPlugin || isBusy(activationState))
+			return;
+
+		if (compilerState.valid())
+		{
+			// the quick build was never activated, so just replace it.
+			std::promise<std::unique_ptr<PluginState>> optimized;
+			optimized.set_value(std::move(optimizedPlugin));
+			compilerState = optimized.get_future();
+		}
+		else if (currentPlugin && currentPlugin.get() == quickPlugin)
+		{
+			const bool wasEnabled = currentPlugin->isEnabled();
+
+			// same path as a hot reload, so it crossfades and keeps the parameter values
+			setPlugin(std::move(optimizedPlugin), EngineCommand::AlwaysTakeEngineValue);
+
+			if (wasEnabled)
+				activatePlugin(false);
+
+			getConsole().printLine("[GUI] : Swapped in optimized build.");
+		}
+
+		optimizedPlugin = nullptr;
+		quickPlugin = nullptr;
+	}
+
+	void UIController::pulseSpecialiser()
+	{
+		auto isBusy = [](auto& future) { return future.valid() && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready; };
+
+		if (isBusy(specialiserState))
+			return;
+
+		std::unique_ptr<PluginState> specialised;
+
+		if (specialiserState.valid())
+		{
+			specialised = specialiserState.get();
+
+			if (specialiserGeneration != compileGeneration)
+				specialised = nullptr;
+			else if (!specialised)
+				// don't try again until the configuration or the source changes
+				failedSpecialisation = specialisingFor;
+		}
+
+		// only specialise the latest build once it's running, and after it's been optimized
+		if (!specialisationSource || sourceGeneration != compileGeneration || !currentPlugin || compilerState.valid())
+			return;
+
+		if (pendingOptimizedProject || optimizedPlugin || isBusy(optimizerState) || isBusy(activationState))
+			return;
+
+		const auto config = engine.getConfig();
+
+		// not prepared to play yet
+		if (config.blockSize == 0 || config.sampleRate == 0)
+			return;
+
+		if (specialised)
+		{
+			// the configuration may have changed while compiling, in which case it's specialised again below
+			if (isSpecialisedFor(*specialised, config))
+			{
+				const bool wasEnabled = currentPlugin->isEnabled();
+
+				setPlugin(std::move(specialised), EngineCommand::AlwaysTakeEngineValue);
+
+				if (wasEnabled)
+					activatePlugin(false);
+
+				getConsole().printLine("[GUI] : Swapped in build specialised for %zu inputs, %zu outputs, %zu samples at %g Hz.", config.inputs, config.outputs, config.blockSize, config.sampleRate);
+				return;
+			}
+		}
+
+		if (isSpecialisedFor(*currentPlugin, config) || config == failedSpecialisation)
+			return;
+
+		auto project = copyProject(*specialisationSource);
+		setupProject(*project, APE_Optimization_Best);
+		project->staticConfig = new APE_Event_IOChanged { config.inputs, config.outputs, config.blockSize, config.sampleRate };
+
+		specialisingFor = config;
+		specialiserGeneration = compileGeneration;
+
+		specialiserState = compileService->submit(
+			this,
+			CompileService::Priority::Background,
+			[this, project = std::move(project)] () mutable
+			{
+				std::unique_ptr<PluginState> ret;
+
+				try
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+					ret = std::make_unique<PluginState>(engine, engine.getCodeGenerator(), std::move(project));
+					auto delta = std::chrono::high_resolution_clock::now() - start;
+					auto time = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(delta);
+
+					getConsole().printLine("[GUI] : Specialised build compiled (%f ms).", time.count());
+				}
+				catch (const std::exception& e)
+				{
+					getConsole().printLine(CConsole::Warning, "[GUI] : Error compiling specialised build, keeping the current build (%s: %s).", cpl::Misc::DemangledTypeName(e).c_str(), e.what());
+				}
+
+				return ret;
+			}
+		);
+	}
+
+	void UIController::pulseProfileGuided()
+	{
+		auto isBusy = [](auto& future) { return future.valid() && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready; };
+
+		// for the smoothed clocks per sample to settle on a new build
+		const auto settleTime = std::chrono::seconds(3);
+
+		if (isBusy(profileState))
+			return;
+
+		std::unique_ptr<PluginState> compiled;
+
+		if (profileState.valid())
+		{
+			compiled = profileState.get();
+
+			if (profileGeneration != compileGeneration)
+				compiled = nullptr;
+			else if (!compiled)
+			{
+				// don't try again until the source changes
+				profileStage = ProfileStage::Done;
+				profiledPlugin = nullptr;
+			}
+		}
+
+		if (!profileSource || sourceGeneration != compileGeneration || !currentPlugin || compilerState.valid())
+			return;
+
+		const auto now = std::chrono::steady_clock::now();
+
+		auto restart = [this]
+		{
+			profileStage = ProfileStage::Idle;
+			profiledPlugin = nullptr;
+		};
+
+		auto swapIn = [this](std::shared_ptr<PluginState> plugin)
+		{
+			const bool wasEnabled = currentPlugin->isEnabled();
+
+			setPlugin(std::move(plugin), EngineCommand::AlwaysTakeEngineValue);
+
+			if (wasEnabled)
+				activatePlugin(false);
+		};
+
+		auto compile = [this](APE_ProfileGuidance guidance, const char* kind)
+		{
+			auto project = copyProject(*profileSource);
+			setupProject(*project, APE_Optimization_Best);
+
+			auto directory = new char[profileDirectory.size() + 1];
+			std::copy(profileDirectory.c_str(), profileDirectory.c_str() + profileDirectory.size() + 1, directory);
+
+			project->profileGuidance = guidance;
+			project->profileDirectory = directory;
+
+			// keeps the specialisation of the profiled build, if any
+			if (auto config = profiledPlugin->getProject().staticConfig)
+				project->staticConfig = new APE_Event_IOChanged(*config);
+
+			profileGeneration = compileGeneration;
+
+			profileState = compileService->submit(
+				this,
+				CompileService::Priority::Background,
+				[this, kind, project = std::move(project)] () mutable
+				{
+					std::unique_ptr<PluginState> ret;
+
+					try
+					{
+						auto start = std::chrono::high_resolution_clock::now();
+						ret = std::make_unique<PluginState>(engine, engine.getCodeGenerator(), std::move(project));
+						auto delta = std::chrono::high_resolution_clock::now() - start;
+						auto time = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(delta);
+
+						getConsole().printLine("[GUI] : %s build compiled (%f ms).", kind, time.count());
+					}
+					catch (const std::exception& e)
+					{
+						getConsole().printLine(CConsole::Warning, "[GUI] : Error compiling %s build, keeping the current build (%s: %s).", kind, cpl::Misc::DemangledTypeName(e).c_str(), e.what());
+					}
+
+					return ret;
+				}
+			);
+		};
+
+		switch (profileStage)
+		{
+		case ProfileStage::Idle:
+
+			// only profile the final build, while it's processing live audio
+			if (pendingOptimizedProject || optimizedPlugin || isBusy(optimizerState) || isBusy(specialiserState) || isBusy(activationState))
+				return;
+
+			if (!engine.getPlayState() || !currentPlugin->isEnabled())
+				return;
+
+			profiledPlugin = currentPlugin;
+			profileDeadline = now + settleTime;
+			profileStage = ProfileStage::Baseline;
+			break;
+
+		case ProfileStage::Baseline:
+
+			if (currentPlugin != profiledPlugin)
+			{
+				restart();
+				return;
+			}
+
+			if (now < profileDeadline)
+				return;
+
+			clocksBeforeProfiling = engine.getProfilingData().smoothedClocksPerSample;
+
+			{
+				std::error_code ec;
+				const auto directory = cpl::fs::temp_directory_path(ec) / "ape-pgo" / std::to_string(engine.uniqueInstanceID());
+
+				// profiles of older builds mustn't be merged in
+				cpl::fs::remove_all(directory, ec);
+				cpl::fs::create_directories(directory, ec);
+				profileDirectory = directory.string();
+			}
+
+			compile(APE_ProfileGuidance_Instrument, "Instrumented");
+			profileStage = ProfileStage::Instrumenting;
+			break;
+
+		case ProfileStage::Instrumenting:
+
+			if (!compiled)
+				return;
+
+			if (currentPlugin != profiledPlugin)
+			{
+				restart();
+				return;
+			}
+
+			{
+				std::shared_ptr<PluginState> instrumented = std::move(compiled);
+				guidedPlugin = instrumented;
+				swapIn(std::move(instrumented));
+
+				const auto seconds = engine.getSettings().lookUpValue(0, "application", "pgo_seconds");
+				getConsole().printLine("[GUI] : Profiling the instrumented build for %d seconds...", seconds);
+				profileDeadline = now + std::chrono::seconds(seconds);
+			}
+
+			profileStage = ProfileStage::Measuring;
+			break;
+
+		case ProfileStage::Measuring:
+
+			if (currentPlugin != guidedPlugin.lock())
+			{
+				restart();
+				return;
+			}
+
+			// the previous build has to be disabled before it's activated again
+			if (now < profileDeadline || isBusy(activationState) || profiledPlugin->isEnabled())
+				return;
+
+			// the profile is written when the instrumented build is released, the previous build runs again meanwhile
+			swapIn(profiledPlugin);
+			profileStage = ProfileStage::Collecting;
+			break;
+
+		case ProfileStage::Collecting:
+
+			if (currentPlugin != profiledPlugin)
+			{
+				restart();
+				return;
+			}
+
+			if (!guidedPlugin.expired())
+				return;
+
+			compile(APE_ProfileGuidance_Optimize, "Profile guided");
+			profileStage = ProfileStage::Optimizing;
+			break;
+
+		case ProfileStage::Optimizing:
+
+			if (!compiled)
+				return;
+
+			if (currentPlugin != profiledPlugin)
+			{
+				restart();
+				return;
+			}
+
+			{
+				std::shared_ptr<PluginState> optimized = std::move(compiled);
+				guidedPlugin = optimized;
+				swapIn(std::move(optimized));
+			}
+
+			getConsole().printLine("[GUI] : Swapped in profile guided build.");
+
+			profiledPlugin = nullptr;
+			profileDeadline = now + settleTime;
+			profileStage = ProfileStage::Settling;
+			break;
+
+		case ProfileStage::Settling:
+
+			if (currentPlugin != guidedPlugin.lock())
+			{
+				profileStage = ProfileStage::Done;
+				return;
+			}
+
+			if (now < profileDeadline)
+				return;
+
+			{
+				const auto clocksAfter = engine.getProfilingData().smoothedClocksPerSample;
+				const auto change = clocksBeforeProfiling > 0 ? 100 * (clocksAfter - clocksBeforeProfiling) / clocksBeforeProfiling : 0.0;
+
+				getConsole().printLine("[GUI] : Profile guided build runs at %f clocks/sample, from %f before (%+.1f%%).", clocksAfter, clocksBeforeProfiling, change);
+			}
+
+			profileStage = ProfileStage::Done;
+			break;
+
+		case ProfileStage::Done:
+			break;
+		}
 	}
 
 	void UIController::setProjectName(std::string name) 
@@ -37,11 +37,13 @@
 	#include "SignalizerWindow.h"
 	#include <cpl/Misc.h>
 	#include <cpl/CMutex.h>
+	#include <chrono>
 	#include <future>
 	#include <memory>
 	#include "UI/UICommands.h"
 	#include "UI/LabelQueue.h"
 	#include <ape/APE.h>
+	#include <ape/Project.h>
 	#include <cpl/state/DecoupledStateObject.h>
 	#include "Engine/EngineStructures.h"
 
@@ -54,10 +56,12 @@
 		class SourceManager;
 		class CSerializer;
 		class PluginState;
+		class GraphDescription;
 		struct ProjectEx;
 		class MainEditor;
 		class AutosaveManager;
 		class UICommandState;
+		class CompileService;
 
 		class UIController
 			: public cpl::CMutex::Lockable
@@ -90,11 +94,47 @@
 			// TODO: Make private.
 			std::future<std::unique_ptr<PluginState>> createPlugin(bool enableHotReload = true);
 
+			/// <summary>
+			/// Restores and activates the plugin of a saved session, taking the parameter values of the engine.
+			/// If the compiled <paramref name="artifact"/> is still cached and current, the plugin is loaded from it without compiling.
+			/// Otherwise, the project is compiled and activated asynchronously, and the plugin is bypassed meanwhile.
+			/// Returns false on errors.
+			/// </summary>
+			bool restorePlugin(const std::string& artifact, APE_Optimization_Level optimizationLevel);
+			/// <summary>
+			/// The project of the current plugin, if any.
+			/// </summary>
+			const ProjectEx* getCurrentProject() const noexcept;
+			/// <summary>
+			/// Builds the current source ahead of time into a native module at <paramref name="destination"/>, asynchronously.
+			/// The module can be opened and run like a script afterwards, without compiling.
+			/// </summary>
+			void exportProject(const std::string& destination);
+			/// <summary>
+			/// Compiles the scripts of the graph file at <paramref name="path"/> asynchronously (see GraphDescription),
+			/// and processes the graph in place of the plugin once they're ready. Errors are printed to the console.
+			/// A native module exported by a compiler (see exportProject()) is run as a graph of that module alone.
+			/// </summary>
+			void loadGraph(const std::string& path);
+			/// <summary>
+			/// Removes the graph, if any, so the plugin is processed again.
+			/// </summary>
+			void clearGraph();
+			/// <summary>
+			/// The file of the running (or loading) graph, or empty if there is none.
+			/// </summary>
+			const std::string& getGraphPath() const noexcept { return graphPath; }
+
 			bool performCommand(UICommand command);
 
 			void serialize(cpl::CSerializer::Archiver & ar, cpl::Version version) override;
 			void deserialize(cpl::CSerializer::Builder & ar, cpl::Version version) override;
 			void externalDiagnostic(Diagnostic level, const cpl::string_ref text);
+			/// <summary>
+			/// Passes an optimization remark in <paramref name="text"/> on to the code editor, if it's about the source of the
+			/// <paramref name="project"/>. Returns false if it isn't a remark at all. Thread safe.
+			/// </summary>
+			bool optimizationRemark(const APE_Project& project, const cpl::string_ref text);
 
             void setPlugin(std::shared_ptr<PluginState> newPlugin, EngineCommand::TransientPluginOptions options = EngineCommand::None);
 
@@ -106,10 +146,44 @@
 
 			void editorOpened(MainEditor * newEditor);
 			void editorClosed();
-
-			std::future<std::unique_ptr<PluginState>> createPlugin(std::unique_ptr<ProjectEx> project, bool enableHotReload = true);
+			void editorFocused();
+
+			/// <summary>
+			/// Compiles the project asynchronously. If an <paramref name="optimizedProject"/> (with the same source) is given, 
+			/// the project is compiled quickly first, and the optimized project is compiled in the background afterwards,
+			/// and swapped in once it's ready. See pulseOptimizer().
+			/// </summary>
+			std::future<std::unique_ptr<PluginState>> createPlugin(std::unique_ptr<ProjectEx> project, bool enableHotReload = true, std::unique_ptr<ProjectEx> optimizedProject = nullptr);
 			void setProjectName(std::string name);
-			void setupProject(ProjectEx& project);
+			void setupProject(ProjectEx& project, APE_Optimization_Level optimizationLevel = APE_Optimization_Best);
+			/// <summary>
+			/// Sets the precision, vector width and optimization level of the <paramref name="project"/> from the current settings.
+			/// </summary>
+			void setupTarget(ProjectEx& project, APE_Optimization_Level optimizationLevel);
+			/// <summary>
+			/// Activates the compiled <paramref name="plugins"/> of the <paramref name="description"/>, and hands the graph to the engine.
+			/// </summary>
+			void installGraph(const GraphDescription& description, const std::vector<std::shared_ptr<PluginState>>& plugins);
+			/// <summary>
+			/// Starts pending optimized compilations, and swaps in finished ones in place of the quick build.
+			/// </summary>
+			void pulseOptimizer();
+			/// <summary>
+			/// If enabled, compiles the latest build again for the engine's current configuration (see ape::static_config
+			/// in the scripts) and swaps it in. Specialises again whenever the configuration changes, the running build
+			/// falls back to runtime values meanwhile.
+			/// </summary>
+			void pulseSpecialiser();
+			/// <summary>
+			/// Periodically shows the line profile of the running plugin in the editor, if lines are profiled.
+			/// </summary>
+			void pulseLineProfile();
+			/// <summary>
+			/// If enabled, profiles the latest build (once it's optimized and specialised) with an instrumented build running live
+			/// for a while, and swaps in a build optimized with the profile afterwards. The clocks per sample before and after
+			/// are reported in the console. Done once for every compilation.
+			/// </summary>
+			void pulseProfileGuided();
 
 			std::unique_ptr<AutosaveManager> autosaveManager;
 			std::unique_ptr<CConsole> console;
@@ -119,10 +193,52 @@
 			ape::Engine& engine;
 			std::shared_ptr<PluginState> currentPlugin;
             EngineCommand::TransientPluginOptions currentOptions;
+			// for the next compiled plugin to be activated
+			EngineCommand::TransientPluginOptions compiledOptions;
 			std::unique_ptr<cpl::SerializableStateObject<MainEditor>> editorSSO;
 			std::future<std::unique_ptr<PluginState>> compilerState;
 			std::future<bool> activationState;
 
+			// tiered compilation. generations identify compilations, so stale optimized builds can be discarded.
+			std::future<std::unique_ptr<PluginState>> optimizerState;
+			std::future<void> exportState;
+			std::unique_ptr<ProjectEx> pendingOptimizedProject;
+			std::unique_ptr<PluginState> optimizedPlugin;
+			const PluginState* quickPlugin = nullptr;
+			std::uint64_t compileGeneration = 0, pendingGeneration = 0, optimizerGeneration = 0;
+
+			// config specialisation. the source of the latest build is kept, as the configuration can change any time.
+			std::future<std::unique_ptr<PluginState>> specialiserState;
+			std::unique_ptr<ProjectEx> specialisationSource;
+			IOConfig specialisingFor, failedSpecialisation;
+			std::uint64_t sourceGeneration = 0, specialiserGeneration = 0;
+
+			// profile guided optimization, see pulseProfileGuided()
+			enum class ProfileStage
+			{
+				Idle, Baseline, Instrumenting, Measuring, Collecting, Optimizing, Settling, Done
+			};
+
+			std::future<std::unique_ptr<PluginState>> profileState;
+			std::unique_ptr<ProjectEx> profileSource;
+			// the build being profiled, which runs again while the optimized build is compiled
+			std::shared_ptr<PluginState> profiledPlugin;
+			// the instrumented or optimized build swapped in
+			std::weak_ptr<PluginState> guidedPlugin;
+			ProfileStage profileStage = ProfileStage::Idle;
+			std::uint64_t profileGeneration = 0;
+			std::chrono::steady_clock::time_point profileDeadline;
+			double clocksBeforeProfiling = 0;
+			std::string profileDirectory;
+
+			std::chrono::steady_clock::time_point lastLineProfile;
+
+			// processing graph, see loadGraph(). the generation discards loads that were superseded.
+			std::future<void> graphState;
+			std::string graphPath;
+			std::uint64_t graphGeneration = 0;
+
+			std::shared_ptr<CompileService> compileService;
 			LabelQueue labelQueue;			
 			std::string projectName;	
 		};
@@ -0,0 +1,131 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:AutomationCurves.cpp
+		
+		Implementation of AutomationCurves.h
+
+*************************************************************************************/
+
+
+#include "AutomationCurves.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace ape
+{
+	double AutomationCurves::Curve::valueAt(double seconds) const noexcept
+	{
+		if (points.empty())
+			return 0;
+
+		if (seconds < points.front().time)
+			return points.front().value;
+
+		// last point at or before the time, so steps take the later value
+		std::size_t i = 0;
+		while (i + 1 < points.size() && points[i + 1].time <= seconds)
+			++i;
+
+		if (i + 1 == points.size())
+			return points[i].value;
+
+		const auto& a = points[i];
+		const auto& b = points[i + 1];
+
+		return a.value + (b.value - a.value) * (seconds - a.time) / (b.time - a.time);
+	}
+
+	AutomationCurves AutomationCurves::FromFile(const std::string& path)
+	{
+		std::ifstream stream(path);
+
+		if (!stream.good())
+			throw std::runtime_error("Unable to open automation file " + path);
+
+		return Parse(stream, path);
+	}
+
+	AutomationCurves AutomationCurves::Parse(std::istream& stream, const std::string& source)
+	{
+		AutomationCurves ret;
+		std::string line;
+
+		for (std::size_t lineNumber = 1; std::getline(stream, line); ++lineNumber)
+		{
+			auto error = [&](const std::string& message)
+			{
+				return std::runtime_error(source + "(" + std::to_string(lineNumber) + "): " + message);
+			};
+
+			if (auto comment = line.find('#'); comment != std::string::npos)
+				line.erase(comment);
+
+			std::istringstream fields(line);
+			Point point;
+
+			if (!(fields >> std::ws) || fields.eof())
+				continue;
+
+			if (!(fields >> point.time >> point.value))
+				throw error("expected <seconds> <normalized value> <parameter name>");
+
+			std::string name;
+			std::getline(fields >> std::ws, name);
+
+			while (!name.empty() && std::isspace(static_cast<unsigned char>(name.back())))
+				name.pop_back();
+
+			if (name.empty())
+				throw error("missing parameter name");
+
+			if (point.time < 0)
+				throw error("negative time");
+
+			if (point.value < 0 || point.value > 1)
+				throw error("value of " + name + " isn't normalized (0 to 1)");
+
+			auto it = std::find_if(ret.curves.begin(), ret.curves.end(), [&](const Curve& c) { return c.parameter == name; });
+
+			if (it == ret.curves.end())
+			{
+				ret.curves.push_back({ name, {} });
+				it = ret.curves.end() - 1;
+			}
+			else if (point.time < it->points.back().time)
+			{
+				throw error("points of " + name + " aren't ordered by time");
+			}
+
+			it->points.push_back(point);
+		}
+
+		if (stream.bad())
+			throw std::runtime_error("Error reading automation file " + source);
+
+		return ret;
+	}
+};
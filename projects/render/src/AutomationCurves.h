@@ -0,0 +1,84 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:AutomationCurves.h
+		
+		Parameter automation for offline renders, read from a simple text format:
+		
+		    # comment
+		    <seconds> <normalized value> <parameter name>
+		
+		Values are linearly interpolated between points of the same parameter,
+		and held before the first and after the last point.
+
+*************************************************************************************/
+
+
+#ifndef APE_AUTOMATIONCURVES_H
+	#define APE_AUTOMATIONCURVES_H
+
+	#include <istream>
+	#include <string>
+	#include <vector>
+
+	namespace ape
+	{
+		class AutomationCurves
+		{
+		public:
+
+			struct Point
+			{
+				double time, value;
+			};
+
+			struct Curve
+			{
+				std::string parameter;
+				/// <summary>
+				/// Ordered by time. Points at the same time form a step.
+				/// </summary>
+				std::vector<Point> points;
+
+				double valueAt(double seconds) const noexcept;
+			};
+
+			/// <summary>
+			/// Throws std::runtime_error on read errors, or errors in the format (with the line number).
+			/// </summary>
+			static AutomationCurves FromFile(const std::string& path);
+			/// <summary>
+			/// See <see cref="FromFile()"/>. <paramref name="source"/> names the stream in errors.
+			/// </summary>
+			static AutomationCurves Parse(std::istream& stream, const std::string& source);
+
+			const std::vector<Curve>& getCurves() const noexcept { return curves; }
+			bool empty() const noexcept { return curves.empty(); }
+
+		private:
+
+			std::vector<Curve> curves;
+		};
+	};
+
+#endif
@@ -0,0 +1,278 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:OfflineRender.cpp
+		
+		Implementation of OfflineRender.h
+
+*************************************************************************************/
+
+
+#include "OfflineRender.h"
+#include "AutomationCurves.h"
+#include <Engine.h>
+#include <PluginState.h>
+#include <ProjectEx.h>
+#include <cpl/Misc.h>
+#include <cpl/simd.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace ape
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		double SecondsSince(Clock::time_point start)
+		{
+			return std::chrono::duration<double>(Clock::now() - start).count();
+		}
+
+		// see SourceProjectManager::createProject()
+		std::unique_ptr<ProjectEx> CreateProject(const RenderOptions& options)
+		{
+			auto copyString = [](const std::string& orig)
+			{
+				auto pointer = new char[orig.size() + 1];
+				std::copy(orig.begin(), orig.end(), pointer);
+				pointer[orig.size()] = '\0';
+				return pointer;
+			};
+
+			const juce::File script = juce::File::getCurrentWorkingDirectory().getChildFile(options.script);
+			const auto source = script.loadFileAsString().toStdString();
+
+			if (!script.existsAsFile() || source.empty())
+				throw std::runtime_error("Unable to read script " + options.script);
+
+			auto extension = script.getFileExtension().toStdString();
+
+			if (!extension.empty() && extension[0] == '.')
+				extension.erase(0, 1);
+
+			auto project = std::make_unique<ProjectEx>();
+
+			project->files = new char *[1];
+			project->files[0] = copyString(script.getFullPathName().toStdString());
+			project->nFiles = 1;
+			project->uniqueID = (unsigned)-1;
+			project->isSingleString = true;
+
+			project->workingDirectory = copyString(script.getParentDirectory().getFullPathName().toStdString());
+			project->sourceString = copyString(source);
+			project->projectName = copyString(script.getFileNameWithoutExtension().toStdString());
+			project->rootPath = copyString(cpl::Misc::DirectoryPath());
+			project->languageID = copyString(extension);
+
+			// see UIController::setupProject()
+			switch (options.floatPrecision)
+			{
+			case 32: case 64: case 80: project->floatPrecision = options.floatPrecision; break;
+			default: throw std::runtime_error("Unsupported float precision " + std::to_string(options.floatPrecision));
+			}
+
+			project->nativeVectorBitWidth = cpl::simd::max_vector_capacity<float>() * sizeof(float) * CHAR_BIT;
+			project->optimizationLevel = options.quick ? APE_Optimization_Debug : APE_Optimization_Best;
+
+			return project;
+		}
+
+		std::unique_ptr<juce::AudioFormatReader> OpenInput(const std::string& path)
+		{
+			juce::AudioFormatManager formats;
+			formats.registerBasicFormats();
+
+			const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(path);
+
+			if (auto reader = formats.createReaderFor(file))
+				return std::unique_ptr<juce::AudioFormatReader>(reader);
+
+			throw std::runtime_error("Unable to read audio file " + path);
+		}
+
+		std::unique_ptr<juce::AudioFormatWriter> OpenOutput(const std::string& path, double sampleRate, std::size_t channels, int bits)
+		{
+			const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(path);
+			file.deleteFile();
+
+			std::unique_ptr<juce::OutputStream> stream(file.createOutputStream());
+
+			if (!stream)
+				throw std::runtime_error("Unable to create " + path);
+
+			juce::WavAudioFormat format;
+
+			if (auto writer = format.createWriterFor(stream.get(), sampleRate, static_cast<unsigned>(channels), bits, juce::StringPairArray(), 0))
+			{
+				// owned by the writer now
+				stream.release();
+				return std::unique_ptr<juce::AudioFormatWriter>(writer);
+			}
+
+			throw std::runtime_error("Unable to write " + std::to_string(bits) + " bit wave files with " + std::to_string(channels) + " channels");
+		}
+
+		struct BoundCurve
+		{
+			const AutomationCurves::Curve* curve;
+			ParameterManager::IndexHandle index;
+			double lastValue;
+		};
+
+		std::vector<BoundCurve> BindCurves(const AutomationCurves& curves, ParameterManager& parameters)
+		{
+			std::vector<BoundCurve> ret;
+
+			for (auto& curve : curves.getCurves())
+			{
+				std::size_t i = 0;
+
+				while (i < parameters.numParams() && parameters.getParameterName(static_cast<ParameterManager::IndexHandle>(i)) != curve.parameter)
+					++i;
+
+				if (i == parameters.numParams())
+					throw std::runtime_error("Automated parameter \"" + curve.parameter + "\" doesn't exist in the script");
+
+				ret.push_back({ &curve, static_cast<ParameterManager::IndexHandle>(i), -1 });
+			}
+
+			return ret;
+		}
+	}
+
+	RenderResult Render(Engine& engine, const RenderOptions& options)
+	{
+		if (options.blockSize == 0)
+			throw std::runtime_error("Block size must be positive");
+
+		RenderResult result;
+		const auto renderStart = Clock::now();
+
+		const auto automation = options.automation.empty() ? AutomationCurves() : AutomationCurves::FromFile(options.automation);
+
+		auto reader = OpenInput(options.input);
+
+		const auto inputs = static_cast<std::size_t>(reader->numChannels);
+		const auto outputs = options.outputs ? options.outputs : inputs;
+		const auto sampleRate = options.sampleRate > 0 ? options.sampleRate : reader->sampleRate;
+		const auto inputRatio = reader->sampleRate / sampleRate;
+		const auto inputFrames = static_cast<std::size_t>(std::ceil(reader->lengthInSamples / inputRatio));
+		const auto totalFrames = inputFrames + static_cast<std::size_t>(std::ceil(std::max(0.0, options.tail) * sampleRate));
+
+		auto readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader.release(), true);
+		juce::AudioSource* input = readerSource.get();
+		std::unique_ptr<juce::ResamplingAudioSource> resampler;
+
+		// only resample if needed, so renders at the native rate are bit exact
+		if (inputRatio != 1)
+		{
+			resampler = std::make_unique<juce::ResamplingAudioSource>(readerSource.get(), false, static_cast<int>(inputs));
+			resampler->setResamplingRatio(inputRatio);
+			input = resampler.get();
+		}
+
+		input->prepareToPlay(static_cast<int>(options.blockSize), sampleRate);
+
+		auto writer = OpenOutput(options.output, sampleRate, outputs, options.bits);
+
+		// the api reports the configuration of the engine to the script
+		engine.setPlayConfigDetails(static_cast<int>(inputs), static_cast<int>(outputs), sampleRate, static_cast<int>(options.blockSize));
+
+		IOConfig config;
+		config.inputs = inputs;
+		config.outputs = outputs;
+		config.blockSize = options.blockSize;
+		config.sampleRate = sampleRate;
+
+		const auto compileStart = Clock::now();
+		// throws on compilation errors, which are printed to the console
+		auto plugin = std::make_unique<PluginState>(engine, engine.getCodeGenerator(), CreateProject(options));
+
+		// see UIController::performCommand(UICommand::Activate)
+		if (!plugin->initializeActivation())
+			throw std::runtime_error("Error activating the script");
+
+		plugin->setConfig(config);
+		plugin->setPlayState(true);
+
+		if (!plugin->finalizeActivation())
+			throw std::runtime_error("Error activating the script");
+
+		result.compileSeconds = SecondsSince(compileStart);
+
+		auto curves = BindCurves(automation, engine.getParameterManager());
+
+		juce::AudioBuffer<float> inputBuffer(static_cast<int>(inputs), static_cast<int>(options.blockSize));
+		juce::AudioBuffer<float> outputBuffer(static_cast<int>(outputs), static_cast<int>(options.blockSize));
+
+		Clock::duration processing {};
+
+		for (std::size_t position = 0; position < totalFrames; position += options.blockSize)
+		{
+			const auto frames = std::min(options.blockSize, totalFrames - position);
+
+			// past the end, reader sources produce silence
+			input->getNextAudioBlock(juce::AudioSourceChannelInfo(&inputBuffer, 0, static_cast<int>(frames)));
+
+			// automation changes between blocks, like from a host
+			for (auto& bound : curves)
+			{
+				const auto value = bound.curve->valueAt(position / sampleRate);
+
+				if (value != bound.lastValue)
+				{
+					engine.getParameterManager().setParameter(bound.index, value);
+					bound.lastValue = value;
+				}
+			}
+
+			const auto start = Clock::now();
+			const auto success = plugin->processReplacing(inputBuffer.getArrayOfReadPointers(), outputBuffer.getArrayOfWritePointers(), frames);
+			processing += Clock::now() - start;
+
+			if (!success)
+				throw std::runtime_error("The script failed while processing at " + std::to_string(position / sampleRate) + " seconds");
+
+			if (!writer->writeFromFloatArrays(outputBuffer.getArrayOfReadPointers(), static_cast<int>(outputs), static_cast<int>(frames)))
+				throw std::runtime_error("Error writing to " + options.output);
+		}
+
+		plugin->disableProject();
+		input->releaseResources();
+
+		// flushes the file
+		writer = nullptr;
+
+		result.frames = totalFrames;
+		result.audioSeconds = totalFrames / sampleRate;
+		result.processSeconds = std::chrono::duration<double>(processing).count();
+		result.totalSeconds = SecondsSince(renderStart);
+
+		return result;
+	}
+};
@@ -0,0 +1,101 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:OfflineRender.h
+		
+		Renders an audio file through a script, without an editor or a host,
+		as fast as possible.
+
+*************************************************************************************/
+
+
+#ifndef APE_OFFLINERENDER_H
+	#define APE_OFFLINERENDER_H
+
+	#include <cstddef>
+	#include <string>
+
+	namespace ape
+	{
+		class Engine;
+
+		struct RenderOptions
+		{
+			/// <summary>
+			/// The script to compile, with the compiler picked by the extension as in the editor.
+			/// </summary>
+			std::string script;
+			std::string input, output;
+			/// <summary>
+			/// Optional, see AutomationCurves.
+			/// </summary>
+			std::string automation;
+
+			std::size_t blockSize = 512;
+			/// <summary>
+			/// Zero renders at the rate of the input. Otherwise the input is resampled to this rate.
+			/// </summary>
+			double sampleRate = 0;
+			/// <summary>
+			/// Zero renders as many output channels as there are inputs.
+			/// </summary>
+			std::size_t outputs = 0;
+			int bits = 24;
+			int floatPrecision = 32;
+			/// <summary>
+			/// Extra seconds rendered after the input ends, for reverb tails and such.
+			/// </summary>
+			double tail = 0;
+			/// <summary>
+			/// Compiles without optimizations, like the quick builds of the editor.
+			/// </summary>
+			bool quick = false;
+		};
+
+		struct RenderResult
+		{
+			std::size_t frames = 0;
+			double audioSeconds = 0;
+			/// <summary>
+			/// Wall clock time spent inside the script's processing only.
+			/// </summary>
+			double processSeconds = 0;
+			double compileSeconds = 0;
+			double totalSeconds = 0;
+
+			/// <summary>
+			/// How many times faster than real time the script processed, disregarding file IO and compilation.
+			/// </summary>
+			double realTimeFactor() const noexcept { return processSeconds > 0 ? audioSeconds / processSeconds : 0; }
+		};
+
+		/// <summary>
+		/// Compiles and activates the script as a plugin of <paramref name="engine"/>, streams the input
+		/// through it block by block, and writes the output as a wave file.
+		/// The engine must not be processing anything else meanwhile.
+		/// Throws on any error, including errors of the script.
+		/// </summary>
+		RenderResult Render(Engine& engine, const RenderOptions& options);
+	};
+
+#endif
@@ -0,0 +1,166 @@
+/*************************************************************************************
+
+	Audio Programming Environment VST. 
+		
+    Copyright (C) 2018 Janus Lynggaard Thorborg [LightBridge Studios]
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	See \licenses\ for additional details on licenses associated with this program.
+
+**************************************************************************************
+
+	file:main.cpp
+		
+		Command line front end for offline renders, see Usage().
+		Needs no display, so it can run on build machines.
+
+*************************************************************************************/
+
+
+#include "OfflineRender.h"
+#include <Engine.h>
+#include <UIController.h>
+#include <CConsole.h>
+#include <cpl/Misc.h>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const char* Usage()
+	{
+		return
+			"usage: render <script> <input> <output> [options]\n"
+			"\n"
+			"Compiles the script as the editor would, processes the input audio file through it\n"
+			"as fast as possible and writes the output as a wave file.\n"
+			"The program must reside next to the configuration and compilers of APE.\n"
+			"\n"
+			"options:\n"
+			"  --block <frames>       frames per processed block (512)\n"
+			"  --rate <hz>            resample the input to this rate (rate of the input)\n"
+			"  --outputs <channels>   output channels (channels of the input)\n"
+			"  --bits <bits>          bit depth of the output (24)\n"
+			"  --precision <bits>     float precision of the script: 32, 64 or 80 (32)\n"
+			"  --tail <seconds>       extra time to render after the input ends (0)\n"
+			"  --automation <file>    parameter automation, lines of:\n"
+			"                         <seconds> <normalized value> <parameter name>\n"
+			"  --quick                compile without optimizations\n"
+			"  --quiet                don't print the console of the engine\n";
+	}
+
+	bool ParseArguments(int argc, char** argv, ape::RenderOptions& options, bool& quiet)
+	{
+		std::vector<std::string> positional;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+
+			auto next = [&]() -> std::string
+			{
+				if (i + 1 >= argc)
+					throw std::invalid_argument("missing value for " + arg);
+
+				return argv[++i];
+			};
+
+			if (arg == "--block")
+				options.blockSize = std::stoul(next());
+			else if (arg == "--rate")
+				options.sampleRate = std::stod(next());
+			else if (arg == "--outputs")
+				options.outputs = std::stoul(next());
+			else if (arg == "--bits")
+				options.bits = std::stoi(next());
+			else if (arg == "--precision")
+				options.floatPrecision = std::stoi(next());
+			else if (arg == "--tail")
+				options.tail = std::stod(next());
+			else if (arg == "--automation")
+				options.automation = next();
+			else if (arg == "--quick")
+				options.quick = true;
+			else if (arg == "--quiet")
+				quiet = true;
+			else if (arg.size() > 1 && arg[0] == '-')
+				throw std::invalid_argument("unknown option " + arg);
+			else
+				positional.push_back(arg);
+		}
+
+		if (positional.size() != 3)
+			return false;
+
+		options.script = positional[0];
+		options.input = positional[1];
+		options.output = positional[2];
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ape::RenderOptions options;
+	bool quiet = false;
+
+	try
+	{
+		if (!ParseArguments(argc, argv, options, quiet))
+		{
+			std::fputs(Usage(), stderr);
+			return 2;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "render: %s\n\n%s", e.what(), Usage());
+		return 2;
+	}
+
+	// message manager and such, no display is opened
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+	try
+	{
+		ape::Engine engine;
+		engine.getController().getConsole().setStdWriting(!quiet);
+
+		const auto result = ape::Render(engine, options);
+
+		std::printf(
+			"render: %s: %.3f s of audio (%zu frames) processed in %.3f s, %.1fx real time (compiled in %.3f s, %.3f s in total)\n",
+			options.output.c_str(),
+			result.audioSeconds,
+			result.frames,
+			result.processSeconds,
+			result.realTimeFactor(),
+			result.compileSeconds,
+			result.totalSeconds
+		);
+
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "render: %s: %s\n", cpl::Misc::DemangledTypeName(e).c_str(), e.what());
+		return 1;
+	}
+}
@@ -80,6 +80,18 @@ namespace TCC4Ape
 
 	Status ScriptCompiler::compileProject()
 	{
+		if (getProject()->exportPath)
+		{
+			print(APE_Diag_Error, "[TCC4Ape] : Native export isn't supported for C scripts.");
+			return Status::STATUS_NOT_IMPLEMENTED;
+		}
+
+		if (getProject()->profileGuidance != APE_ProfileGuidance_None)
+		{
+			print(APE_Diag_Error, "[TCC4Ape] : Profile guided optimization isn't supported for C scripts.");
+			return Status::STATUS_NOT_IMPLEMENTED;
+		}
+
 		const TCCBindings::CompilerAccess compiler;
 
 		if (!compiler.isLinked())
@@ -0,0 +1,259 @@
+#include "stdafx.h"
+#include <CAllocator.h>
+#include <ScratchArena.h>
+#include <cpl/CMutex.h>
+#include <cpl/Misc.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// the previous, mutex protected allocator with a header per block and linear frees,
+	// kept here as a baseline for the benchmark.
+	class LegacyAllocator
+	{
+	public:
+
+		void * alloc(std::size_t memsize)
+		{
+			auto const size = sizeof(header) + memsize + sizeof(unsigned);
+			auto m = cpl::Misc::alignedMalloc<std::byte>(size);
+			std::memset(m, 0, size);
+
+			auto h = reinterpret_cast<header *>(m);
+			h->end = reinterpret_cast<unsigned *>(m + size - sizeof(unsigned));
+			*h->end = 0xBADC0DE;
+
+			cpl::CMutex lock(mutex);
+			allocations.push_back(h);
+			return h + 1;
+		}
+
+		void free(void * block)
+		{
+			cpl::CMutex lock(mutex);
+
+			auto h = reinterpret_cast<header *>(block) - 1;
+
+			for (auto it = allocations.begin(); it != allocations.end(); ++it)
+			{
+				if (*it == h)
+				{
+					allocations.erase(it);
+					break;
+				}
+			}
+
+			cpl::Misc::alignedFree(h);
+		}
+
+	private:
+
+		struct alignas(32) header
+		{
+			unsigned * end;
+		};
+
+		std::list<header *> allocations;
+		cpl::CMutex::Lockable mutex;
+	};
+
+	template<typename Alloc, typename Free>
+	double NanosecondsPerOperation(std::size_t numThreads, Alloc&& alloc, Free&& free)
+	{
+		const std::size_t operations = 200000;
+		const std::size_t liveBlocks = 256;
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::vector<std::thread> threads;
+
+		for (std::size_t t = 0; t < numThreads; ++t)
+		{
+			threads.emplace_back(
+				[&, t]
+				{
+					std::mt19937 rng(static_cast<unsigned>(t));
+					std::uniform_int_distribution<std::size_t> sizes(8, 2048);
+					std::vector<void *> live(liveBlocks, nullptr);
+
+					for (std::size_t i = 0; i < operations; ++i)
+					{
+						auto& slot = live[rng() % liveBlocks];
+
+						if (slot)
+						{
+							free(slot);
+							slot = nullptr;
+						}
+						else
+						{
+							slot = alloc(sizes(rng));
+						}
+					}
+
+					for (auto block : live)
+						if (block)
+							free(block);
+				}
+			);
+		}
+
+		for (auto& t : threads)
+			t.join();
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count() / (operations * numThreads);
+	}
+}
+
+TEST_CASE("Allocations are zeroed and aligned", "[Allocator]")
+{
+	ape::CAllocator allocator(64);
+
+	for (std::size_t size : { 1, 27, 64, 1000, 16000, 100000 })
+	{
+		auto block = static_cast<unsigned char *>(allocator.alloc(APE_Alloc_Tiny, size));
+
+		REQUIRE(block != nullptr);
+		REQUIRE(reinterpret_cast<std::uintptr_t>(block) % 64 == 0);
+
+		for (std::size_t i = 0; i < size; ++i)
+			REQUIRE(block[i] == 0);
+
+		std::memset(block, 0xFF, size);
+		allocator.free(block);
+	}
+
+	auto wide = allocator.alloc(APE_Alloc_Tiny, 10, 4096);
+	REQUIRE(reinterpret_cast<std::uintptr_t>(wide) % 4096 == 0);
+	allocator.free(wide);
+}
+
+TEST_CASE("Double frees and overruns are caught", "[Allocator]")
+{
+	ape::CAllocator allocator(64);
+
+	auto block = allocator.alloc(APE_Alloc_Tiny, 100);
+	allocator.free(block);
+	REQUIRE_THROWS(allocator.free(block));
+
+	auto overrun = static_cast<char *>(allocator.alloc(APE_Alloc_Tiny, 60));
+	std::memset(overrun, 1, 64);
+	REQUIRE_THROWS(allocator.free(overrun));
+
+	// the canary follows the requested bytes, not the end of the size class
+	auto small = static_cast<char *>(allocator.alloc(APE_Alloc_Tiny, 1));
+	small[1] = 1;
+	REQUIRE_THROWS(allocator.free(small));
+
+	auto large = static_cast<char *>(allocator.alloc(APE_Alloc_Tiny, 100000));
+	large[100000] = 1;
+	REQUIRE_THROWS(allocator.free(large));
+
+	ape::CAllocator other(64);
+	auto foreign = other.alloc(APE_Alloc_Tiny, 100);
+	REQUIRE_THROWS(allocator.free(foreign));
+}
+
+TEST_CASE("Large blocks are reused once freed", "[Allocator]")
+{
+	ape::CAllocator allocator(64);
+
+	auto first = static_cast<unsigned char *>(allocator.alloc(APE_Alloc_Tiny, 200000));
+	std::memset(first, 0xFF, 200000);
+	allocator.free(first);
+	REQUIRE_THROWS(allocator.free(first));
+
+	// rounded up to the same span, so it's served from the cache
+	auto second = static_cast<unsigned char *>(allocator.alloc(APE_Alloc_Tiny, 150000));
+	REQUIRE(second == first);
+
+	for (std::size_t i = 0; i < 150000; ++i)
+		REQUIRE(second[i] == 0);
+
+	allocator.free(second);
+
+	// beyond the cached sizes, blocks go straight back to the system
+	auto huge = allocator.alloc(APE_Alloc_Tiny, 4 << 20);
+	REQUIRE(huge != nullptr);
+	allocator.free(huge);
+}
+
+TEST_CASE("Blocks can be freed from other threads", "[Allocator]")
+{
+	ape::CAllocator allocator(64);
+	std::vector<void *> blocks;
+
+	for (int i = 0; i < 10000; ++i)
+		blocks.push_back(allocator.alloc(APE_Alloc_Tiny, i % 3000));
+
+	std::thread([&] { for (auto block : blocks) allocator.free(block); }).join();
+
+	for (int i = 0; i < 10000; ++i)
+		REQUIRE(allocator.alloc(APE_Alloc_Tiny, i % 3000) != nullptr);
+
+	REQUIRE_NOTHROW(allocator.clear());
+	REQUIRE(allocator.alloc(APE_Alloc_Tiny, 10) != nullptr);
+}
+
+TEST_CASE("Scratch arena overflows, aligns and resets", "[ScratchArena]")
+{
+	ape::CAllocator allocator(64);
+	ape::ScratchArena arena(allocator, 1024);
+
+	for (std::size_t i = 0; i < 40; ++i)
+	{
+		auto block = arena.alloc(i * 10, i % 2 ? 256 : 16);
+
+		REQUIRE(block != nullptr);
+		REQUIRE(reinterpret_cast<std::uintptr_t>(block) % (i % 2 ? 256 : 64) == 0);
+		REQUIRE(arena.owns(block));
+	}
+
+	int local;
+	REQUIRE(!arena.owns(&local));
+
+	auto overflowed = arena.alloc(2000, 16);
+	arena.reset();
+	REQUIRE(!arena.owns(overflowed));
+	REQUIRE(arena.getCapacity() == 1024);
+
+	// grown off the audio thread, and swapped in by the next reset
+	arena.grow();
+	arena.reset();
+	arena.grow();
+
+	auto const capacity = arena.getCapacity();
+	REQUIRE(capacity > 1024);
+
+	for (std::size_t i = 0; i < 40; ++i)
+		REQUIRE(arena.owns(arena.alloc(i * 10, i % 2 ? 256 : 16)));
+
+	arena.alloc(2000, 16);
+	arena.reset();
+	arena.grow();
+	arena.reset();
+
+	// the demand hasn't changed, so neither does the capacity
+	REQUIRE(arena.getCapacity() == capacity);
+}
+
+TEST_CASE("Allocator throughput under contention", "[.][benchmark][Allocator]")
+{
+	for (std::size_t threads : { 1, 2, 4, 8 })
+	{
+		LegacyAllocator legacy;
+		ape::CAllocator current(64);
+
+		auto before = NanosecondsPerOperation(threads, [&](auto size) { return legacy.alloc(size); }, [&](auto block) { legacy.free(block); });
+		auto after = NanosecondsPerOperation(threads, [&](auto size) { return current.alloc(APE_Alloc_Tiny, size); }, [&](auto block) { current.free(block); });
+
+		std::cout << threads << " thread(s): legacy " << before << " ns/op, size classes " << after << " ns/op" << std::endl;
+	}
+}
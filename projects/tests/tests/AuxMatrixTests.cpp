@@ -0,0 +1,170 @@
+#include "stdafx.h"
+#include <Engine/EngineStructures.h>
+#include <cpl/dsp.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+	std::vector<const ape::AuxKernels::Table*> AvailableKernels()
+	{
+		std::vector<const ape::AuxKernels::Table*> ret;
+
+		for (auto table : { ape::AuxKernels::sse2(), ape::AuxKernels::avx2(), ape::AuxKernels::neon() })
+		{
+			if (table)
+				ret.push_back(table);
+		}
+
+		return ret;
+	}
+
+	std::vector<float> Noise(std::size_t length, unsigned seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> dist(-1, 1);
+		std::vector<float> ret(length);
+
+		for (auto& f : ret)
+			f = dist(rng);
+
+		return ret;
+	}
+
+	bool BitExact(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+	}
+
+	template<typename Function>
+	double NanosecondsPerBlock(Function&& f)
+	{
+		const std::size_t iterations = 20000;
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (std::size_t i = 0; i < iterations; ++i)
+			f();
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count() / iterations;
+	}
+}
+
+TEST_CASE("SIMD aux kernels are bit-exact with the scalar kernels", "[AuxMatrix]")
+{
+	auto& scalar = ape::AuxKernels::scalar();
+
+	for (auto table : AvailableKernels())
+	{
+		INFO(table->name);
+
+		// odd lengths to exercise the tails
+		for (std::size_t length : { 1, 3, 4, 7, 8, 31, 64, 257, 1023 })
+		{
+			auto source = Noise(length, static_cast<unsigned>(length));
+			std::vector<float> expected = Noise(length, 1), actual = expected;
+
+			table->copy(actual.data(), source.data(), length);
+			scalar.copy(expected.data(), source.data(), length);
+			REQUIRE(BitExact(expected, actual));
+
+			table->accumulateRamp(actual.data(), source.data(), length, 0.3f, 0.7f / length);
+			scalar.accumulateRamp(expected.data(), source.data(), length, 0.3f, 0.7f / length);
+			REQUIRE(BitExact(expected, actual));
+
+			for (std::size_t sourceLength : { 1, 2, 5, 100, 4096 })
+			{
+				auto trace = Noise(sourceLength, static_cast<unsigned>(sourceLength));
+				auto ratio = (double)sourceLength / length;
+
+				table->resample(actual.data(), length, trace.data(), sourceLength, ratio);
+				scalar.resample(expected.data(), length, trace.data(), sourceLength, ratio);
+				REQUIRE(BitExact(expected, actual));
+			}
+
+			table->clear(actual.data(), length);
+			REQUIRE(BitExact(std::vector<float>(length), actual));
+		}
+	}
+}
+
+TEST_CASE("AuxMatrix crossfade ramps from start to end", "[AuxMatrix]")
+{
+	ape::AuxMatrix matrix;
+	matrix.resizeChannels(1);
+	matrix.softBufferResize(65);
+	matrix.clear(0, 1);
+
+	std::vector<float> ones(65, 1.0f);
+	const float* buffers[] = { ones.data() };
+	matrix.accumulate(buffers, 0, 1, 1.0f, 0.0f);
+
+	REQUIRE(matrix[0][0] == 1.0f);
+	REQUIRE(matrix[0][32] == Approx(0.5f));
+	REQUIRE(matrix[0][64] == Approx(0.0f).margin(1e-6));
+}
+
+TEST_CASE("AuxMatrix kernel throughput", "[.][benchmark][AuxMatrix]")
+{
+	const std::size_t length = 512, traceLength = 300;
+
+	auto source = Noise(length, 1), trace = Noise(traceLength, 2);
+	std::vector<float> dest(length);
+
+	auto& scalar = ape::AuxKernels::scalar();
+	std::vector<float> expectedRamp(length), expectedResample(length);
+	scalar.accumulateRamp(expectedRamp.data(), source.data(), length, 0.0f, 1.0f / (length - 1));
+	scalar.resample(expectedResample.data(), length, trace.data(), traceLength, (double)traceLength / length);
+
+	// the previous implementations, as a baseline
+	auto legacyAccumulate = NanosecondsPerBlock(
+		[&]
+		{
+			for (std::size_t n = 0; n < length; ++n)
+			{
+				const float progress = n / float(length - 1);
+				dest[n] += source[n] * progress;
+			}
+		}
+	);
+
+	auto legacyResample = NanosecondsPerBlock(
+		[&]
+		{
+			auto ratio = (double)traceLength / length;
+			double x = 0;
+
+			for (std::size_t i = 0; i < length; ++i)
+			{
+				dest[i] = cpl::dsp::linearFilter<float>(trace.data(), static_cast<cpl::Types::fsint_t>(traceLength), x);
+				x += ratio;
+			}
+		}
+	);
+
+	std::cout << "legacy: accumulate " << legacyAccumulate << " ns, resample " << legacyResample << " ns" << std::endl;
+
+	std::vector<const ape::AuxKernels::Table*> tables { &scalar };
+	for (auto table : AvailableKernels())
+		tables.push_back(table);
+
+	for (auto table : tables)
+	{
+		auto copy = NanosecondsPerBlock([&] { table->copy(dest.data(), source.data(), length); });
+		auto clear = NanosecondsPerBlock([&] { table->clear(dest.data(), length); });
+		auto accumulate = NanosecondsPerBlock([&] { table->accumulateRamp(dest.data(), source.data(), length, 0.0f, 1.0f / (length - 1)); });
+		auto resample = NanosecondsPerBlock([&] { table->resample(dest.data(), length, trace.data(), traceLength, (double)traceLength / length); });
+
+		std::cout << table->name << ": copy " << copy << " ns, clear " << clear << " ns, accumulate " << accumulate << " ns, resample " << resample << " ns" << std::endl;
+
+		std::fill(dest.begin(), dest.end(), 0.0f);
+		table->accumulateRamp(dest.data(), source.data(), length, 0.0f, 1.0f / (length - 1));
+		REQUIRE(BitExact(expectedRamp, dest));
+
+		table->resample(dest.data(), length, trace.data(), traceLength, (double)traceLength / length);
+		REQUIRE(BitExact(expectedResample, dest));
+	}
+}
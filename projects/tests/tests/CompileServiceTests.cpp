@@ -0,0 +1,95 @@
+#include "stdafx.h"
+#include <CompileService.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	// occupies the only worker until the returned promise is fulfilled
+	std::promise<void> BlockWorker(ape::CompileService& service)
+	{
+		std::promise<void> gate;
+		auto opened = gate.get_future().share();
+		std::promise<void> started;
+
+		service.submit(nullptr, ape::CompileService::Priority::Normal, [opened, &started] { started.set_value(); opened.wait(); });
+		started.get_future().wait();
+
+		return gate;
+	}
+}
+
+TEST_CASE("Compile service runs the focused instance first, then by priority", "[CompileService]")
+{
+	ape::CompileService service(1);
+	int first, second;
+	std::vector<int> order;
+	std::mutex mutex;
+
+	auto record = [&](int id) { return [&, id] { std::lock_guard<std::mutex> lock(mutex); order.push_back(id); return id; }; };
+
+	auto gate = BlockWorker(service);
+
+	auto a = service.submit(&first, ape::CompileService::Priority::Background, record(1));
+	auto b = service.submit(&first, ape::CompileService::Priority::Normal, record(2));
+	auto c = service.submit(&second, ape::CompileService::Priority::Background, record(3));
+	auto d = service.submit(&second, ape::CompileService::Priority::Normal, record(4));
+	auto e = service.submit(&first, ape::CompileService::Priority::Normal, record(5));
+
+	// applies to jobs already queued
+	service.setFocus(&second);
+	gate.set_value();
+
+	REQUIRE(a.get() == 1);
+	REQUIRE(e.get() == 5);
+	REQUIRE((order == std::vector<int>{ 4, 3, 2, 5, 1 }));
+}
+
+TEST_CASE("Compile service forwards exceptions and cancels queued jobs", "[CompileService]")
+{
+	ape::CompileService service(1);
+	int owner;
+
+	auto gate = BlockWorker(service);
+
+	auto failing = service.submit(nullptr, ape::CompileService::Priority::Normal, []() -> int { throw std::runtime_error("compilation failed"); });
+	auto cancelled = service.submit(&owner, ape::CompileService::Priority::Normal, [] { return 1; });
+
+	service.cancel(&owner);
+	gate.set_value();
+
+	REQUIRE_THROWS_AS(failing.get(), std::runtime_error);
+	REQUIRE_THROWS_AS(cancelled.get(), std::future_error);
+}
+
+TEST_CASE("Compile service is shared and runs jobs concurrently", "[CompileService]")
+{
+	auto service = ape::CompileService::acquire(4);
+	REQUIRE(ape::CompileService::acquire().get() == service.get());
+
+	std::atomic<int> concurrent(0), peak(0);
+	std::vector<std::future<void>> jobs;
+
+	for (int i = 0; i < 16; ++i)
+	{
+		jobs.push_back(service->submit(nullptr, ape::CompileService::Priority::Normal,
+			[&]
+			{
+				auto now = ++concurrent;
+				for (auto old = peak.load(); old < now && !peak.compare_exchange_weak(old, now); );
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				concurrent--;
+			}
+		));
+	}
+
+	for (auto& job : jobs)
+		job.get();
+
+	REQUIRE(peak.load() > 1);
+	REQUIRE(peak.load() <= static_cast<int>(service->getNumWorkers()));
+}
@@ -23,3 +23,33 @@ TEST_CASE("Serialization roundtrip", "[Engine]")
 
 	REQUIRE_NOTHROW(engine->setStateInformation(serializedData.getData(), (int)serializedData.getSize()));
 }
+
+TEST_CASE("Bypass passes through more channels than the scope shows", "[Engine]")
+{
+	auto engine = std::make_unique<ape::Engine>();
+	juce::AudioProcessor& processor = *engine;
+
+	const int channels = 64, frames = 256;
+
+	processor.setPlayConfigDetails(channels, channels, 44100, frames);
+	processor.prepareToPlay(44100, frames);
+
+	juce::AudioBuffer<float> buffer(channels, frames);
+	juce::MidiBuffer midi;
+
+	for (int c = 0; c < channels; ++c)
+	{
+		for (int n = 0; n < frames; ++n)
+			buffer.setSample(c, n, c + n / static_cast<float>(frames));
+	}
+
+	processor.processBlock(buffer, midi);
+
+	for (int c = 0; c < channels; ++c)
+	{
+		for (int n = 0; n < frames; ++n)
+			REQUIRE(buffer.getSample(c, n) == c + n / static_cast<float>(frames));
+	}
+
+	processor.releaseResources();
+}
@@ -0,0 +1,65 @@
+#include "stdafx.h"
+#include <Engine/GraphDescription.h>
+#include <sstream>
+
+namespace
+{
+	ape::GraphDescription Parse(const char* text)
+	{
+		std::istringstream stream(text);
+		return ape::GraphDescription::Parse(stream, "test");
+	}
+}
+
+TEST_CASE("Graph descriptions name nodes and connections", "[GraphDescription]")
+{
+	auto graph = Parse(
+		"# an eq feeding a reverb, mixed with the dry eq\n"
+		"node eq  my eq.cpp  \n"
+		"node verb verb.cpp\n"
+		"host -> eq\n"
+		"eq -> verb\n"
+		"eq -> host # dry\n"
+		"verb -> host\n"
+	);
+
+	REQUIRE(graph.getNodes().size() == 2);
+	REQUIRE(graph.getNodes()[0].name == "eq");
+	REQUIRE(graph.getNodes()[0].script == "my eq.cpp");
+	REQUIRE(graph.getNodes()[1].script == "verb.cpp");
+
+	auto& connections = graph.getConnections();
+	REQUIRE(connections.size() == 4);
+	REQUIRE(connections[0].from == ape::ProcessingGraph::Host);
+	REQUIRE(connections[0].to == 0);
+	REQUIRE(connections[1].from == 0);
+	REQUIRE(connections[1].to == 1);
+	REQUIRE(connections[3].to == ape::ProcessingGraph::Host);
+}
+
+TEST_CASE("Single node graphs run between the host inputs and outputs", "[GraphDescription]")
+{
+	auto graph = ape::GraphDescription::Single("module", "exports/my #1 eq.so");
+
+	REQUIRE(graph.getNodes().size() == 1);
+	REQUIRE(graph.getNodes()[0].script == "exports/my #1 eq.so");
+
+	auto& connections = graph.getConnections();
+	REQUIRE(connections.size() == 2);
+	REQUIRE(connections[0].from == ape::ProcessingGraph::Host);
+	REQUIRE(connections[0].to == 0);
+	REQUIRE(connections[1].from == 0);
+	REQUIRE(connections[1].to == ape::ProcessingGraph::Host);
+}
+
+TEST_CASE("Graph descriptions reject errors", "[GraphDescription]")
+{
+	REQUIRE_THROWS(Parse(""));
+	REQUIRE_THROWS(Parse("node a\n"));
+	REQUIRE_THROWS(Parse("node host x.cpp\n"));
+	REQUIRE_THROWS(Parse("node a x.cpp\nnode a y.cpp\n"));
+	REQUIRE_THROWS(Parse("node a x.cpp\na -> b\n"));
+	REQUIRE_THROWS(Parse("node a x.cpp\na -> \n"));
+	REQUIRE_THROWS(Parse("node a x.cpp\na -> host b\n"));
+	REQUIRE_THROWS(ape::GraphDescription::FromFile("does/not/exist.apegraph"));
+}
@@ -0,0 +1,78 @@
+#include "stdafx.h"
+#include <Engine/LatencyHistogram.h>
+#include <chrono>
+#include <cmath>
+
+TEST_CASE("Latency histogram finds the percentiles and the slowest block", "[LatencyHistogram]")
+{
+	ape::LatencyHistogram histogram(0.5);
+	const double deadline = 64 / 44100.0;
+
+	for (int i = 0; i < 10000; ++i)
+	{
+		// a steady load of 10%, with 1% of the blocks at 40% and a single dropout
+		double load = 0.1;
+
+		if (i % 100 == 99)
+			load = 0.4;
+		if (i == 5000)
+			load = 3;
+
+		histogram.record(load * deadline, deadline);
+	}
+
+	const auto before = std::chrono::system_clock::now();
+	histogram.record(0.05 * deadline, deadline);
+
+	const auto snapshot = histogram.snapshot();
+	const double step = std::exp2(1.0 / ape::LatencyHistogram::bucketsPerOctave);
+
+	REQUIRE(snapshot.blocks == 10001);
+	REQUIRE(snapshot.p50 >= 0.1);
+	REQUIRE(snapshot.p50 < 0.1 * step);
+	REQUIRE(snapshot.p99 >= 0.4);
+	REQUIRE(snapshot.p99 < 0.4 * step);
+	REQUIRE(snapshot.p999 >= 0.4);
+	REQUIRE(snapshot.max == Approx(3));
+	REQUIRE(snapshot.maxSeconds == Approx(3 * deadline));
+	REQUIRE(snapshot.maxTime <= before);
+	REQUIRE(snapshot.overThreshold == 1);
+	REQUIRE(snapshot.overDeadline == 1);
+}
+
+TEST_CASE("Latency histogram resets with the next block", "[LatencyHistogram]")
+{
+	ape::LatencyHistogram histogram(0.8);
+
+	histogram.record(0.9, 1);
+	histogram.record(2, 1);
+	REQUIRE(histogram.snapshot().overThreshold == 2);
+
+	histogram.reset();
+	histogram.setThreshold(0.25);
+	histogram.record(0.3, 1);
+
+	const auto snapshot = histogram.snapshot();
+
+	REQUIRE(snapshot.blocks == 1);
+	REQUIRE(snapshot.overThreshold == 1);
+	REQUIRE(snapshot.overDeadline == 0);
+	REQUIRE(snapshot.max == Approx(0.3));
+	REQUIRE(snapshot.p50 == Approx(0.3));
+}
+
+TEST_CASE("Latency histogram clamps loads outside of its range", "[LatencyHistogram]")
+{
+	ape::LatencyHistogram histogram;
+
+	histogram.record(0, 1);
+	histogram.record(1e-9, 1);
+	histogram.record(1000, 1);
+
+	const auto snapshot = histogram.snapshot();
+
+	REQUIRE(snapshot.blocks == 3);
+	REQUIRE(snapshot.p50 <= ape::LatencyHistogram::bucketLimit(0));
+	REQUIRE(snapshot.max == Approx(1000));
+	REQUIRE(snapshot.overDeadline == 1);
+}
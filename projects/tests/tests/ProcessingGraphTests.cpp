@@ -0,0 +1,299 @@
+#include "stdafx.h"
+#include <Engine/ProcessingGraph.h>
+#include <Engine/RealtimePool.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	class Gain : public ape::ProcessingGraph::Processor
+	{
+	public:
+
+		Gain(float gain, bool fail = false) : gain(gain), fail(fail) {}
+
+		void prepare(std::size_t inputs, std::size_t outputs, std::size_t maxBlockSize) override
+		{
+			buffer.resize(outputs * maxBlockSize);
+			channels.resize(outputs);
+
+			for (std::size_t c = 0; c < outputs; ++c)
+				channels[c] = buffer.data() + c * maxBlockSize;
+
+			numInputs = inputs;
+		}
+
+		bool process(const float* const* inputs, std::size_t numSamples) override
+		{
+			calls++;
+
+			for (std::size_t c = 0; c < channels.size(); ++c)
+			{
+				for (std::size_t n = 0; n < numSamples; ++n)
+					channels[c][n] = (c < numInputs ? inputs[c][n] : 0) * gain;
+			}
+
+			return !fail;
+		}
+
+		const float* const* outputs() const noexcept override { return channels.data(); }
+
+		std::atomic<int> calls { 0 };
+
+	private:
+		float gain;
+		bool fail;
+		std::size_t numInputs = 0;
+		std::vector<float> buffer;
+		std::vector<float*> channels;
+	};
+
+	struct Block
+	{
+		Block(std::size_t channels, std::size_t length, float value)
+			: input(channels * length, value), output(channels * length, -1)
+		{
+			for (std::size_t c = 0; c < channels; ++c)
+			{
+				inputs.push_back(input.data() + c * length);
+				outputs.push_back(output.data() + c * length);
+			}
+		}
+
+		std::vector<float> input, output;
+		std::vector<const float*> inputs;
+		std::vector<float*> outputs;
+	};
+}
+
+TEST_CASE("Graph chains, splits and sums", "[ProcessingGraph]")
+{
+	ape::RealtimePool pool(3);
+	ape::ProcessingGraph graph;
+
+	// host -> a -> (b, c) -> d -> host, plus a dry path from the host
+	auto a = graph.add(std::make_shared<Gain>(2.0f));
+	auto b = graph.add(std::make_shared<Gain>(3.0f));
+	auto c = graph.add(std::make_shared<Gain>(5.0f));
+	auto d = graph.add(std::make_shared<Gain>(0.5f));
+
+	graph.connect(ape::ProcessingGraph::Host, a);
+	graph.connect(a, b);
+	graph.connect(a, c);
+	graph.connect(b, d);
+	graph.connect(c, d);
+	graph.connect(d, ape::ProcessingGraph::Host);
+	graph.connect(ape::ProcessingGraph::Host, ape::ProcessingGraph::Host);
+
+	graph.prepare(2, 2, 64);
+
+	Block block(2, 64, 1.0f);
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		REQUIRE(graph.process(pool, block.inputs.data(), block.outputs.data(), 64));
+		// ((1 * 2) * 3 + (1 * 2) * 5) * 0.5 + 1
+		REQUIRE(block.output[0] == 9.0f);
+		REQUIRE(block.output[127] == 9.0f);
+	}
+}
+
+TEST_CASE("Graph rejects cycles", "[ProcessingGraph]")
+{
+	ape::ProcessingGraph graph;
+
+	auto a = graph.add(std::make_shared<Gain>(1.0f));
+	auto b = graph.add(std::make_shared<Gain>(1.0f));
+
+	graph.connect(a, b);
+	graph.connect(b, a);
+
+	REQUIRE_THROWS(graph.prepare(2, 2, 64));
+	REQUIRE_THROWS(graph.connect(a, 5));
+}
+
+TEST_CASE("Failing nodes are silent", "[ProcessingGraph]")
+{
+	ape::RealtimePool pool(0);
+	ape::ProcessingGraph graph;
+
+	auto good = graph.add(std::make_shared<Gain>(1.0f));
+	auto bad = graph.add(std::make_shared<Gain>(1.0f, true));
+
+	graph.connect(ape::ProcessingGraph::Host, good);
+	graph.connect(ape::ProcessingGraph::Host, bad);
+	graph.connect(good, ape::ProcessingGraph::Host);
+	graph.connect(bad, ape::ProcessingGraph::Host);
+
+	graph.prepare(1, 1, 16);
+
+	Block block(1, 16, 1.0f);
+
+	REQUIRE(!graph.process(pool, block.inputs.data(), block.outputs.data(), 16));
+	REQUIRE(block.output[0] == 1.0f);
+}
+
+TEST_CASE("Independent nodes run on several threads", "[ProcessingGraph]")
+{
+	ape::RealtimePool pool(3);
+	ape::ProcessingGraph graph;
+
+	std::vector<std::shared_ptr<Gain>> nodes;
+
+	for (int i = 0; i < 64; ++i)
+	{
+		nodes.push_back(std::make_shared<Gain>(1.0f / 64));
+		auto node = graph.add(nodes.back());
+		graph.connect(ape::ProcessingGraph::Host, node);
+		graph.connect(node, ape::ProcessingGraph::Host);
+	}
+
+	graph.prepare(2, 2, 128);
+
+	Block block(2, 128, 1.0f);
+
+	for (int i = 0; i < 100; ++i)
+	{
+		REQUIRE(graph.process(pool, block.inputs.data(), block.outputs.data(), 128));
+		REQUIRE(block.output[0] == Approx(1.0f));
+	}
+
+	for (auto& node : nodes)
+		REQUIRE(node->calls == 100);
+}
+
+TEST_CASE("Parallel loops cover every index once", "[RealtimePool]")
+{
+	ape::RealtimePool pool(3);
+
+	for (std::size_t count : { 0, 1, 7, 1000 })
+	{
+		for (std::size_t grain : { 1, 3, 64, 5000 })
+		{
+			std::vector<std::atomic<int>> hits(count);
+
+			for (int run = 0; run < 20; ++run)
+			{
+				pool.parallelFor(count, grain,
+					[](void* context, std::size_t begin, std::size_t end)
+					{
+						auto& hits = *static_cast<std::vector<std::atomic<int>>*>(context);
+						for (auto i = begin; i < end; ++i)
+							hits[i]++;
+					},
+					&hits
+				);
+			}
+
+			for (auto& hit : hits)
+				REQUIRE(hit.load() == 20);
+		}
+	}
+}
+
+TEST_CASE("Workers parked after a block join the next one", "[RealtimePool]")
+{
+	ape::RealtimePool pool(3);
+
+	struct Loop
+	{
+		std::atomic<int> hits { 0 };
+		std::atomic<bool> helped { false };
+	} loop;
+
+	for (int block = 0; block < 20; ++block)
+	{
+		pool.parallelFor(64, 1,
+			[](void* context, std::size_t, std::size_t)
+			{
+				auto& loop = *static_cast<Loop*>(context);
+				loop.hits++;
+
+				if (ape::RealtimePool::isWorkerThread())
+					loop.helped = true;
+
+				// long enough for woken workers to take some of the chunks
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			},
+			&loop
+		);
+
+		pool.endBlock();
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	REQUIRE(loop.hits.load() == 20 * 64);
+	REQUIRE(loop.helped.load());
+}
+
+TEST_CASE("Parallel loops inside graph runs are serial", "[RealtimePool]")
+{
+	ape::RealtimePool pool(2);
+
+	struct Nested : ape::RealtimePool::Job
+	{
+		std::atomic<std::size_t> remaining { 1 };
+		std::thread::id caller, loop;
+	} job;
+
+	job.execute = [](ape::RealtimePool::Job& self, ape::RealtimePool& pool)
+	{
+		auto& nested = static_cast<Nested&>(self);
+		nested.caller = std::this_thread::get_id();
+
+		pool.parallelFor(100, 1,
+			[](void* context, std::size_t, std::size_t)
+			{
+				static_cast<Nested*>(context)->loop = std::this_thread::get_id();
+			},
+			&nested
+		);
+
+		nested.remaining--;
+	};
+
+	ape::RealtimePool::Job* roots[] = { &job };
+	pool.run(roots, 1, job.remaining);
+
+	REQUIRE(job.caller == job.loop);
+}
+
+TEST_CASE("Shared pools run graphs of several instances at once", "[RealtimePool]")
+{
+	auto pool = ape::RealtimePool::acquire(3);
+	REQUIRE(ape::RealtimePool::acquire() == pool);
+
+	auto instance = [&pool](std::atomic<bool>& ok)
+	{
+		ape::ProcessingGraph graph;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			auto node = graph.add(std::make_shared<Gain>(1.0f / 16));
+			graph.connect(ape::ProcessingGraph::Host, node);
+			graph.connect(node, ape::ProcessingGraph::Host);
+		}
+
+		graph.prepare(2, 2, 64);
+
+		Block block(2, 64, 1.0f);
+
+		for (int i = 0; i < 500; ++i)
+		{
+			if (!graph.process(*pool, block.inputs.data(), block.outputs.data(), 64) || !(block.output[0] == Approx(1.0f)))
+				ok = false;
+		}
+	};
+
+	std::atomic<bool> firstOk { true }, secondOk { true };
+	std::thread first(instance, std::ref(firstOk)), second(instance, std::ref(secondOk));
+
+	first.join();
+	second.join();
+
+	REQUIRE(firstOk);
+	REQUIRE(secondOk);
+}
@@ -0,0 +1,82 @@
+#include "stdafx.h"
+#include <Engine/ScopeTimeline.h>
+
+namespace
+{
+	// writes like APE_PROFILE_SCOPE() does, see profile_scope.h
+	void push(APE_ProfileRing& ring, unsigned long long stamp, const char* name)
+	{
+		ring.events[ring.written & ring.mask] = { stamp, name };
+		ring.written++;
+	}
+}
+
+TEST_CASE("Scope timeline nests scopes into frames of top level scopes", "[ScopeTimeline]")
+{
+	ape::ScopeTimeline timeline(64);
+	auto& ring = timeline.getRing();
+
+	REQUIRE(ring.mask == 63);
+	REQUIRE(!timeline.drain());
+
+	push(ring, 1000, "process");
+	push(ring, 1010, "filter");
+	push(ring, 1020, "inner");
+	push(ring, 1030, nullptr);
+	push(ring, 1050, nullptr);
+	push(ring, 1060, "mix");
+	// an unfinished frame isn't visible yet
+	REQUIRE(!timeline.drain());
+	REQUIRE(timeline.getLatest().spans.empty());
+
+	push(ring, 1070, nullptr);
+	push(ring, 1100, nullptr);
+	REQUIRE(timeline.drain());
+	REQUIRE(ring.read == ring.written);
+
+	const auto& spans = timeline.getLatest().spans;
+
+	REQUIRE(spans.size() == 4);
+	REQUIRE(spans[0].name == "process");
+	REQUIRE(spans[0].depth == 0);
+	REQUIRE(spans[0].begin == 0);
+	REQUIRE(spans[0].end == 100);
+	REQUIRE(spans[1].name == "filter");
+	REQUIRE(spans[1].depth == 1);
+	REQUIRE(spans[1].begin == 10);
+	REQUIRE(spans[1].end == 50);
+	REQUIRE(spans[2].name == "inner");
+	REQUIRE(spans[2].depth == 2);
+	REQUIRE(spans[3].name == "mix");
+	REQUIRE(spans[3].depth == 1);
+	REQUIRE(spans[3].end == 70);
+	REQUIRE(timeline.getLatest().length() == 100);
+}
+
+TEST_CASE("Scope timeline keeps the slowest frame until reset", "[ScopeTimeline]")
+{
+	ape::ScopeTimeline timeline(16);
+	auto& ring = timeline.getRing();
+
+	unsigned long long now = 0;
+	const unsigned long long lengths[] = { 10, 500, 20 };
+
+	for (auto length : lengths)
+	{
+		push(ring, now, "process");
+		push(ring, now + length, nullptr);
+		now += 1000;
+		REQUIRE(timeline.drain());
+	}
+
+	REQUIRE(timeline.getLatest().length() == 20);
+	REQUIRE(timeline.getSlowest().length() == 500);
+
+	timeline.resetSlowest();
+	REQUIRE(timeline.getSlowest().spans.empty());
+
+	push(ring, now, "process");
+	push(ring, now + 30, nullptr);
+	REQUIRE(timeline.drain());
+	REQUIRE(timeline.getSlowest().length() == 30);
+}
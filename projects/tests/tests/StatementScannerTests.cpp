@@ -0,0 +1,187 @@
+#include "stdafx.h"
+#include "../../cppape/src/StatementScanner.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// zero-based lines a statement may be inserted in front of
+	std::vector<std::size_t> Marked(const std::string& source)
+	{
+		const auto numLines = static_cast<std::size_t>(std::count(source.begin(), source.end(), '\n')) + 1;
+		const auto flags = CppAPE::FindStatementLines(source, numLines);
+
+		std::vector<std::size_t> ret;
+
+		for (std::size_t i = 0; i < flags.size(); ++i)
+		{
+			if (flags[i])
+				ret.push_back(i);
+		}
+
+		return ret;
+	}
+
+	using Lines = std::vector<std::size_t>;
+}
+
+TEST_CASE("Statement lines are found in function bodies only", "[StatementScanner]")
+{
+	auto marked = Marked(
+		"struct s\n"                      // 0
+		"{\n"                             // 1
+		"	int x = 0;\n"                 // 2
+		"	void f()\n"                   // 3
+		"	{\n"                          // 4
+		"		x++;\n"                   // 5
+		"		if (x)\n"                 // 6
+		"		{\n"                      // 7
+		"			x--;\n"               // 8
+		"		}\n"                      // 9
+		"	}\n"                          // 10
+		"	int y = 0;\n"                 // 11
+		"};\n"                            // 12
+	);
+
+	REQUIRE(marked == Lines({ 5, 6, 8 }));
+}
+
+TEST_CASE("Branches of preprocessor conditionals don't unbalance the braces", "[StatementScanner]")
+{
+	auto marked = Marked(
+		"struct s\n"                      // 0
+		"{\n"                             // 1
+		"	void f(bool a, bool b)\n"     // 2
+		"	{\n"                          // 3
+		"#ifdef A\n"                      // 4
+		"		if (a) {\n"               // 5
+		"#else\n"                         // 6
+		"		if (b) {\n"               // 7
+		"#endif\n"                        // 8
+		"			g();\n"               // 9
+		"		}\n"                      // 10
+		"		h();\n"                   // 11
+		"	}\n"                          // 12
+		"	int z = 0;\n"                 // 13
+		"};\n"                            // 14
+	);
+
+	REQUIRE(marked == Lines({ 5, 7, 9, 11 }));
+}
+
+TEST_CASE("Unbalanced conditionals stop the scan", "[StatementScanner]")
+{
+	auto marked = Marked(
+		"struct s\n"                      // 0
+		"{\n"                             // 1
+		"	void f()\n"                   // 2
+		"	{\n"                          // 3
+		"		g();\n"                   // 4
+		"#if 0\n"                         // 5
+		"		{\n"                      // 6
+		"#endif\n"                        // 7
+		"		g();\n"                   // 8
+		"	}\n"                          // 9
+		"	int z = 0;\n"                 // 10
+		"};\n"                            // 11
+	);
+
+	// the block itself is a valid statement where it is, only the code after the conditional is uncertain
+	REQUIRE(marked == Lines({ 4, 6 }));
+
+	// #elif branches ending at other depths than the first
+	REQUIRE(Marked("void f()\n{\n#if A\n{\n#elif B\n#else\n{\n#endif\ng();\n}\n}\nint z;\n") == Lines({ 3 }));
+}
+
+TEST_CASE("Raw strings are skipped", "[StatementScanner]")
+{
+	auto marked = Marked(
+		"void f()\n"                      // 0
+		"{\n"                             // 1
+		"	auto s = R\"x(\n"             // 2
+		"	}\n"                          // 3
+		"	\")\" {\n"                    // 4
+		"	)x\";\n"                      // 5
+		"	g();\n"                       // 6
+		"}\n"                             // 7
+		"int z = 0;\n"                    // 8
+	);
+
+	REQUIRE(marked == Lines({ 2, 6 }));
+}
+
+TEST_CASE("Lambda bodies are function bodies", "[StatementScanner]")
+{
+	auto marked = Marked(
+		"void f()\n"                      // 0
+		"{\n"                             // 1
+		"	auto l = [](int x) mutable\n" // 2
+		"	{\n"                          // 3
+		"		return x;\n"              // 4
+		"	};\n"                         // 5
+		"	auto v = std::vector<int>{\n" // 6
+		"		1,\n"                     // 7
+		"		2\n"                      // 8
+		"	};\n"                         // 9
+		"}\n"                             // 10
+	);
+
+	REQUIRE(marked == Lines({ 2, 4, 6 }));
+}
+
+TEST_CASE("Case labels are followed by statements", "[StatementScanner]")
+{
+	auto marked = Marked(
+		"void f(int x)\n"                 // 0
+		"{\n"                             // 1
+		"	switch (x)\n"                 // 2
+		"	{\n"                          // 3
+		"	case 1:\n"                    // 4
+		"		g();\n"                   // 5
+		"		break;\n"                 // 6
+		"	default:\n"                   // 7
+		"		h();\n"                   // 8
+		"	}\n"                          // 9
+		"}\n"                             // 10
+	);
+
+	REQUIRE(marked == Lines({ 2, 4, 5, 6, 7, 8 }));
+}
+
+TEST_CASE("Function try blocks are instrumented inside the try only", "[StatementScanner]")
+{
+	auto marked = Marked(
+		"void f()\n"                      // 0
+		"try\n"                           // 1
+		"{\n"                             // 2
+		"	g();\n"                       // 3
+		"}\n"                             // 4
+		"catch (...)\n"                   // 5
+		"{\n"                             // 6
+		"	h();\n"                       // 7
+		"}\n"                             // 8
+	);
+
+	REQUIRE(marked == Lines({ 3, 7 }));
+}
+
+TEST_CASE("Constexpr functions and do-while conditions are left alone", "[StatementScanner]")
+{
+	auto marked = Marked(
+		"constexpr int f()\n"             // 0
+		"{\n"                             // 1
+		"	return 1;\n"                  // 2
+		"}\n"                             // 3
+		"void g()\n"                      // 4
+		"{\n"                             // 5
+		"	do\n"                         // 6
+		"	{\n"                          // 7
+		"		h();\n"                   // 8
+		"	}\n"                          // 9
+		"	while (true);\n"              // 10
+		"}\n"                             // 11
+	);
+
+	REQUIRE(marked == Lines({ 6, 8 }));
+}
@@ -39,11 +39,18 @@
 		#elif (__MACH__) && (__APPLE__)
 			#define EXPORTED __attribute__ ((visibility ("default")))
 			#define __MAC__
+		#elif defined(__linux__)
+			#define EXPORTED __attribute__ ((visibility ("default")))
 		#endif
 		#ifdef _MSC_VER
 			#define APE_STD_API _cdecl
 			#define APE_API APE_STD_API
 			#define APE_API_VARI _cdecl
+		#elif defined(__linux__)
+			// there's only one calling convention, and gcc doesn't know __cdecl
+			#define APE_STD_API
+			#define APE_API APE_STD_API
+			#define APE_API_VARI APE_STD_API
 		#else
 			#define APE_STD_API __cdecl
 			#define APE_API APE_STD_API
@@ -71,7 +78,8 @@
 		STATUS_READY = 4,	// ready for any operation
 		STATUS_DISABLED = 5,// plugin is disabled
 		STATUS_HANDLED = 6,  // plugin handled request, host shouldn't do anything.
-		STATUS_NOT_IMPLEMENTED = 7 // operation not supported
+		STATUS_NOT_IMPLEMENTED = 7, // operation not supported
+		STATUS_MISS = 8		// compiled code to restore isn't available, see APE_Project::restoreArtifact
 	} APE_Status;
 	
 	typedef enum
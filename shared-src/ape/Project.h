@@ -33,6 +33,43 @@
 	#define APE_PROJECT_H
 
 	#include "SharedInterface.h"
+	#include "Events.h"
+
+	/// <summary>
+	/// Milliseconds spent in the phases of the latest compilation and initialization of a project.
+	/// Phases that didn't run (like the frontend, if the code was cached) are zero.
+	/// </summary>
+	struct APE_CompileTimings
+	{
+		/// <summary>
+		/// Preparing what's shared by every project, like a runtime and precompiled headers.
+		/// </summary>
+		double environment;
+		/// <summary>
+		/// Parsing and compiling source into an intermediate form.
+		/// </summary>
+		double frontend;
+		/// <summary>
+		/// Loading previously compiled code, like cached units and the runtime.
+		/// </summary>
+		double load;
+		/// <summary>
+		/// Generating and linking machine code.
+		/// </summary>
+		double codegen;
+		/// <summary>
+		/// Running the constructors of globals.
+		/// </summary>
+		double prepareGlobals;
+		/// <summary>
+		/// Looking up the first symbol, which may emit code lazily.
+		/// </summary>
+		double firstSymbol;
+		/// <summary>
+		/// Units of the project found in, and missing from, a cache of compiled code.
+		/// </summary>
+		unsigned cacheHits, cacheMisses;
+	};
 
 	struct APE_Project
 	{
@@ -115,6 +152,65 @@
 		/// Measured in terms of floats.
 		/// </summary>
 		int nativeVectorBitWidth;
+
+		/// <summary>
+		/// If set, the compiler must not compile anything, and only restore the code previously compiled as
+		/// this artifact (see below) - and only if it's still up to date with the project.
+		/// Otherwise, it returns STATUS_MISS, and the project has to be compiled normally.
+		/// </summary>
+		const char * restoreArtifact;
+
+		/// <summary>
+		/// Set by compilers caching their output, after compiling: a content hash identifying the compiled code.
+		/// Empty otherwise.
+		/// </summary>
+		char artifact[64];
+
+		/// <summary>
+		/// If set, the compiler builds the project ahead of time into a native module at this path, instead of
+		/// preparing it to run. The module exports the compiler interface, so it can be loaded as a compiler
+		/// that runs the exported project. The project can't be initialized afterwards.
+		/// Compilers not supporting this return STATUS_NOT_IMPLEMENTED.
+		/// </summary>
+		const char * exportPath;
+		/// <summary>
+		/// If set, the compiler may specialise the code for exactly this configuration, for instance by exposing it
+		/// as constants to the script. The code must still run correctly if the configuration changes afterwards.
+		/// Compilers not supporting this ignore it.
+		/// </summary>
+		const struct APE_Event_IOChanged * staticConfig;
+		/// <summary>
+		/// If set, the compiler reports what the optimizer did and missed with the code (like vectorization and inlining)
+		/// as APE_Diag_Info diagnostics of the form "projectName:line:column: remark: message".
+		/// </summary>
+		unsigned optimizationRemarks;
+		/// <summary>
+		/// If set, the compiler instruments the project to keep track of the source line being executed, for sampling
+		/// how the processing time is spent. Compilers not supporting this ignore it.
+		/// </summary>
+		unsigned profileLines;
+		/// <summary>
+		/// Set by compilers profiling lines after initialization: the 1-based line being executed, or 0 if it's none
+		/// of the project's. May be read from any thread while the project exists. Null otherwise.
+		/// </summary>
+		volatile const int * currentLine;
+		/// <summary>
+		/// If set, APE_PROFILE_SCOPE() in the project records timestamped scopes into the ring returned by
+		/// <see cref="APE_SharedInterface::getProfileRing"/>. Otherwise the scopes compile to nothing.
+		/// </summary>
+		unsigned profileScopes;
+		/// <summary>
+		/// Profile guided optimization: unless it's APE_ProfileGuidance_None, <see cref="profileDirectory"/> is where the
+		/// profile is written by instrumented code, and read again by optimized builds of the same project.
+		/// Compilers not supporting this return STATUS_NOT_IMPLEMENTED.
+		/// </summary>
+		APE_ProfileGuidance profileGuidance;
+		const char * profileDirectory;
+		/// <summary>
+		/// Set by compilers measuring how long it takes to compile and initialize the project, for benchmarks.
+		/// Reset by every compilation. Zero otherwise.
+		/// </summary>
+		struct APE_CompileTimings timings;
 	};
 	
 	#ifdef __cplusplus
@@ -37,6 +37,7 @@
 	{
 		APE_Alloc_Buffer,
 		APE_Alloc_Tiny,
+		/* uninitialized, released automatically after each processed block */
 		APE_Alloc_Temp
 	} APE_AllocationLabel;
 
@@ -77,6 +78,22 @@
 		APE_Optimization_Best
 	} APE_Optimization_Level;
 
+	typedef enum
+	{
+		/// <summary>
+		/// Compiled normally
+		/// </summary>
+		APE_ProfileGuidance_None,
+		/// <summary>
+		/// The code counts how it's executed, and writes the counts to the profile directory when released
+		/// </summary>
+		APE_ProfileGuidance_Instrument,
+		/// <summary>
+		/// The counts in the profile directory guide the optimization of the code
+		/// </summary>
+		APE_ProfileGuidance_Optimize
+	} APE_ProfileGuidance;
+
 	struct APE_SharedInterface;
 
 	struct APE_AudioFile
@@ -157,6 +174,35 @@
         bool isLooping;
     };
 
+	/// <summary>
+	/// Loop body for <see cref="APE_SharedInterface::parallelFor"/>, called with half open index ranges [begin, end).
+	/// </summary>
+	typedef void (APE_API * APE_ParallelBody)(void* context, size_t begin, size_t end);
+
+	/// <summary>
+	/// Beginning (or end, if <see cref="name"/> is null) of a profiling scope, timestamped in processor ticks.
+	/// </summary>
+	struct APE_ProfileEvent
+	{
+		unsigned long long stamp;
+		const char* name;
+	};
+
+	/// <summary>
+	/// Single producer, single consumer ring of profiling events. The processing thread writes events and
+	/// then publishes them by releasing <see cref="written"/>; the host consumes them and releases <see cref="read"/>.
+	/// Both counters increase monotonically, and index <see cref="events"/> masked with <see cref="mask"/>.
+	/// Scopes that don't fit are not written, but counted in <see cref="dropped"/>.
+	/// </summary>
+	struct APE_ProfileRing
+	{
+		struct APE_ProfileEvent* events;
+		size_t mask;
+		size_t written;
+		size_t read;
+		size_t dropped;
+	};
+
 	struct APE_SharedInterface
 	{
 		void		(APE_API * abortPlugin)				(struct APE_SharedInterface * iface, const char * reason);
@@ -189,6 +235,9 @@
 		void		(APE_API * writeAudioFile)			(struct APE_SharedInterface * iface, int file, unsigned int numSamples, const float* const* data);
 		void		(APE_API * closeAudioFile)			(struct APE_SharedInterface * iface, int file);
         int         (APE_API * getPlayHeadPosition)     (struct APE_SharedInterface * iface, struct APE_PlayHeadPosition* result);
+		void		(APE_API * parallelFor)				(struct APE_SharedInterface * iface, size_t count, size_t grain, APE_ParallelBody body, void* context);
+		struct APE_ProfileRing*
+					(APE_API * getProfileRing)			(struct APE_SharedInterface * iface);
 	};
 	
 #if defined(__cplusplus) && !defined(__cfront)